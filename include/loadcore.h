@@ -347,7 +347,9 @@ typedef struct SceStubLibrary {
     char *libName2; //48
     /** Indicates whether the library's name is located in the heap or not. */
     u32 libNameInHeap; //52
-} SceStubLibrary; //size = 56
+    /** The hash of the library's name, computed once when the stub library is registered. */
+    u32 libNameHash; //56
+} SceStubLibrary; //size = 60
 
 /**
  * This structure represents a resident library control block. This control block is used to manage 
@@ -427,7 +429,15 @@ typedef struct SceResidentLibrary {
      * Extra export entries in the system call table entry belonging to the resident library. 
      */
     u16 extraExportEntries; //78
-} SceResidentLibrary; //size = 80
+    /**
+     * Sorted copy of the NIDs of the library, used to speed up the NID searches when linking stub 
+     * libraries. The functions and the variables are sorted separately, and the NIDs are followed 
+     * by their u16 positions in the entry table. NULL when the library has no index.
+     */
+    u32 *nidIndex; //80
+    /** The hash of the library's name, computed once when the library is registered. */
+    u32 libNameHash; //84
+} SceResidentLibrary; //size = 88
 
 /** 
  * This structure represents Protection Information
@@ -827,8 +837,11 @@ typedef struct {
     u32 regModCount; //532
     /** The secondary module ID value assigned to a module during registration. */
     u32 secModId; //536
-    /** A linked list of currently unlinked stub libraries living in memory. */
-    SceStubLibrary *unLinkedStubLibs; //540
+    /** 
+     * A hash table of the currently unlinked stub libraries living in memory, indexed by the hash 
+     * of their library's name. Stub libraries with the same slot are connected via a linked list.
+     */
+    SceStubLibrary **unLinkedStubLibs; //540
     /** 
      * The ID of Loadcore's heap block. Used to allocate memory from the heap 
      * in Loadcore. 
@@ -838,6 +851,30 @@ typedef struct {
     u32 linkedLoadCoreStubs;
     /** Pointer to Loadcore's control block of boot callbacks. */
     SceBootCallback *bootCallBacks; //556
+    /** 
+     * The hash table of registered resident libraries. It uses registeredLibs until the number of 
+     * registered libraries requires a bigger table, which is then allocated from Loadcore's heap.
+     */
+    SceResidentLibrary **libHashTable; //560
+    /** The number of slots of libHashTable (a power of 2). */
+    u32 libHashTableSize; //564
+    /** 
+     * The previous hash table while its libraries are moved to libHashTable, a few slots at a time. 
+     * NULL when no table is being rehashed.
+     */
+    SceResidentLibrary **oldLibHashTable; //568
+    /** The number of slots of oldLibHashTable. */
+    u32 oldLibHashTableSize; //572
+    /** The first slot of oldLibHashTable whose libraries haven't been moved yet. */
+    u32 libRehashIndex; //576
+    /** The number of registered resident libraries. */
+    u32 regLibCount; //580
+    /** The number of lookups of a library by its name. */
+    u32 libLookups; //584
+    /** The number of libraries compared during these lookups. */
+    u32 libProbes; //588
+    /** The length of the longest hash chain a library was inserted into. */
+    u32 maxLibChainLength; //592
 } SceLoadCore;
 
 
@@ -978,7 +1015,8 @@ u32 sceKernelMaskLibraryEntries(void);
 
 /**
  * Get Loadcore's control block. The block takes care of the registered libraries, the unlinked 
- * stub libraries living in memory and the currently loaded modules.
+ * stub libraries living in memory and the currently loaded modules. It also holds the statistics 
+ * of the registered libraries' hash table (libLookups, libProbes and maxLibChainLength).
  * 
  * @return A pointer to Loadcore's internal control block.
  */
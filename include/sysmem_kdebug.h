@@ -14,7 +14,72 @@ SceKernelDeci2Ops *sceKernelDeci2pReferOperations(void);
 
 void *sceKernelSm1ReferOperations();
 
-void Kprintf(const char *format, ...);
+int Kprintf(const char *format, ...);
+
+#define KPRINTF_LEVEL_NONE      0
+#define KPRINTF_LEVEL_ERROR     1
+#define KPRINTF_LEVEL_WARNING   2
+#define KPRINTF_LEVEL_INFO      3
+#define KPRINTF_LEVEL_DEBUG     4
+
+/* The most verbose level compiled in, messages of a higher level are removed at compile time. */
+#ifndef KPRINTF_LEVEL
+#define KPRINTF_LEVEL KPRINTF_LEVEL_DEBUG
+#endif
+
+#define KprintfLevel(level, ...) do { \
+    if ((level) <= KPRINTF_LEVEL) \
+        Kprintf(__VA_ARGS__); \
+} while (0)
+
+#define KprintfError(...)   KprintfLevel(KPRINTF_LEVEL_ERROR, __VA_ARGS__)
+#define KprintfWarning(...) KprintfLevel(KPRINTF_LEVEL_WARNING, __VA_ARGS__)
+#define KprintfInfo(...)    KprintfLevel(KPRINTF_LEVEL_INFO, __VA_ARGS__)
+#define KprintfDebug(...)   KprintfLevel(KPRINTF_LEVEL_DEBUG, __VA_ARGS__)
+
+typedef struct {
+    u32 size; // size of the buffer, 0 if the messages aren't buffered
+    u32 used; // size of the messages waiting to be drained
+    u32 dropped; // number of messages dropped because the buffer was full
+    u32 droppedSize; // total size of the dropped messages
+} SceKernelKprintfBufferStats;
+
+/**
+ * Buffers the messages printed with Kprintf() instead of sending them directly to the debug putchar handler, so
+ * printing doesn't wait for the debug device. The messages are sent by sceKernelKprintfDrain(), which is meant
+ * to be called by a low-priority thread.
+ *
+ * @param buf The buffer, or NULL to print directly again (the messages not drained yet are lost).
+ * @param size The size of the buffer, a power of 2 of at least 64 bytes.
+ *
+ * @return 0 on success, 0x80000104 if the size is invalid.
+ */
+s32 sceKernelKprintfSetBuffer(void *buf, u32 size);
+
+/**
+ * Sends the buffered messages to the debug putchar handler.
+ *
+ * @param maxSize The maximum number of bytes to send.
+ *
+ * @return The number of bytes sent.
+ */
+s32 sceKernelKprintfDrain(u32 maxSize);
+
+/**
+ * Gets the state of the Kprintf() buffer.
+ *
+ * @param stats Receives the statistics.
+ *
+ * @return 0 on success, 0x80000103 if stats is NULL.
+ */
+s32 sceKernelKprintfGetBufferStats(SceKernelKprintfBufferStats *stats);
+
+/**
+ * Prints the allocations recorded by a sysmem built with SYSMEM_TRACE, in the format read by utils/sysmem-trace.
+ *
+ * @return 0 on success, 0x80020001 if sysmem was built without tracing.
+ */
+s32 sceKernelPrintSysmemTrace(void);
 
 int sceKernelDipsw(u32 reg);
 u32 sceKernelDipswAll();
@@ -30,7 +30,7 @@ typedef struct {
     s32 (*CompareSubType)(u32 tag); //84
     u32 (*CompareLatestSubType)(u32 tag); //88
     s32 (*SetMaskFunction)(u32 unk1, vs32 *addr); //92
-    void (*Kprintf)(const char *fmt, ...); //96 -- set by sysmem (from utopia)
+    int (*Kprintf)(const char *fmt, ...); //96 -- set by sysmem (from utopia)
     s32 (*GetLengthFunction)(u8 *file, u32 size, u32 *newSize); //100 -- set in kactivate before booting loadcore (from utopia)
     s32 (*PrepareGetLengthFunction)(u8 *buf, u32 size); //104
     SceResidentLibraryEntryTable *userLibs[3]; //108 
@@ -155,6 +155,16 @@ typedef struct SceSysmemHeapBlock {
     // followed by lowheap
 } SceSysmemHeapBlock;
 
+/** The heap can grow by allocating new blocks in its partition. */
+#define SCE_KERNEL_HEAP_ATTR_GROWABLE       (1)
+/** The heap blocks are allocated from the top of the partition. */
+#define SCE_KERNEL_HEAP_ATTR_HIGHMEM        (2)
+/**
+ * Small freed blocks (up to 256 bytes) are kept in small bounded per-size-class caches and reused directly
+ * by the next allocation of the same size class, instead of walking the lowheap free list.
+ */
+#define SCE_KERNEL_HEAP_ATTR_SEGREGATED     (4)
+
 SceUID sceKernelCreateHeap(SceUID mpid, SceSize size, int flag, const char *name);
 
 typedef struct {
@@ -172,6 +182,49 @@ typedef struct {
 
 int sceKernelQueryHeapInfo(SceUID id, SceSysmemHeapInfo *info);
 
+typedef struct {
+    SceSize size; // 0
+    u32 cacheHits; // 4: allocations served by a size class cache
+    u32 cacheMisses; // 8: cacheable allocations which found their size class cache empty
+    u32 cacheRefills; // 12: number of times several blocks were put in a size class cache at once
+    u32 cachedBlocks; // 16: blocks currently kept in the size class caches
+    u32 ringLength; // 20: number of partition blocks currently used by the heap
+    u32 allocCount; // 24: allocations which had to walk the blocks ring
+    u32 allocWalks; // 28: lowheaps tried by these allocations
+    u32 releasedBlocks; // 32: grown blocks given back to the partition
+} SceSysmemHeapStats;
+
+/**
+ * Gets the size class cache statistics of a heap created with SCE_KERNEL_HEAP_ATTR_SEGREGATED.
+ *
+ * @param id The heap UID.
+ * @param stats The structure receiving the statistics; its size field must be set beforehand.
+ *
+ * @return 0 on success, less than 0 otherwise.
+ */
+s32 sceKernelQueryHeapStats(SceUID id, SceSysmemHeapStats *stats);
+
+/**
+ * Sets how many empty blocks a growable heap keeps instead of giving them back to the partition, so a workload
+ * oscillating around a block boundary doesn't allocate and release a partition block each time. Defaults to 0.
+ *
+ * @param id The heap UID.
+ * @param maxEmptyBlocks The number of empty blocks to keep.
+ *
+ * @return 0 on success, less than 0 otherwise.
+ */
+s32 sceKernelSetHeapTrimThreshold(SceUID id, u32 maxEmptyBlocks);
+
+/**
+ * Gives back to the partition all the empty blocks of a heap, including the ones kept by the trim threshold
+ * and the ones only holding cached small blocks.
+ *
+ * @param id The heap UID.
+ *
+ * @return The number of blocks released on success, less than 0 otherwise.
+ */
+s32 sceKernelHeapCompact(SceUID id);
+
 typedef struct SceSysmemLowheapInfoBlock {
     SceSysmemLowheapBlock *block;
     u32 offset;
@@ -282,6 +335,61 @@ typedef struct {
 } SceSysmemMemoryBlockInfo;
 
 s32 sceKernelResizeMemoryBlock(SceUID id, s32 leftShift, s32 rightShift);
+
+/**
+ * Change the size of a memory block. The block grows in place if the memory following it is free, otherwise its
+ * content is moved to a new area of the same partition.
+ *
+ * @param id The UID of the memory block, which is kept.
+ * @param size The new size of the block.
+ *
+ * @return 0 on success, 0x800200DA if the block size is locked, 0x800200D9 if there isn't enough memory.
+ */
+s32 sceKernelReallocPartitionMemory(SceUID id, u32 size);
+
+/**
+ * A handler called when a partition runs out of memory.
+ *
+ * @param size The size which is missing, in bytes.
+ * @param param The parameter given at registration.
+ *
+ * @return Non-zero if memory was released, 0 otherwise.
+ */
+typedef u32 (*SceSysmemReclaimHandler)(u32 size, void *param);
+
+/**
+ * Register a handler releasing memory, like cached data, when an allocation fails in a partition or leaves less free
+ * memory than its watermark. The handlers run with the interrupts suspended, from the lowest to the highest cost,
+ * until the allocation succeeds.
+ *
+ * @param mpid The partition the handler releases memory from.
+ * @param handler The handler.
+ * @param cost The cost of releasing memory with this handler, compared to the other handlers.
+ * @param param A parameter given to the handler.
+ *
+ * @return 0 on success, 0x800200D6 if the partition doesn't exist, 0x80020001 if too many handlers are registered.
+ */
+s32 sceKernelRegisterReclaimHandler(s32 mpid, SceSysmemReclaimHandler handler, u32 cost, void *param);
+
+/**
+ * Unregister a handler registered with sceKernelRegisterReclaimHandler().
+ *
+ * @param handler The handler.
+ * @param param The parameter it was registered with.
+ *
+ * @return 0 on success, 0x80020001 if the handler isn't registered.
+ */
+s32 sceKernelUnregisterReclaimHandler(SceSysmemReclaimHandler handler, void *param);
+
+/**
+ * Set the free memory size of a partition below which the reclaim handlers are called after an allocation.
+ *
+ * @param mpid The partition.
+ * @param size The size, 0 to only call the handlers when an allocation fails.
+ *
+ * @return 0 on success, 0x800200D6 if the partition doesn't exist.
+ */
+s32 sceKernelSetPartitionWatermark(s32 mpid, u32 size);
 s32 sceKernelJointMemoryBlock(SceUID id1, SceUID id2);
 s32 sceKernelSeparateMemoryBlock(SceUID id, u32 cutBefore, u32 size);
 s32 sceKernelQueryMemoryBlockInfo(SceUID id, SceSysmemMemoryBlockInfo *infoPtr);
@@ -377,6 +485,12 @@ s32 sceKernelGetUIDcontrolBlock(SceUID id, SceSysmemUidCB **uidOut);
 s32 sceKernelGetUIDcontrolBlockWithType(SceUID id, SceSysmemUidCB *type, SceSysmemUidCB **outUid);
 s32 sceKernelIsKindOf(SceSysmemUidCB *uid, SceSysmemUidCB *type);
 s32 sceKernelPrintUidListAll(void);
+/**
+ * Prints the UID method cache hit and miss counts, globally and per type.
+ *
+ * @return 0.
+ */
+s32 sceKernelPrintUidFuncCache(void);
 
 typedef struct {
     SceSysmemUidCB *root; // 0
@@ -33,6 +33,7 @@ u64 __umoddi3(u64 arg01, u64 arg23);
 void *memchr(const void *s, int c, int n);
 int memcmp(const void *s1, const void *s2, int n);
 void *memcpy(void *dst, const void *src, u32 n);
+void *sceKernelFillBlock(void *dst, u32 c, u32 size);
 void *memmove(void *dst, const void *src, int n);
 int prnt(prnt_callback cb, void *ctx, const char *fmt, va_list args);
 int sprintf(char *str, const char *format, ...);
@@ -18,14 +18,41 @@ typedef struct SceSysEventHandler {
     s32 gp;
     SceBool busy;
     struct SceSysEventHandler *next;
+    /* Owned by sysmem while the handler is registered, must be zeroed before the first registration. */
     s32 reserved[9];
 } SceSysEventHandler;
 
+/** The priority given to the handlers registered with sceKernelRegisterSysEventHandler(). */
+#define SCE_SYSEVENT_DEFAULT_PRIORITY   0
+
+/** The duration, in CPU cycles, of the last call to a registered handler. */
+#define SCE_SYSEVENT_HANDLER_LAST_TIME(handler)     ((u32)(handler)->reserved[6])
+/** The longest duration, in CPU cycles, of a call to a registered handler. */
+#define SCE_SYSEVENT_HANDLER_MAX_TIME(handler)      ((u32)(handler)->reserved[7])
+
 s32 sceKernelUnregisterSysEventHandler(SceSysEventHandler *handler);
 s32 sceKernelSysEventDispatch(s32 eventTypeMask, s32 eventId, char *eventName, void *param, s32 *result, s32 break_nonzero, 
                               SceSysEventHandler **break_handler);
 s32 sceKernelSysEventInit(void);
 s32 sceKernelIsRegisterSysEventHandler(SceSysEventHandler *handler);
 s32 sceKernelRegisterSysEventHandler(SceSysEventHandler *handler);
+
+/**
+ * Register a system event handler with a dispatch priority.
+ *
+ * @param handler The handler to register.
+ * @param priority The priority of the handler. Handlers with a lower value are called first, and a handler
+ * is called before the ones of the same priority registered earlier.
+ *
+ * @return 0 on success, 0x80020067 if the handler is already registered.
+ */
+s32 sceKernelRegisterSysEventHandlerWithPriority(SceSysEventHandler *handler, s32 priority);
 SceSysEventHandler *sceKernelReferSysEventHandler(void);
 
+/**
+ * Print the name and the last and longest call durations of every registered handler.
+ *
+ * @return 0.
+ */
+s32 sceKernelSysEventPrintTimes(void);
+
@@ -2,6 +2,9 @@
    See the file COPYING for copying permission.
 */
 
+#ifndef SYSMEM_UTILS_KERNEL_H
+#define SYSMEM_UTILS_KERNEL_H
+
 #include "common_header.h"
 
 int UtilsForKernel_6C6887EE(void *outBuf, int outSize, void *inBuf, void **end);
@@ -23,9 +26,170 @@ int sceKernelRtcGetTick(u64 *tick);
 
 int sceKernelUtilsMd5Digest(u8 *data, u32 size, u8 *digest);
 
+/** A buffer to hash with sceKernelUtilsMd5DigestBatch() or sceKernelUtilsSha1DigestBatch(). */
+typedef struct {
+    /** The data to hash. */
+    const u8 *data;
+    /** The size of the data. */
+    u32 size;
+    /** Receives the digest (16 bytes for MD5, 20 bytes for SHA-1). */
+    u8 *digest;
+} SceKernelUtilsDigestEntry;
+
+/**
+ * Computes the MD5 digests of several independent buffers.
+ *
+ * @param entries The buffers and their digest destinations.
+ * @param count The number of entries.
+ *
+ * @return 0 on success, otherwise < 0.
+ */
+s32 sceKernelUtilsMd5DigestBatch(const SceKernelUtilsDigestEntry *entries, u32 count);
+
+/**
+ * Computes the SHA-1 digests of several independent buffers.
+ *
+ * @param entries The buffers and their digest destinations.
+ * @param count The number of entries.
+ *
+ * @return 0 on success, otherwise < 0.
+ */
+s32 sceKernelUtilsSha1DigestBatch(const SceKernelUtilsDigestEntry *entries, u32 count);
+
 int sceKernelGzipDecompress(u8 *dest, u32 destSize, const void *src, u32 *unk);
 
+/** Distance up to which the deflate format can refer to the data already decompressed. */
+#define SCE_KERNEL_DEFLATE_WINDOW_SIZE      32768
+
+/** The output buffer of a deflate stream is a ring buffer. */
+#define SCE_KERNEL_DEFLATE_RING             1
+
+/** Bits of the codes decoded with a single lookup, larger codes are decoded bit by bit. */
+#define SCE_KERNEL_DEFLATE_LEN_FAST_BITS    8
+#define SCE_KERNEL_DEFLATE_DIST_FAST_BITS   6
+
+/** Decompression state of a deflate stream, see sceKernelDeflateStreamInit(). */
+typedef struct {
+    /** The next input bytes, updated as they are consumed. */
+    const u8 *in; // 0
+    /** The number of input bytes left. */
+    u32 inSize; // 4
+    /** The output buffer. */
+    u8 *window; // 8
+    /** The ring buffer size - 1, or 0xFFFFFFFF for a linear buffer. */
+    u32 windowMask; // 12
+    /** The size of a linear buffer, or 0xFFFFFFFF for a ring buffer. */
+    u32 outLimit; // 16
+    /** The total number of bytes decompressed. */
+    u32 outPos; // 20
+    /* The fields below are private to the decoder. */
+    u32 state; // 24
+    u32 final; // 28
+    u64 bitBuf; // 32
+    u32 bitCount; // 40
+    u32 len; // 44
+    u32 dist; // 48
+    u32 nlen; // 52
+    u32 ndist; // 56
+    u32 ncode; // 60
+    u32 index; // 64
+    u16 lenCount[16]; // 68
+    u16 lenSymbol[288]; // 100
+    u16 lenFast[1 << SCE_KERNEL_DEFLATE_LEN_FAST_BITS]; // 676
+    u16 distCount[16]; // 1188
+    u16 distSymbol[32]; // 1220
+    u16 distFast[1 << SCE_KERNEL_DEFLATE_DIST_FAST_BITS]; // 1284
+    u8 lengths[320]; // 1412
+} SceKernelDeflateStream; // size: 1736
+
+/**
+ * Decompresses a raw deflate stream held entirely in memory.
+ *
+ * @param dest The destination buffer.
+ * @param destSize The size of the destination buffer.
+ * @param src The compressed data.
+ * @param next If not NULL, receives the address following the compressed data.
+ *
+ * @return The decompressed size on success, 0x80000104 if it does not fit in the buffer, or 0x80000108 if the
+ * data is invalid.
+ */
+int sceKernelDeflateDecompress(u8 *dest, u32 destSize, const void *src, void **next);
+
+/**
+ * Prepares the decompression of a deflate stream whose input is provided in pieces.
+ *
+ * @param stream The stream state.
+ * @param buf The output buffer.
+ * @param size The size of the output buffer. A ring buffer must be a power of 2 of at least
+ * SCE_KERNEL_DEFLATE_WINDOW_SIZE bytes.
+ * @param attr SCE_KERNEL_DEFLATE_RING if the output buffer is a ring buffer, 0 if it receives all the output.
+ *
+ * @return 0 on success, otherwise < 0.
+ */
+s32 sceKernelDeflateStreamInit(SceKernelDeflateStream *stream, u8 *buf, u32 size, u32 attr);
+
+/**
+ * Decompresses the input available in stream->in and stream->inSize. With a ring buffer, the output bytes are
+ * at the positions (stream->outPos - *outSize) to stream->outPos (modulo the buffer size) and must be
+ * consumed before the next call, which overwrites them.
+ *
+ * @param stream The stream state.
+ * @param maxOut The maximum number of bytes to output, limited to the size of a ring buffer.
+ * @param outSize Receives the number of bytes output.
+ *
+ * @return 1 at the end of the stream, 0 when more input or output space is needed, otherwise < 0.
+ */
+s32 sceKernelDeflateStreamDecompress(SceKernelDeflateStream *stream, u32 maxOut, u32 *outSize);
+
+/** Decompression state of a gzip stream, see sceKernelGzipStreamInit(). */
+typedef struct {
+    /** The state of the compressed data decoder. */
+    SceKernelDeflateStream deflate; // 0
+    /* The fields below are private to the decoder. */
+    u32 state; // 1736
+    u32 flags; // 1740
+    /** The number of bytes in 'buf', or the number of header bytes left to skip. */
+    u32 count; // 1744
+    u32 crc32; // 1748
+    u8 buf[12]; // 1752
+} SceKernelGzipStream; // size: 1768
+
+/**
+ * Prepares the decompression of a gzip file whose content is provided in pieces.
+ *
+ * @param stream The stream state.
+ * @param dest The destination buffer.
+ * @param destSize The size of the destination buffer.
+ *
+ * @return 0 on success, otherwise < 0.
+ */
+s32 sceKernelGzipStreamInit(SceKernelGzipStream *stream, u8 *dest, u32 destSize);
+
+/**
+ * Decompresses the next piece of a gzip file. The pieces can have any size, and all their bytes are consumed.
+ *
+ * @param stream The stream state.
+ * @param src The next bytes of the file.
+ * @param size The number of bytes.
+ *
+ * @return 1 once the whole file was decompressed and its CRC32 and size verified, 0 if more input is needed,
+ * otherwise < 0.
+ */
+s32 sceKernelGzipStreamFeed(SceKernelGzipStream *stream, const void *src, u32 size);
+
+/**
+ * Ends the decompression of a gzip file.
+ *
+ * @param stream The stream state.
+ * @param crc32 If not NULL, receives the CRC32 of the decompressed data.
+ *
+ * @return The decompressed size, or 0x80000108 if the file is incomplete.
+ */
+s32 sceKernelGzipStreamFinish(SceKernelGzipStream *stream, u32 *crc32);
+
 int UtilsForKernel_39FFB756(int);
 
 int UtilsForKernel_79D1C3FA(void);
 
+#endif
+
@@ -157,6 +157,20 @@ SceUID g_UIDs[64];
 // 6C2C
 char *g_pathbufBuf[2];
 
+/*
+ * Once the thread manager is up, Kprintf() formats into a ring buffer and this module's drain thread sends the
+ * messages to the debug device, so printing doesn't make the caller wait for it.
+ */
+#define KPRINTF_BUFFER_SIZE     0x4000
+/* Lower than any user thread, so the messages are only sent when the system is idle */
+#define KPRINTF_DRAIN_PRIORITY  126
+/* Maximum size sent at once, and delay (in microseconds) before looking at an empty buffer again */
+#define KPRINTF_DRAIN_SIZE      512
+#define KPRINTF_DRAIN_DELAY     10000
+
+SceUID g_kprintfBuf = -1;
+SceUID g_kprintfThread = -1;
+
 int validate_fd(int fd, int arg1, int arg2, int arg3, SceIoIob **outIob);
 int alloc_iob(SceIoIob **outIob, int arg1);
 int init_iob(SceIoIob *iob, int devType, SceIoDeviceArg *dev, int unk, int fsNum);
@@ -198,6 +212,9 @@ SceIoAlias *lookup_alias_tbl(char *drive);
 SceIoDeviceList *lookup_device_list(const char *drive);
 void free_cwd(void *ktls);
 int async_loop(SceSize args, void *argp);
+void kprintf_buffer_init(void);
+void kprintf_buffer_exit(void);
+int kprintf_drain_loop(SceSize args, void *argp);
 
 int sceIoChangeAsyncPriority(int fd, int prio)
 {
@@ -2092,10 +2109,51 @@ int IoFileMgrInit()
     g_UIDs[0] = sceKernelStdin();
     g_UIDs[1] = sceKernelStdout();
     g_UIDs[2] = sceKernelStderr();
+    kprintf_buffer_init();
     dbg_printf("-- init finished\n");
     return 0;
 }
 
+void kprintf_buffer_init(void)
+{
+    g_kprintfBuf = sceKernelAllocPartitionMemory(1, "SceKprintfBuffer", 1, KPRINTF_BUFFER_SIZE, 0);
+    if (g_kprintfBuf < 0)
+        return;
+    g_kprintfThread = sceKernelCreateThread("SceKernelKprintfDrain", kprintf_drain_loop, KPRINTF_DRAIN_PRIORITY, 1024, 0x00100000, 0);
+    if (g_kprintfThread < 0 || sceKernelStartThread(g_kprintfThread, 0, NULL) < 0) {
+        if (g_kprintfThread >= 0)
+            sceKernelDeleteThread(g_kprintfThread);
+        sceKernelFreePartitionMemory(g_kprintfBuf);
+        g_kprintfThread = -1;
+        g_kprintfBuf = -1;
+        return;
+    }
+    sceKernelKprintfSetBuffer(sceKernelGetBlockHeadAddr(g_kprintfBuf), KPRINTF_BUFFER_SIZE);
+}
+
+/* Sends what is left in the buffer and prints directly again */
+void kprintf_buffer_exit(void)
+{
+    if (g_kprintfBuf < 0)
+        return;
+    sceKernelTerminateDeleteThread(g_kprintfThread);
+    while (sceKernelKprintfDrain(KPRINTF_BUFFER_SIZE) != 0)
+        ;
+    sceKernelKprintfSetBuffer(NULL, 0);
+    sceKernelFreePartitionMemory(g_kprintfBuf);
+    g_kprintfThread = -1;
+    g_kprintfBuf = -1;
+}
+
+int kprintf_drain_loop(SceSize args __attribute__((unused)), void *argp __attribute__((unused)))
+{
+    for (;;) {
+        if (sceKernelKprintfDrain(KPRINTF_DRAIN_SIZE) == 0)
+            sceKernelDelayThread(KPRINTF_DRAIN_DELAY);
+    }
+    return 0;
+}
+
 int IoFileMgrRebootBefore(void)
 {
     dbg_printf("Calling %s\n", __FUNCTION__);
@@ -2113,6 +2171,7 @@ int IoFileMgrRebootBefore(void)
     // 3D98
     sceKernelFreeKTLS(g_ktls);
     sceKernelDeleteHeap(g_heap);
+    kprintf_buffer_exit();
     return 0;
 }
 
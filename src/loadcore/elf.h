@@ -203,6 +203,7 @@ typedef struct
 #define SHT_NOBITS      8               /* Program space with no data (bss) */
 #define SHT_PRX_RELOC	0x700000A0		/* Relocation entries, no addends */
 #define SHT_PRX_RELOC2	0x700000A1		/* Relocation entries with addends */
+#define SHT_PRX_RELOC_RUNS	0x700000A2	/* Relocation runs (Elf32_RelRun) */
 
 
 /* Legal values for sh_flags (section flags).  */
@@ -335,6 +336,25 @@ typedef struct
 #define ELF32_R_ADDR_BASE(val)    ((val) >> 16)
 #define ELF32_R_OFS_BASE(val)     (((val) >> 8) & 0xFF)
 
+/* 
+ * Header of a run of relocations of the same type and segments, as output by psp-kprxgen -r in a
+ * SHT_PRX_RELOC_RUNS section, the PT_PRX_RELOC program header still pointing to the same relocations
+ * in the classic format.
+ * It is followed by r_count offsets into the r_ofs_base segment, sorted in increasing order, or
+ * by r_count (offset, addend) pairs for R_MIPS_HI16, the addend being the full 32-bit value
+ * built from the HI16 and its matching LO16.
+ * psp-kprxgen outputs a single loadable segment and clears the segment indexes of its classic
+ * relocations, so its runs always have r_ofs_base and r_addr_base set to 0.
+ */
+typedef struct
+{
+  u8	r_type;				/* Relocation type */
+  u8	r_ofs_base;			/* Index of the segment holding the relocated words */
+  u8	r_addr_base;		/* Index of the segment whose address is added */
+  u8	r_pad;
+  Elf32_Word	r_count;	/* Number of relocations of the run */
+} Elf32_RelRun;
+
 /* Program segment header.  */
 
 typedef struct
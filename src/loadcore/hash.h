@@ -11,6 +11,7 @@
 extern "C" {
 #endif
 
+u32 getCyclicPolynomialHashValue(const char *str, u32 radix);
 __inline__ u32 getCyclicPolynomialHash(const char *str, u32 radix, u32 hashTableSize);
 
 
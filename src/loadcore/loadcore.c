@@ -62,9 +62,20 @@ SCE_SDK_VERSION(SDK_VERSION);
 
 #define LOADCORE_HEAP_SIZE                      (4096)
 
+/* The hash table of registered libraries grows above this average chain length. */
+#define LOADCORE_LIB_HASH_TABLE_MAX_LOAD        (2)
+/* The number of slots of the previous hash table moved on every library registration. */
+#define LOADCORE_LIB_REHASH_SLOTS               (16)
+
+/* The number of slots of the hash table of unlinked stub libraries (a power of 2). */
+#define UNLINKED_STUB_LIB_HASH_TABLE_SIZE       (64)
+
 #define RESIDENT_LIBRARY_CONTROL_BLOCKS         (30)
 #define TOP_RESIDENT_LIBRARY_CONTROL_BLOCK      (RESIDENT_LIBRARY_CONTROL_BLOCKS - 1)
 
+/* Resident libraries with less exports are searched linearly. */
+#define NID_INDEX_MIN_EXPORTS                   (16)
+
 #define STUB_LIBRARY_CONTROL_BLOCKS             (90)
 #define TOP_STUB_LIBRARY_CONTROL_BLOCK          (STUB_LIBRARY_CONTROL_BLOCKS - 1)
 
@@ -194,6 +205,9 @@ static s32 aVariableLinkApply(u32 *arg1, u32 exportedVar, u32 linkOption, u32 is
 static s32 aLinkVariableStub_sub(SceResidentLibrary *lib, SceStubLibraryEntryTable *stubLibEntryTable, u32 linkOption, 
                                  u32 isUserLib);
 static s32 search_nid_in_entrytable(SceResidentLibrary *lib, u32 nid, u32 arg2, u32 nidSearchOption);
+static void CreateLibNidIndex(SceResidentLibrary *lib);
+static void SortLibNidIndex(u32 *nids, u16 *positions, u32 start, u32 end);
+static s32 SearchLibNidIndex(SceResidentLibrary *lib, u32 nid, u32 start, u32 end);
 static void SysBoot(SceLoadCoreBootInfo *bootInfo, SysMemThreadConfig *threadConfig);
 
 static void LoadCoreHeapStatic(void); //0x00002678
@@ -209,6 +223,11 @@ static void UpdateCacheRangeDataDynamic(const void *addr, u32 size); //0x0000286
 
 static s32 doRegisterLibrary(SceResidentLibraryEntryTable *libEntryTable, u32 isUserLib);
 static SceResidentLibrary **FoundLibrary(SceResidentLibraryEntryTable *libEntryTable);
+static SceResidentLibrary **GetLibHashChain(u32 hash);
+static SceStubLibrary **GetUnlinkedStubLibChain(u32 hash);
+static void UpdateCacheAll(void);
+static void RehashLibHashTable(u32 slots);
+static void GrowLibHashTable(void);
 static s32 ReleaseLibEntCB(SceResidentLibrary *lib, SceResidentLibrary **prevLibSlot);
 static s32 doLinkLibraryEntries(SceStubLibraryEntryTable *stubLibEntryTable, u32 size, u32 isUserMode, 
                                 u32 arg4 __attribute__((unused)));
@@ -276,6 +295,20 @@ static SceStubLibrary g_LoadCoreLibStubs[STUB_LIBRARY_CONTROL_BLOCKS]; //0x00008
 s32 g_SyscallIntrRegSave[7]; //0x000080C0
 static SceStubLibrary *g_FreeLibStub; //0x000080E4
 
+/* 
+ * The hash table of unlinked stub libraries living in memory, indexed by
+ * the hash of their library's name.  Registering a resident library only
+ * walks the stub libraries of its slot.
+ */
+static SceStubLibrary *g_UnlinkedStubLibs[UNLINKED_STUB_LIB_HASH_TABLE_SIZE];
+
+/* 
+ * Set while a resident library links its stub libraries.  The full cache
+ * syncs are then done once, when all of them were linked.
+ */
+static u32 g_DeferCacheAll;
+static u32 g_CacheAllPending;
+
 s32 g_ToolBreakMode; //0x000083C4
 
 /* Pointer to a memory clear function executed in StopLoadCore(). */
@@ -463,6 +496,10 @@ static SceResidentLibrary *FreeLibEntCB(SceResidentLibrary *libEntry)
         sceKernelFreeHeapMemory(g_loadCoreHeap(), libEntry->libName); 
         libEntry->libNameInHeap = SCE_FALSE;
     }       
+    if (libEntry->nidIndex != NULL) {
+        sceKernelFreeHeapMemory(g_loadCoreHeap(), libEntry->nidIndex);
+        libEntry->nidIndex = NULL;
+    }
     if (libEntry >= &g_LoadCoreLibEntries[0] && libEntry <= &g_LoadCoreLibEntries[TOP_RESIDENT_LIBRARY_CONTROL_BLOCK]) { //0x00000170 & 0x0000017C    
         libEntry->next = g_FreeLibEnt;
         g_FreeLibEnt = libEntry;
@@ -691,6 +728,14 @@ s32 loadCoreInit(SceSize argc __attribute__((unused)), void *argp)
     for (i = 0; i < LOADCORE_LIB_HASH_TABLE_SIZE; i++)
          g_loadCore.registeredLibs[i] = NULL;
     
+    g_loadCore.libHashTable = g_loadCore.registeredLibs;
+    g_loadCore.libHashTableSize = LOADCORE_LIB_HASH_TABLE_SIZE;
+    g_loadCore.oldLibHashTable = NULL;
+    g_loadCore.regLibCount = 0;
+    g_loadCore.libLookups = 0;
+    g_loadCore.libProbes = 0;
+    g_loadCore.maxLibChainLength = 0;
+    
     seedPart1 = sysMemThreadConfig->unk48 & 0x1FF; //0x00000B60 & 0x00000B6C
     
     //0x00000B78 - 0x00000BA4
@@ -700,7 +745,10 @@ s32 loadCoreInit(SceSize argc __attribute__((unused)), void *argp)
     g_loadCore.linkedLoadCoreStubs = SCE_FALSE;
     g_loadCore.sysCallTable = NULL;
     g_loadCore.unk520 = 0;
-    g_loadCore.unLinkedStubLibs = NULL;
+    for (i = 0; i < UNLINKED_STUB_LIB_HASH_TABLE_SIZE; i++)
+         g_UnlinkedStubLibs[i] = NULL;
+    
+    g_loadCore.unLinkedStubLibs = g_UnlinkedStubLibs;
     g_loadCore.registeredMods = NULL;
     g_loadCore.lastRegMod = NULL;
     g_loadCore.regModCount = 0;
@@ -829,6 +877,17 @@ static s32 search_nid_in_entrytable(SceResidentLibrary *lib, u32 nid, u32 arg2,
                  return SCE_ERROR_KERNEL_ERROR;
          }
          
+         /* 
+          * The NID index holds the NIDs of the first table, use it instead of the linear scan below. 
+          * It returns the first matching position, as the scan does.
+          */
+         if (i == 0 && lib->nidIndex != NULL) {
+             unk9 = SearchLibNidIndex(lib, nid, startIndex, endNidPos);
+             if (unk9 >= 0)
+                 return unk9 - startIndex;
+             continue;
+         }
+         
          unk14 = unk10 << 1; //0x00000F44
          if (nidCurIndex >= endNidPos) { //0x00000F44 & 0x00000F48      
              unk6 += lib->unk48; //0x00000F04 & 0x00000F84 & 0x00000F88
@@ -844,7 +903,7 @@ static s32 search_nid_in_entrytable(SceResidentLibrary *lib, u32 nid, u32 arg2,
          while (nidCurIndex++ < endNidPos) {
                 if (*curNidPtr == nid) { //0x00000F60
                     if (i == 0) //0x00000FB0
-                        return nidCurIndex - startIndex; //0x00000FB4
+                        return nidCurIndex - 1 - startIndex; //0x00000FB4
 
                     unk9 = lib->numExports << 2; //0x00000FBC
                     unk9 = (u32)(entryTable + unk9); //0x00000FC0
@@ -858,6 +917,97 @@ static s32 search_nid_in_entrytable(SceResidentLibrary *lib, u32 nid, u32 arg2,
     return SCE_ERROR_KERNEL_ERROR;
 }
 
+/*
+ * Create the NID index of a resident library, sorting its function and variable 
+ * NIDs so they can be binary searched.  The index is optional: it isn't created 
+ * for small libraries, before Loadcore's heap is available or when the allocation 
+ * fails, in which case the NIDs are searched linearly.
+ */
+static void CreateLibNidIndex(SceResidentLibrary *lib)
+{
+    u32 i;
+    u32 *nids;
+    u16 *positions;
+    
+    lib->nidIndex = NULL;
+    if (lib->numExports < NID_INDEX_MIN_EXPORTS || g_loadCoreHeap != LoadCoreHeapDynamic)
+        return;
+    
+    nids = sceKernelAllocHeapMemory(g_loadCoreHeap(), lib->numExports * (sizeof(u32) + sizeof(u16)));
+    if (nids == NULL)
+        return;
+    
+    positions = (u16 *)&nids[lib->numExports];
+    for (i = 0; i < lib->numExports; i++) {
+         nids[i] = lib->entryTable[i];
+         positions[i] = i;
+    }
+    SortLibNidIndex(nids, positions, 0, lib->stubCount);
+    SortLibNidIndex(nids, positions, lib->stubCount, lib->numExports);
+    
+    lib->nidIndex = nids;
+}
+
+/* Sort a range of the NID index by NID, then by position (Shell sort). */
+static void SortLibNidIndex(u32 *nids, u16 *positions, u32 start, u32 end)
+{
+    u32 gap;
+    u32 i;
+    u32 j;
+    u32 nid;
+    u16 pos;
+    
+    for (gap = 1; gap < (end - start) / 3; gap = gap * 3 + 1)
+         ;
+    
+    for (; gap > 0; gap /= 3) {
+         for (i = start + gap; i < end; i++) {
+              nid = nids[i];
+              pos = positions[i];
+              for (j = i; j >= start + gap && (nids[j - gap] > nid || (nids[j - gap] == nid && 
+                positions[j - gap] > pos)); j -= gap) {
+                   nids[j] = nids[j - gap];
+                   positions[j] = positions[j - gap];
+              }
+              nids[j] = nid;
+              positions[j] = pos;
+         }
+    }
+}
+
+/* 
+ * Search a NID in a range of the NID index of a resident library.
+ * 
+ * Returns the lowest entry table position of the NID, or SCE_ERROR_KERNEL_ERROR
+ * if it isn't in the range.
+ */
+static s32 SearchLibNidIndex(SceResidentLibrary *lib, u32 nid, u32 start, u32 end)
+{
+    u32 low;
+    u32 high;
+    u32 mid;
+    u32 *nids;
+    u16 *positions;
+    
+    nids = lib->nidIndex;
+    positions = (u16 *)&nids[lib->numExports];
+    
+    /* Find the first entry which is not lower than the NID. */
+    low = start;
+    high = end;
+    while (low < high) {
+        mid = (low + high) >> 1;
+        if (nids[mid] < nid)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low < end && nids[low] == nid)
+        return positions[low];
+    
+    return SCE_ERROR_KERNEL_ERROR;
+}
+
 //Subroutine LoadCoreForKernel_48AF96A9 - Address 0x00000FE4
 s32 sceKernelRegisterLibrary(SceResidentLibraryEntryTable *libEntryTable) 
 {
@@ -874,9 +1024,8 @@ s32 sceKernelCanReleaseLibrary(SceResidentLibraryEntryTable *libEntryTable)
    
    intrState = loadCoreCpuSuspendIntr(); //0x00001014 
   
-   index = getCyclicPolynomialHash(libEntryTable->libName, LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX, 
-                                   LOADCORE_LIB_HASH_TABLE_SIZE);  
-   for (curLib = g_loadCore.registeredLibs[index]; curLib; curLib = curLib->next) {
+   index = getCyclicPolynomialHashValue(libEntryTable->libName, LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX);  
+   for (curLib = *GetLibHashChain(index); curLib; curLib = curLib->next) {
         if (curLib->libEntryTable != libEntryTable) //0x00001090
             continue;
         
@@ -1156,9 +1305,9 @@ static void SysBoot(SceLoadCoreBootInfo *bootInfo, SysMemThreadConfig *threadCon
                   if (curExportTable->attribute & SCE_LIB_AUTO_EXPORT) {                
                       intrState = loadCoreCpuSuspendIntr(); //0x00001F80
                    
-                      i = getCyclicPolynomialHash(curExportTable->libName, LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX, 
-                                                      LOADCORE_LIB_HASH_TABLE_SIZE);                   
-                      for (curLib = g_loadCore.registeredLibs[i], prevLibPtr = &g_loadCore.registeredLibs[i]; curLib; 
+                      prevLibPtr = GetLibHashChain(getCyclicPolynomialHashValue(curExportTable->libName, 
+                                                                                LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX));
+                      for (curLib = *prevLibPtr; curLib; 
                          prevLibPtr = &curLib->next, curLib = curLib->next) { //0x00001FF0 - 0x00002014
                            if (curLib->libEntryTable == curExportTable) //0x00002000
                                break;
@@ -1214,9 +1363,9 @@ static void SysBoot(SceLoadCoreBootInfo *bootInfo, SysMemThreadConfig *threadCon
                      if ((curExportTable->attribute & SCE_LIB_AUTO_EXPORT) == SCE_LIB_AUTO_EXPORT) { //0x00001CBC
                           intrState = loadCoreCpuSuspendIntr(); //0x00001D28
                           
-                          i = getCyclicPolynomialHash(curExportTable->libName, LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX, 
-                                                          LOADCORE_LIB_HASH_TABLE_SIZE); //0x00001D30 - 0x00001D90                          
-                          for (curLib = g_loadCore.registeredLibs[i], prevLibPtr = &g_loadCore.registeredLibs[i]; curLib; 
+                          prevLibPtr = GetLibHashChain(getCyclicPolynomialHashValue(curExportTable->libName, 
+                                                                                    LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX)); //0x00001D30 - 0x00001D90                          
+                          for (curLib = *prevLibPtr; curLib; 
                              prevLibPtr = &curLib->next, curLib = curLib->next) { //0x00001D98 - 0x00001DB8
                                if (curLib->libEntryTable == curExportTable) //0x00001DA8
                                    break;
@@ -1487,8 +1636,8 @@ static s32 doRegisterLibrary(SceResidentLibraryEntryTable *libEntryTable, u32 is
     SceStubLibrary *nextStubLib = NULL;
     SceStubLibrary **stubLibPtr = NULL;
     SceStubLibrary *curUnlinkedStubLib = NULL;
-    SceStubLibrary *prevUnlinkedStubLib = NULL;
-    SceStubLibrary *nextUnlinkedStubLib = NULL;
+    SceStubLibrary **unlinkedStubLibPtr = NULL;
+    SceResidentLibrary **libSlot = NULL;
     s32 status;
     u32 i;
     u32 index;  
@@ -1519,17 +1668,17 @@ static s32 doRegisterLibrary(SceResidentLibraryEntryTable *libEntryTable, u32 is
         return SCE_ERROR_KERNEL_ERROR;
     }
     
-    index = getCyclicPolynomialHash(libEntryTable->libName, LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX, 
-                                    LOADCORE_LIB_HASH_TABLE_SIZE);   
+    g_loadCore.libLookups++;
     //0x00002968 & 0x000029E4
-    for (curLib = g_loadCore.registeredLibs[index]; curLib != NULL; curLib = curLib->next) {
+    for (curLib = *GetLibHashChain(nLib->libNameHash); curLib != NULL; curLib = curLib->next) {
+         g_loadCore.libProbes++;
          
         /*
          * Check if the library registration is needed.
          * Step 1: Check if a version of the to-be-registered library is
          *         already registered.
          */
-         if (strcmp(nLib->libName, curLib->libName) != 0) //0x00002980
+         if (curLib->libNameHash != nLib->libNameHash || strcmp(nLib->libName, curLib->libName) != 0) //0x00002980
              continue; 
          
          /*
@@ -1641,6 +1790,8 @@ static s32 doRegisterLibrary(SceResidentLibraryEntryTable *libEntryTable, u32 is
         }
     }
         
+    CreateLibNidIndex(nLib);
+    
     //0x00002B2C - 0x00002B74
     /*
      * Find all unlinked loaded stub libraries dependant on the
@@ -1648,37 +1799,40 @@ static s32 doRegisterLibrary(SceResidentLibraryEntryTable *libEntryTable, u32 is
      * containing unlinked stub libraries living in memory and create a 
      * new linked list of all these stub libraries going to be linked 
      * with the resident library to resolve external references.  Integrate
-     * an unlinked stub library into the newly created linked list.
+     * an unlinked stub library into the newly created linked list.  Only the
+     * stub libraries with the same name hash have to be checked.
      */
-    for (curUnlinkedStubLib = g_loadCore.unLinkedStubLibs; curUnlinkedStubLib; prevUnlinkedStubLib = curUnlinkedStubLib, 
-       curUnlinkedStubLib = nextUnlinkedStubLib) {
-         if (strcmp(curUnlinkedStubLib->libName, nLib->libName) != 0) { //0x00002B40
-             nextUnlinkedStubLib = curUnlinkedStubLib->next;
+    unlinkedStubLibPtr = GetUnlinkedStubLibChain(nLib->libNameHash);
+    for (curUnlinkedStubLib = *unlinkedStubLibPtr; curUnlinkedStubLib; curUnlinkedStubLib = *unlinkedStubLibPtr) {
+         if (curUnlinkedStubLib->libNameHash != nLib->libNameHash 
+           || strcmp(curUnlinkedStubLib->libName, nLib->libName) != 0) { //0x00002B40
+             unlinkedStubLibPtr = &curUnlinkedStubLib->next;
              continue;
          }
          if (nLib->isUserLib && !curUnlinkedStubLib->isUserLib) { //0x00002B4C & 0x00002B58
-             nextUnlinkedStubLib = curUnlinkedStubLib->next;
+             unlinkedStubLibPtr = &curUnlinkedStubLib->next;
              continue;
          }                            
-         prevUnlinkedStubLib->next = curUnlinkedStubLib->next;
-         nextUnlinkedStubLib = prevUnlinkedStubLib->next;         
+         *unlinkedStubLibPtr = curUnlinkedStubLib->next;
          
          curUnlinkedStubLib->next = updatableStubLib;
          updatableStubLib = curUnlinkedStubLib;    
     }         
         
     nLib->stubLibs = NULL;
+    g_DeferCacheAll = SCE_TRUE;
     //0x00002B7C - 0x00002BE0 
     /*
      * Link the stub libraries of the newly created linked list with the
-     * resident library.
+     * resident library.  The stub libraries linking variables need a full
+     * cache sync, which is done once after the loop.
      */
     for (; updatableStubLib; updatableStubLib = updatableStubLib->next) {
          aLinkClient(updatableStubLib, nLib); //0x00002B9C
          if (updatableStubLib->vStubCount == 0) //0x00002BA8
              g_UpdateCacheRange(updatableStubLib->stubTable, updatableStubLib->stubCount << 3); //0x00002D18
          else
-             g_UpdateCacheAll(); //0x00002BB4
+             UpdateCacheAll(); //0x00002BB4
 
          if (strcmp(MEMLMD_MODULE_NAME, updatableStubLib->libName) == 0) { //0x00002BC4
              g_ToolBreakMode = sceKernelDipsw(30); //0x00002CA4
@@ -1695,16 +1849,29 @@ static s32 doRegisterLibrary(SceResidentLibraryEntryTable *libEntryTable, u32 is
          updatableStubLib->next = nLib->stubLibs; //0x00002BD8
          nLib->stubLibs = updatableStubLib;
     }
+    g_DeferCacheAll = SCE_FALSE;
+    if (g_CacheAllPending) {
+        g_CacheAllPending = SCE_FALSE;
+        g_UpdateCacheAll();
+    }
     nLib->attribute &= ~STUB_LIBRARY_LINKED; //0x00002BF4
     
     /* 
      * Add the created resident library into a linked list of libraries 
      * having the same hash value.
      */
-    index = getCyclicPolynomialHash(libEntryTable->libName, LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX, 
-                                    LOADCORE_LIB_HASH_TABLE_SIZE);    
-    nLib->next = g_loadCore.registeredLibs[index];
-    g_loadCore.registeredLibs[index] = nLib;
+    RehashLibHashTable(LOADCORE_LIB_REHASH_SLOTS);
+    g_loadCore.regLibCount++;
+    GrowLibHashTable();
+    
+    libSlot = GetLibHashChain(nLib->libNameHash);
+    nLib->next = *libSlot;
+    *libSlot = nLib;
+    
+    for (i = 0, curLib = nLib; curLib != NULL; curLib = curLib->next)
+         i++;
+    if (i > g_loadCore.maxLibChainLength)
+        g_loadCore.maxLibChainLength = i;
     
     loadCoreCpuResumeIntr(intrState);   
     return SCE_ERROR_OK;
@@ -1733,6 +1900,7 @@ static s32 ReleaseLibEntCB(SceResidentLibrary *lib, SceResidentLibrary **prevLib
     SceStubLibrary *curStubLib = NULL;
     SceStubLibrary *nextStubLib = NULL;
     SceStubLibrary **stubLibPtr = NULL;
+    SceStubLibrary **unlinkedStubLibPtr = NULL;
     
     stubLibPtr = &lib->stubLibs; //0x00002E18
 
@@ -1743,8 +1911,9 @@ static s32 ReleaseLibEntCB(SceResidentLibrary *lib, SceResidentLibrary **prevLib
                  continue;
             
              nextStubLib = curStubLib->next; //0x00002E38
-             curStubLib->next = g_loadCore.unLinkedStubLibs; //0x00002E3C
-             g_loadCore.unLinkedStubLibs = curStubLib; //0x00002E44
+             unlinkedStubLibPtr = GetUnlinkedStubLibChain(curStubLib->libNameHash);
+             curStubLib->next = *unlinkedStubLibPtr; //0x00002E3C
+             *unlinkedStubLibPtr = curStubLib; //0x00002E44
 
              //0x00002E58 - 0x00002E70
              for (i = 0; i < curStubLib->stubCount; i++) {
@@ -1771,6 +1940,7 @@ static s32 ReleaseLibEntCB(SceResidentLibrary *lib, SceResidentLibrary **prevLib
     curStubLib = lib->stubLibs; //0x00002EE0
     
     *prevLibSlot = lib->next; //0x00002EE8
+    g_loadCore.regLibCount--;
     lib->stubLibs = NULL; //0x00002EEC
     lib->next = NULL; //0x00002EF4
      
@@ -1789,9 +1959,10 @@ static s32 ReleaseLibEntCB(SceResidentLibrary *lib, SceResidentLibrary **prevLib
               curStubLib->stubTable[i].dc.call = JR_RA;
               curStubLib->stubTable[i].dc.delaySlot = NOP;
          }
-         curStubLib->next = g_loadCore.unLinkedStubLibs->next;
+         unlinkedStubLibPtr = GetUnlinkedStubLibChain(curStubLib->libNameHash);
+         curStubLib->next = *unlinkedStubLibPtr;
          curStubLib->status = (curStubLib->status & ~STUB_LIBRARY_LINKED) | 0x4; //0x00002F64
-         g_loadCore.unLinkedStubLibs->next = curStubLib; //0x00002F68      
+         *unlinkedStubLibPtr = curStubLib; //0x00002F68      
     }
     return SCE_ERROR_OK;
 }
@@ -1806,20 +1977,127 @@ static s32 ReleaseLibEntCB(SceResidentLibrary *lib, SceResidentLibrary **prevLib
  */
 static SceResidentLibrary **FoundLibrary(SceResidentLibraryEntryTable *libEntryTable)
 {
-    u32 index;
     SceResidentLibrary *curLib = NULL; 
     SceResidentLibrary **prevLib = NULL;
     
-    index = getCyclicPolynomialHash(libEntryTable->libName, LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX, 
-                                                            LOADCORE_LIB_HASH_TABLE_SIZE);
-    for (curLib = g_loadCore.registeredLibs[index], prevLib = &g_loadCore.registeredLibs[index]; curLib; 
-       prevLib = &curLib->next, curLib = curLib->next) {
+    prevLib = GetLibHashChain(getCyclicPolynomialHashValue(libEntryTable->libName, 
+                                                           LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX));
+    for (curLib = *prevLib; curLib; prevLib = &curLib->next, curLib = curLib->next) {
          if (curLib->libEntryTable == libEntryTable) 
              return prevLib;
     }    
     return NULL;
 }
 
+/*
+ * Get the hash chain of registered resident libraries having the
+ * specified name hash.  While the hash table is being rehashed, 
+ * the chain is in the previous table if its slot wasn't moved yet.
+ * 
+ * Returns the address of the first slot of the chain.
+ */
+static SceResidentLibrary **GetLibHashChain(u32 hash)
+{
+    u32 index;
+    
+    if (g_loadCore.oldLibHashTable != NULL) {
+        index = hash & (g_loadCore.oldLibHashTableSize - 1);
+        if (index >= g_loadCore.libRehashIndex)
+            return &g_loadCore.oldLibHashTable[index];
+    }
+    return &g_loadCore.libHashTable[hash & (g_loadCore.libHashTableSize - 1)];
+}
+
+/*
+ * Move the libraries of up to "slots" slots of the previous hash 
+ * table to the current one, keeping the order of the chains.  The 
+ * previous table is freed once all of its slots were moved.
+ */
+static void RehashLibHashTable(u32 slots)
+{
+    SceResidentLibrary *curLib;
+    SceResidentLibrary *nextLib;
+    SceResidentLibrary **libSlot;
+    
+    for (; slots > 0 && g_loadCore.oldLibHashTable != NULL; slots--) {
+         for (curLib = g_loadCore.oldLibHashTable[g_loadCore.libRehashIndex]; curLib; curLib = nextLib) {
+              nextLib = curLib->next;
+              
+              libSlot = &g_loadCore.libHashTable[curLib->libNameHash & (g_loadCore.libHashTableSize - 1)];
+              while (*libSlot != NULL)
+                  libSlot = &(*libSlot)->next;
+              
+              *libSlot = curLib;
+              curLib->next = NULL;
+         }
+         g_loadCore.oldLibHashTable[g_loadCore.libRehashIndex++] = NULL;
+         
+         if (g_loadCore.libRehashIndex == g_loadCore.oldLibHashTableSize) {
+             if (g_loadCore.oldLibHashTable != g_loadCore.registeredLibs)
+                 sceKernelFreeHeapMemory(g_loadCoreHeap(), g_loadCore.oldLibHashTable);
+             
+             g_loadCore.oldLibHashTable = NULL;
+         }
+    }
+}
+
+/*
+ * Double the size of the hash table of registered resident libraries 
+ * when the average chain length is too long.  The libraries are moved 
+ * to the new table by the next registrations.  The table keeps its size
+ * before Loadcore's heap is available or when the allocation fails.
+ */
+static void GrowLibHashTable(void)
+{
+    u32 i;
+    u32 size;
+    SceResidentLibrary **libHashTable;
+    
+    if (g_loadCore.regLibCount <= g_loadCore.libHashTableSize * LOADCORE_LIB_HASH_TABLE_MAX_LOAD 
+      || g_loadCoreHeap != LoadCoreHeapDynamic)
+        return;
+    
+    /* Finish the previous rehash first. */
+    RehashLibHashTable(g_loadCore.oldLibHashTableSize);
+    
+    size = g_loadCore.libHashTableSize << 1;
+    libHashTable = sceKernelAllocHeapMemory(g_loadCoreHeap(), size * sizeof(SceResidentLibrary *));
+    if (libHashTable == NULL)
+        return;
+    
+    for (i = 0; i < size; i++)
+         libHashTable[i] = NULL;
+    
+    g_loadCore.oldLibHashTable = g_loadCore.libHashTable;
+    g_loadCore.oldLibHashTableSize = g_loadCore.libHashTableSize;
+    g_loadCore.libRehashIndex = 0;
+    g_loadCore.libHashTable = libHashTable;
+    g_loadCore.libHashTableSize = size;
+}
+
+/*
+ * Get the chain of unlinked stub libraries having the specified name hash.
+ * 
+ * Returns the address of the first slot of the chain.
+ */
+static SceStubLibrary **GetUnlinkedStubLibChain(u32 hash)
+{
+    return &g_loadCore.unLinkedStubLibs[hash & (UNLINKED_STUB_LIB_HASH_TABLE_SIZE - 1)];
+}
+
+/* 
+ * Sync the whole cache, or only remember to do it when a resident 
+ * library's registration is linking its stub libraries.
+ */
+static void UpdateCacheAll(void)
+{
+    if (g_DeferCacheAll) {
+        g_CacheAllPending = SCE_TRUE;
+        return;
+    }
+    g_UpdateCacheAll();
+}
+
 //sub_00003080
 /*
  * Link stub library entry tables with their corresponding resident libraries.
@@ -1836,8 +2114,9 @@ static s32 doLinkLibraryEntries(SceStubLibraryEntryTable *stubLibEntryTable, u32
     void *stubTableMemRange;
     SceStubLibrary *stubLib;
     SceStubLibrary *curUnlinkedStubLib;
+    SceStubLibrary **unlinkedStubLibPtr;
     
-    stubTableMemRange = stubLibEntryTable + size; //0x00003088
+    stubTableMemRange = (void *)stubLibEntryTable + size; //0x00003088
     for (curStubTable = stubLibEntryTable; curStubTable < stubTableMemRange; 
        curStubTable += ((SceStubLibraryEntryTable *)curStubTable)->len * sizeof(u32)) {       
          stubLib = NewLibStubCB(); //0x000030D8
@@ -1876,16 +2155,18 @@ static s32 doLinkLibraryEntries(SceStubLibraryEntryTable *stubLibEntryTable, u32
           * instance.  Otherwise, it is added to the linked-list.
           */
          dupStubLib = SCE_FALSE;
-         for (curUnlinkedStubLib = g_loadCore.unLinkedStubLibs; curUnlinkedStubLib; 
+         unlinkedStubLibPtr = GetUnlinkedStubLibChain(stubLib->libNameHash);
+         for (curUnlinkedStubLib = *unlinkedStubLibPtr; curUnlinkedStubLib; 
             curUnlinkedStubLib = curUnlinkedStubLib->next) {              
               if (curUnlinkedStubLib->libStubTable == stubLib->libStubTable) { //0x00003194
                   FreeLibStubCB(stubLib); //0x00003204
                   dupStubLib = SCE_TRUE; //0x0000320C
+                  break;
               }
          }
          if (dupStubLib == SCE_FALSE) {
-             stubLib->next = g_loadCore.unLinkedStubLibs; //0x000031B4
-             g_loadCore.unLinkedStubLibs = stubLib; //0x000031BC
+             stubLib->next = *unlinkedStubLibPtr; //0x000031B4
+             *unlinkedStubLibPtr = stubLib; //0x000031BC
              
              //0x000031B8 - 0x000031D8
              for (i = 0; i < stubLib->stubCount; i++) {
@@ -1923,11 +2204,11 @@ static s32 UnLinkLibraryEntry(SceStubLibraryEntryTable *stubLibEntryTable)
     SceStubLibrary *prevStubLib;
     SceStubLibrary *curUnlinkedStubLib;
     SceStubLibrary **prevUnlinkedStubLibPtr;    
+    u32 hash;
     
-    i = getCyclicPolynomialHash(stubLibEntryTable->libName, LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX, 
-                                LOADCORE_LIB_HASH_TABLE_SIZE);   
+    hash = getCyclicPolynomialHashValue(stubLibEntryTable->libName, LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX);   
     //0x000032BC - 0x000032F0
-    for (curLib = g_loadCore.registeredLibs[i]; curLib; curLib = curLib->next) {
+    for (curLib = *GetLibHashChain(hash); curLib; curLib = curLib->next) {
          //0x000032D0 - 0x000032E4
          for (curStubLib = curLib->stubLibs, firstStubLib = curStubLib; curStubLib; curStubLib = curStubLib->next) {
               if (curStubLib->libStubTable != stubLibEntryTable) //0x000032D4
@@ -1977,10 +2258,12 @@ static s32 UnLinkLibraryEntry(SceStubLibraryEntryTable *stubLibEntryTable)
      * for our stub library in LoadCore's linked-list of unlinked stub 
      * libraries and remove our stub lib from that list and freeing it.
      */
-    for (curUnlinkedStubLib = g_loadCore.unLinkedStubLibs, prevUnlinkedStubLibPtr = &g_loadCore.unLinkedStubLibs; 
-       curUnlinkedStubLib; prevUnlinkedStubLibPtr = &curUnlinkedStubLib->next, curUnlinkedStubLib = curUnlinkedStubLib->next) {
-        if (curUnlinkedStubLib->libStubTable != stubLibEntryTable) //0x00003308
+    for (prevUnlinkedStubLibPtr = GetUnlinkedStubLibChain(hash), curUnlinkedStubLib = *prevUnlinkedStubLibPtr; 
+       curUnlinkedStubLib; curUnlinkedStubLib = *prevUnlinkedStubLibPtr) {
+        if (curUnlinkedStubLib->libStubTable != stubLibEntryTable) { //0x00003308
+            prevUnlinkedStubLibPtr = &curUnlinkedStubLib->next;
             continue;
+        }
         
         curUnlinkedStubLib->status &= ~(STUB_LIBRARY_LINKED | STUB_LIBRARY_EXCLUSIVE_LINK | 0x4);
         *prevUnlinkedStubLibPtr = curUnlinkedStubLib->next; //0x0000334C
@@ -2109,7 +2392,7 @@ static s32 aLinkClient(SceStubLibrary *stubLib, SceResidentLibrary *lib)
     if (!(lib->attribute & SCE_LIB_SYSCALL_EXPORT)) { //0x00003AE8
         status = aLinkVariableStub(lib, (SceStubLibraryEntryTable *)&stubLib->libName, stubLib->isUserLib); //0x00003B38
         if (status != 0) //0x00003B44
-            g_UpdateCacheAll(); //0x00003B54
+            UpdateCacheAll(); //0x00003B54
     }
     stubLib->status = (stubLib->status & ~0x4) | STUB_LIBRARY_LINKED; //0x00003B04
     return SCE_ERROR_OK;
@@ -2143,21 +2426,20 @@ static s32 aLinkClient(SceStubLibrary *stubLib, SceResidentLibrary *lib)
  */
 static s32 aLinkLibEntries(SceStubLibrary *stubLib)
 {
-    u32 i;
     s32 status;
     SceResidentLibrary *curLib;
     SceStubLibrary *curStubLib;
     
     status = SCE_ERROR_KERNEL_LIBRARY_NOT_FOUND;
     
-    i = getCyclicPolynomialHash(stubLib->libName, LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX, 
-                                                  LOADCORE_LIB_HASH_TABLE_SIZE); 
+    g_loadCore.libLookups++;
     //0x00003C48 - 0x00003C5C
-    for (curLib = g_loadCore.registeredLibs[i]; curLib; curLib = curLib->next) {
+    for (curLib = *GetLibHashChain(stubLib->libNameHash); curLib; curLib = curLib->next) {
+         g_loadCore.libProbes++;
          if (curLib->attribute & SCE_LIB_AUTO_EXPORT) //0x00003C4C
              continue;
          
-         if (strcmp(stubLib->libName, curLib->libName) != 0) //0x00003C88
+         if (curLib->libNameHash != stubLib->libNameHash || strcmp(stubLib->libName, curLib->libName) != 0) //0x00003C88
              continue;
          
          if ((((curLib->version[1] << 8) | curLib->version[0]) - ((stubLib->version[1] << 8) | stubLib->version[0])) < 0) //0x00003C9C
@@ -2315,6 +2597,8 @@ static s32 CopyLibEnt(SceResidentLibrary *lib, SceResidentLibraryEntryTable *lib
     s32 len;
     u32 exports;
     
+    lib->nidIndex = NULL;
+    
     /* Protect Kernel memory from User Mode. */
     if (isUserLib && (IS_KERNEL_ADDR(libEntryTable) || IS_KERNEL_ADDR(libEntryTable->libName) || 
       IS_KERNEL_ADDR(libEntryTable->entryTable))) //0x00003698        
@@ -2325,6 +2609,7 @@ static s32 CopyLibEnt(SceResidentLibrary *lib, SceResidentLibraryEntryTable *lib
     
     lib->isUserLib = isUserLib;
     lib->libEntryTable = libEntryTable; //0x000036E4
+    lib->libNameHash = getCyclicPolynomialHashValue(libEntryTable->libName, LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX);
     
     lib->version[LIBRARY_VERSION_MINOR] = libEntryTable->version[LIBRARY_VERSION_MINOR];
     lib->version[LIBRARY_VERSION_MAJOR] = libEntryTable->version[LIBRARY_VERSION_MAJOR];
@@ -2409,6 +2694,8 @@ static s32 CopyLibStub(SceStubLibrary *stubLib, SceStubLibraryEntryTable *stubLi
     stubLib->libStubTable = stubLibEntryTable;
     stubLib->stubEntryTableLen = stubLibEntryTable->len; //0x000038D0
     stubLib->libName = stubLibEntryTable->libName;
+    stubLib->libNameHash = getCyclicPolynomialHashValue(stubLibEntryTable->libName, 
+                                                        LOADCORE_CYCLIC_POLYNOMIAL_HASH_RADIAX);
     stubLib->version[LIBRARY_VERSION_MINOR] = stubLibEntryTable->version[LIBRARY_VERSION_MINOR];
     stubLib->version[LIBRARY_VERSION_MAJOR] = stubLibEntryTable->version[LIBRARY_VERSION_MAJOR];  
     
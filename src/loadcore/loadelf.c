@@ -51,6 +51,8 @@
 
 static s32 sceKernelApplyPspRelSegment2(u32 *segmentAddr, u32 nSegments, u8 *relocData, u32 relocSize);
 static s32 sceKernelApplyPspRelSection(u32 *segmentAddr, u32 nSegments, Elf32_Rel *relocInfo, u32 fileSize);
+static s32 sceKernelApplyPspRelRuns(u32 *segmentAddr, u32 nSegments, u32 *relocData, u32 relocSize);
+static s32 FindPspRelRunsSection(Elf32_Ehdr *elfHeader, u32 fileSize, Elf32_Shdr **runsSection);
 static s32 PspUncompress(u8 *modBuf, SceLoadCoreExecFileInfo *execInfo, u32 *arg2);
 static void readElfSegmentInfo(PspHeader *header, SceLoadCoreExecFileInfo *execInfo);
 static s32 CheckElfSection(Elf32_Ehdr *elfHeader, SceLoadCoreExecFileInfo *execInfo);
@@ -204,7 +206,7 @@ s32 sceKernelCheckExecFile(u8 *buf, SceLoadCoreExecFileInfo *execInfo)
             execInfo->topAddr = (void *)elfProgHeader->p_vaddr; //0x0000418C
             if (nSegments > 0 && elfProgHeader->p_type == PT_LOAD) { //0x00004190 & 0x000041A0
                 //0x00004200 - (0x00004244) - 0x0000425C
-                for (i = 0; i < nSegments && elfProgHeader->p_type != PT_LOAD; i++, elfProgHeader++) {
+                for (i = 0; i < nSegments && elfProgHeader->p_type == PT_LOAD; i++, elfProgHeader++) {
                      if (elfProgHeader->p_vaddr < lowAddr) { //0x000041A4 & 0x000041FC
                          execInfo->topAddr = (void *)elfProgHeader->p_vaddr; //0x00004204
                          lowAddr = elfProgHeader->p_vaddr;
@@ -597,11 +599,11 @@ s32 sceKernelLoadExecutableObject(u8 *buf, SceLoadCoreExecFileInfo *execInfo)
         
          if ((s32)elfProgHeader[i].p_offset < 0 || (s32)elfProgHeader[i].p_vaddr < 0 || 
            (s32)elfProgHeader[i].p_filesz < 0 || (s32)elfProgHeader[i].p_memsz < 0 || 
-           ((s32)(elfProgHeader[i].p_offset + elfHeader) >> 31) != ((s32)elfHeader >> 31)) {
+           ((s32)((u8 *)elfHeader + elfProgHeader[i].p_offset) >> 31) != ((s32)elfHeader >> 31)) {
              Kprintf("Cannot load kernel mode ELF\n");
              return SCE_ERROR_KERNEL_ERROR;
          }
-         g_segmentStart[segments] = elfProgHeader[i].p_offset + elfHeader; //0x00004A24 & 0x00004A44
+         g_segmentStart[segments] = (u8 *)elfHeader + elfProgHeader[i].p_offset; //0x00004A24 & 0x00004A44
          g_segmentSize[segments] = elfProgHeader[i].p_filesz; //0x00004A18 & 0x00004A4C
          execInfo->segmentAlign[segments] = elfProgHeader[i].p_align; //0x00004A40 & 0x00004A50
          execInfo->segmentAddr[segments] = elfProgHeader[i].p_vaddr; //0x00004A14 & 0x00004A54
@@ -639,10 +641,10 @@ s32 sceKernelLoadExecutableObject(u8 *buf, SceLoadCoreExecFileInfo *execInfo)
     } 
     else {
         if (nSegments != execInfo->numSegments) { //0x00004AC4
-            elfProgHeader = ((Elf32_Phdr *)(elfHeader->e_phoff + elfHeader)) + execInfo->numSegments; //0x00004AD0
+            elfProgHeader = ((Elf32_Phdr *)((u8 *)elfHeader + elfHeader->e_phoff)) + execInfo->numSegments; //0x00004AD0
             /* executable has to be relocated. */
             if (elfProgHeader->p_type == PT_PRX_RELOC || elfProgHeader->p_type == PT_PRX_RELOC2) { //0x00004AE8  
-                segmentPtr = (u32 *)(elfProgHeader->p_offset + elfHeader); //0x00004AF8
+                segmentPtr = (u32 *)((u8 *)elfHeader + elfProgHeader->p_offset); //0x00004AF8
             
                 if ((s32)elfProgHeader->p_offset < 0 || 
                   (((s32)elfProgHeader->p_offset + (s32)elfHeader) >> 31) != ((s32)elfHeader >> 31)) { //0x00004B04
@@ -655,9 +657,9 @@ s32 sceKernelLoadExecutableObject(u8 *buf, SceLoadCoreExecFileInfo *execInfo)
         for (i = 0; i < execInfo->numSegments; i++) {
              execInfo->segmentAddr[i] += (u32)execInfo->topAddr; //0x00004B30          
              /* Reduce segments by one when the signs of execInfo->topAddr 
-              * and (execInfo->segmentAddr[i] + execInfo->topAddr) differ.
+              * and the relocated execInfo->segmentAddr[i] differ.
               */            
-             if ((((s32)execInfo->segmentAddr[i] + (s32)execInfo->topAddr) >> 31) != ((s32)execInfo->topAddr >> 31)) { //0x00004B3C
+             if (((s32)execInfo->segmentAddr[i] >> 31) != ((s32)execInfo->topAddr >> 31)) { //0x00004B3C
                  backUpSegments = execInfo->numSegments - 1;
                  return SCE_ERROR_KERNEL_ERROR;
              }
@@ -668,9 +670,19 @@ s32 sceKernelLoadExecutableObject(u8 *buf, SceLoadCoreExecFileInfo *execInfo)
         if (execInfo->exportsInfo != (void *)LOADCORE_ERROR) //0x00004B74
             execInfo->exportsInfo += (u32)execInfo->topAddr; //0x00004B7C
         
+        if (execInfo->importsInfo != (void *)LOADCORE_ERROR)
+            execInfo->importsInfo += (u32)execInfo->topAddr;
+        
         if (elfProgHeader->p_type == PT_PRX_RELOC) { //0x00004B88
-            status = sceKernelApplyPspRelSection(execInfo->segmentAddr, execInfo->numSegments, (Elf32_Rel *)segmentPtr, 
-                                                 elfProgHeader->p_filesz >> 3); //0x00004D94
+            /* Prefer the relocation runs of psp-kprxgen -r, which hold the same relocations. */
+            status = FindPspRelRunsSection(elfHeader, execInfo->decSize, &elfSectionHdr);
+            if (status == SCE_ERROR_OK && elfSectionHdr != NULL)
+                status = sceKernelApplyPspRelRuns(execInfo->segmentAddr, execInfo->numSegments, 
+                                                  (u32 *)((u8 *)elfHeader + elfSectionHdr->sh_offset), 
+                                                  elfSectionHdr->sh_size);
+            else if (status == SCE_ERROR_OK)
+                status = sceKernelApplyPspRelSection(execInfo->segmentAddr, execInfo->numSegments, (Elf32_Rel *)segmentPtr, 
+                                                     elfProgHeader->p_filesz >> 3); //0x00004D94
             backUpSegments = execInfo->numSegments - 1; //0x00004BF4
             if (status < SCE_ERROR_OK) //0x00004D78                           
                 return status; //0x00004BFC
@@ -690,13 +702,13 @@ s32 sceKernelLoadExecutableObject(u8 *buf, SceLoadCoreExecFileInfo *execInfo)
         
         else {
         //0x00004BD0
-            elfSectionHdr = ((Elf32_Shdr *)elfHeader + elfHeader->e_shoff); //0x00004BC0
+            elfSectionHdr = (Elf32_Shdr *)((u8 *)elfHeader + elfHeader->e_shoff); //0x00004BC0
             for (i = 1; i < elfHeader->e_shnum; i++) { //0x00004BB0 - 0x00004BE4
                  if (elfSectionHdr[i].sh_type == PT_PRX_RELOC && 
                      elfSectionHdr[elfSectionHdr[i].sh_info].sh_flags == SHF_ALLOC) { //0x00004BD4 & 0x00004D04
                         if (elfSectionHdr[i].sh_offset > 0 && elfSectionHdr[i].sh_entsize > 0) { //0x00004D20
                             status = sceKernelApplyPspRelSection(execInfo->segmentAddr, execInfo->numSegments, 
-                                                                 (Elf32_Rel *)(elfHeader + elfSectionHdr[i].sh_offset), 
+                                                                 (Elf32_Rel *)((u8 *)elfHeader + elfSectionHdr[i].sh_offset), 
                                                                  elfSectionHdr[i].sh_size / elfSectionHdr[i].sh_entsize); //0x00004D38
                             if (status < SCE_ERROR_OK) { //0x00004D40                     
                                 backUpSegments = execInfo->numSegments - 1; //0x00004BF4
@@ -718,8 +730,9 @@ s32 sceKernelLoadExecutableObject(u8 *buf, SceLoadCoreExecFileInfo *execInfo)
          if (i >= backUpSegments && g_segmentSize[i] < execInfo->segmentSize[i]) //0x00004C4C
              sceKernelMemset((void *)execInfo->segmentAddr[i] + g_segmentSize[i], 0, execInfo->segmentSize[i] - g_segmentSize[i]); //0x00004CD4
     }
-    execInfo->moduleInfo = (SceModuleInfo *)((((u32)g_segmentStart[0] - (u32)elfHeader) - execInfo->segmentAddr[0]) + 
-                             execInfo->moduleInfoOffset); //0x00004C94
+    /* moduleInfoOffset points to the module information in the file, since sceKernelProbeExecutableObject(). */
+    execInfo->moduleInfo = (SceModuleInfo *)((execInfo->moduleInfoOffset - (u32)g_segmentStart[0]) + 
+                             execInfo->segmentAddr[0]); //0x00004C94
     return SCE_ERROR_OK;
 }
 
@@ -906,7 +919,7 @@ static s32 sceKernelApplyPspRelSegment2(u32 *segmentAddr, u32 nSegments, u8 *rel
 static s32 sceKernelApplyPspRelSection(u32 *segmentAddr, u32 nSegments, Elf32_Rel *relocInfo, u32 fileSize)
 {
     u32 daddr, daddr2;
-    u32 segStart, segSize;
+    u32 segStart;
     u32 ofsSegIndex, ofsSegIndex2, addrSegIndex;
     s32 type;
     u32 data, dataLow;
@@ -950,33 +963,30 @@ static s32 sceKernelApplyPspRelSection(u32 *segmentAddr, u32 nSegments, Elf32_Re
              *(u32 *)daddr |= (data >> 2) & 0x03FFFFFF; //0x000053F4 & 0x00005368
              break;  
          case R_MIPS_HI16: //0x00005400
-             data = (u32)((*(s32 *)daddr) << 16); //0x0000540C & 0x00005414
-             
+             /* The R_MIPS_LO16 following one or more R_MIPS_HI16 completes their addends. */
              //0x00005418 & 0x00005538 - 0x00005580
-             for (j = i + 1; j < fileSize && (relocInfo[j].r_info == R_MIPS_HI16); j++, k++) {
+             for (j = i + 1; j < fileSize && ELF32_R_TYPE(relocInfo[j].r_info) == R_MIPS_HI16; j++, k++) {
                   ofsSegIndex2 = ELF32_R_OFS_BASE(relocInfo[j].r_info); //0x00005538
-                  if (relocInfo[j].r_offset >= g_segmentSize[ofsSegIndex] || ofsSegIndex2 >= nSegments) //0x00005558
+                  if (ofsSegIndex2 >= nSegments || relocInfo[j].r_offset >= g_segmentSize[ofsSegIndex2]) //0x00005558
                       return SCE_ERROR_KERNEL_ERROR;
              }
+             if (j >= fileSize)
+                 return SCE_ERROR_KERNEL_ERROR;
+             
              ofsSegIndex2 = ELF32_R_OFS_BASE(relocInfo[j].r_info); //0x00005438
-             segSize = g_segmentSize[j]; //0x00005440
-             if (ofsSegIndex2 >= nSegments || relocInfo[j].r_offset >= segSize) //0x0000545C
+             if (ofsSegIndex2 >= nSegments || relocInfo[j].r_offset >= g_segmentSize[ofsSegIndex2]) //0x0000545C
                  return SCE_ERROR_KERNEL_ERROR;
              
              daddr2 = (u32)(g_segmentStart[ofsSegIndex2] + relocInfo[j].r_offset); //0x00005464 - 0x00005478
              dataLow = (u32)(((*(s32 *)daddr2) << 16) >> 16); //0x0000547C - 0x00005484
-             data = data + dataLow + segStart; //0x00005488 & 0x0000548C
-             *(u32 *)daddr |= ((data >> 15) >> 1) & 0xFFFF; //0x00005490 & 0x00005494 & 0x0000549C
              
              //0x00005498 & 0x000054AC - 0x00005508
-             for (j = 0; j < k; j++) {
-                  ofsSegIndex2 = ELF32_R_OFS_BASE(relocInfo[i].r_info); //0x000054B0
-                  if (ofsSegIndex2 >= nSegments || relocInfo[i].r_offset >= segSize) //0x000054D0
-                      return SCE_ERROR_KERNEL_ERROR; 
-                  
-                  daddr2 = (u32)(g_segmentStart[ofsSegIndex2] + relocInfo[i].r_offset); //0x000054D8 - 0x000054E4
-                  *(u32 *)daddr2 |= 0xFFFF0000; //0x000054F8
-                  *(u32 *)daddr2 |= daddr; //0x000054F4
+             for (j = i; j < i + k; j++) {
+                  ofsSegIndex2 = ELF32_R_OFS_BASE(relocInfo[j].r_info); //0x000054B0
+                  daddr2 = (u32)(g_segmentStart[ofsSegIndex2] + relocInfo[j].r_offset); //0x000054D8 - 0x000054E4
+                  /* Round up, as the LO16 is sign-extended. */
+                  data = ((*(u32 *)daddr2) << 16) + dataLow + segStart; //0x00005488 & 0x0000548C
+                  *(u32 *)daddr2 = (*(u32 *)daddr2 & 0xFFFF0000) | ((((data >> 15) + 1) >> 1) & 0xFFFF); //0x000054F8
              }
              break;    
          case R_MIPS_LO16: //0x0000559C
@@ -999,6 +1009,141 @@ static s32 sceKernelApplyPspRelSection(u32 *segmentAddr, u32 nSegments, Elf32_Re
     return SCE_ERROR_OK;
 }
 
+/*
+ * Apply the relocation runs output by psp-kprxgen -r.  Every run holds
+ * relocations of a single type and pair of segments, so they are applied
+ * in one loop per run, without decoding each relocation.  The R_MIPS_HI16
+ * relocations come with their full addend and don't need their LO16.
+ * 
+ * Returns 0 on success.
+ */
+static s32 sceKernelApplyPspRelRuns(u32 *segmentAddr, u32 nSegments, u32 *relocData, u32 relocSize)
+{
+    Elf32_RelRun *run;
+    u32 *entry;
+    u32 *end;
+    u32 *daddr;
+    u8 *segData;
+    u32 segSize;
+    u32 segStart;
+    u32 data;
+    u32 entrySize;
+    u32 i;
+    
+    end = relocData + (relocSize >> 2);
+    for (entry = relocData; entry < end; entry += run->r_count * entrySize) {
+         run = (Elf32_RelRun *)entry;
+         entry = (u32 *)(run + 1);
+         if (entry > end || run->r_ofs_base >= nSegments || run->r_addr_base >= nSegments)
+             return SCE_ERROR_KERNEL_ERROR;
+         
+         entrySize = (run->r_type == R_MIPS_HI16) ? 2 : 1;
+         if (run->r_count > (u32)(end - entry) / entrySize)
+             return SCE_ERROR_KERNEL_ERROR;
+         
+         segData = g_segmentStart[run->r_ofs_base];
+         segSize = g_segmentSize[run->r_ofs_base];
+         segStart = segmentAddr[run->r_addr_base];
+         
+         switch (run->r_type) {
+         case R_MIPS_NONE:
+             break;
+         case R_MIPS_16: case R_MIPS_LO16:
+             for (i = 0; i < run->r_count; i++) {
+                  if (entry[i] >= segSize)
+                      return SCE_ERROR_KERNEL_ERROR;
+                  
+                  daddr = (u32 *)(segData + entry[i]);
+                  *daddr = (*daddr & 0xFFFF0000) | ((*daddr + segStart) & 0xFFFF);
+             }
+             break;
+         case R_MIPS_32:
+             for (i = 0; i < run->r_count; i++) {
+                  if (entry[i] >= segSize)
+                      return SCE_ERROR_KERNEL_ERROR;
+                  
+                  *(u32 *)(segData + entry[i]) += segStart;
+             }
+             break;
+         case R_MIPS_26:
+             for (i = 0; i < run->r_count; i++) {
+                  if (entry[i] >= segSize)
+                      return SCE_ERROR_KERNEL_ERROR;
+                  
+                  daddr = (u32 *)(segData + entry[i]);
+                  data = ((*daddr & 0x03FFFFFF) << 2) | ((segmentAddr[run->r_ofs_base] + entry[i]) & 0xF0000000);
+                  data += segStart;
+                  *daddr = (*daddr & 0xFC000000) | ((data >> 2) & 0x03FFFFFF);
+             }
+             break;
+         case R_MIPS_HI16:
+             for (i = 0; i < run->r_count * 2; i += 2) {
+                  if (entry[i] >= segSize)
+                      return SCE_ERROR_KERNEL_ERROR;
+                  
+                  /* Round up, as the LO16 is sign-extended. */
+                  daddr = (u32 *)(segData + entry[i]);
+                  data = entry[i + 1] + segStart;
+                  *daddr = (*daddr & 0xFFFF0000) | ((((data >> 15) + 1) >> 1) & 0xFFFF);
+             }
+             break;
+         default:
+             Kprintf("********************\n");
+             Kprintf("PSP cannot load this image\n");
+             Kprintf("unacceptable relocation type: 0x%x\n", run->r_type);
+             return SCE_ERROR_KERNEL_UNSUPPORTED_PRX_TYPE;
+         }
+    }
+    return SCE_ERROR_OK;
+}
+
+/*
+ * Find the section of relocation runs which psp-kprxgen -r outputs next to 
+ * the classic relocations.  The section has to be in the file and in the 
+ * address space of the ELF header, as the PT_PRX_RELOC segment.  The size 
+ * of the file is only known for the files with a PSP header, otherwise the 
+ * file ends with the section names, as psp-kprxgen writes them last.
+ * 
+ * Returns 0 on success, *runsSection being NULL if the executable has no 
+ * relocation runs.
+ */
+static s32 FindPspRelRunsSection(Elf32_Ehdr *elfHeader, u32 fileSize, Elf32_Shdr **runsSection)
+{
+    Elf32_Shdr *elfSectionHdr;
+    Elf32_Shdr *runsHdr;
+    u32 i;
+    
+    *runsSection = NULL;
+    if ((s32)elfHeader->e_shoff <= 0)
+        return SCE_ERROR_OK;
+    
+    elfSectionHdr = (Elf32_Shdr *)((u8 *)elfHeader + elfHeader->e_shoff);
+    if (((s32)elfSectionHdr >> 31) != ((s32)elfHeader >> 31))
+        return SCE_ERROR_KERNEL_ERROR;
+    
+    for (i = 1; i < elfHeader->e_shnum; i++) {
+         if (elfSectionHdr[i].sh_type == SHT_PRX_RELOC_RUNS)
+             break;
+    }
+    if (i >= elfHeader->e_shnum)
+        return SCE_ERROR_OK;
+    
+    runsHdr = &elfSectionHdr[i];
+    if (fileSize == 0) {
+        if (elfHeader->e_shstrndx >= elfHeader->e_shnum)
+            return SCE_ERROR_KERNEL_ERROR;
+        
+        fileSize = elfSectionHdr[elfHeader->e_shstrndx].sh_offset + elfSectionHdr[elfHeader->e_shstrndx].sh_size;
+    }
+    if ((s32)runsHdr->sh_offset <= 0 || runsHdr->sh_offset > fileSize || 
+      runsHdr->sh_size > fileSize - runsHdr->sh_offset || 
+      ((s32)((u8 *)elfHeader + runsHdr->sh_offset) >> 31) != ((s32)elfHeader >> 31))
+        return SCE_ERROR_KERNEL_ERROR;
+    
+    *runsSection = runsHdr;
+    return SCE_ERROR_OK;
+}
+
 //sub_000056B8
 static s32 PspUncompress(u8 *modBuf, SceLoadCoreExecFileInfo *execInfo, 
                          u32 *newSize) 
@@ -1439,7 +1584,7 @@ static s32 CheckElfSection(Elf32_Ehdr *elfHeader, SceLoadCoreExecFileInfo *execI
       ((s32)elfHeader + elfHeader->e_phoff) <= 0)    
         return SCE_ERROR_KERNEL_UNSUPPORTED_PRX_TYPE;
     
-    progHeader = (Elf32_Phdr *)(elfHeader + elfHeader->e_phoff);
+    progHeader = (Elf32_Phdr *)((u8 *)elfHeader + elfHeader->e_phoff);
     for (i = elfHeader->e_phnum; i != 0; i--) {
          if (progHeader[i].p_type != PT_LOAD) //0x000063F4
              continue;
@@ -1483,7 +1628,7 @@ static s32 CheckElfSectionPRX(Elf32_Ehdr *elfHeader, SceLoadCoreExecFileInfo *ex
     if (elfHeader->e_shnum == 0 || elfHeader->e_shstrndx >= elfHeader->e_shnum)
         return SCE_ERROR_KERNEL_UNSUPPORTED_PRX_TYPE;
     
-    sectionHeader = (Elf32_Shdr *)elfHeader + elfHeader->e_shoff; //0x00006498
+    sectionHeader = (Elf32_Shdr *)((u8 *)elfHeader + elfHeader->e_shoff); //0x00006498
     sectionHeader2 = sectionHeader + elfHeader->e_shstrndx;
     
     if (sectionHeader2->sh_offset <= 0) //0x000064D8
@@ -0,0 +1,576 @@
+#include <common_imp.h>
+
+#include <sysmem_sysclib.h>
+#include <sysmem_utils_kernel.h>
+
+#include "deflate.h"
+
+/*
+ * Deflate (RFC 1951) decoder. The Huffman codes are decoded with a single lookup of their first bits when
+ * they are short enough, and bit by bit otherwise. The input is read into a 64-bit buffer, which always holds
+ * enough bits for a whole step (a block header, a code length or a literal/length/distance group) unless the
+ * input is exhausted: a step is then left undone, to be resumed when more input is given.
+ */
+
+#define DEFLATE_STATE_HEADER    0 // block header
+#define DEFLATE_STATE_STORED    1 // stored block length
+#define DEFLATE_STATE_COPY      2 // stored block data, 'len' bytes left
+#define DEFLATE_STATE_TABLE     3 // dynamic block code sizes
+#define DEFLATE_STATE_LENLENS   4 // code length code lengths, 'index' read
+#define DEFLATE_STATE_CODELENS  5 // literal/length and distance code lengths, 'index' read
+#define DEFLATE_STATE_CODES     6 // compressed data
+#define DEFLATE_STATE_MATCH     7 // match of 'len' bytes at 'dist' bytes being copied
+#define DEFLATE_STATE_DONE      8
+
+/* Results of DeflateRun() */
+#define DEFLATE_NEED_INPUT      0
+#define DEFLATE_END             1
+#define DEFLATE_NEED_OUTPUT     2
+
+/* Results of DeflateDecodeSymbol() besides the symbol */
+#define DEFLATE_SYM_NEED_INPUT  -1
+#define DEFLATE_SYM_INVALID     -2
+
+/* Unsigned minimum, the sizes can exceed the range of pspMin() */
+#define DEFLATE_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+const u8 g_DeflateLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+const u16 g_DeflateLengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+const u8 g_DeflateLengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+const u16 g_DeflateDistBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+const u8 g_DeflateDistExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+s32 DeflateBuildCode(u16 *fast, u32 fastBits, u16 *count, u16 *symbol, const u8 *lengths, u32 n);
+s32 DeflateDecodeSymbol(const u16 *fast, u32 fastBits, const u16 *count, const u16 *symbol, u32 bits, u32 available,
+                        u32 *used);
+void DeflateBuildFixedCodes(SceKernelDeflateStream *stream);
+void DeflateCopyMatch(u8 *window, u32 mask, u32 outPos, u32 dist, u32 n);
+s32 DeflateRun(SceKernelDeflateStream *stream, u32 outEnd);
+
+/*
+ * Builds the canonical code of 'n' symbols from their code lengths: the number of codes of each length,
+ * the symbols ordered by code, and the lookup table indexed by the first 'fastBits' bits of the input.
+ * Each entry of the table is (symbol << 4) | length, or 0 if the code is longer.
+ */
+s32 DeflateBuildCode(u16 *fast, u32 fastBits, u16 *count, u16 *symbol, const u8 *lengths, u32 n)
+{
+    u16 offsets[16];
+    u32 len, sym, i;
+    for (len = 0; len < 16; len++)
+        count[len] = 0;
+    for (sym = 0; sym < n; sym++)
+        count[lengths[sym]]++;
+    // Over-subscribed codes are invalid, incomplete ones are detected when an unused code is read
+    s32 left = 1;
+    for (len = 1; len < 16; len++) {
+        left = (left << 1) - count[len];
+        if (left < 0)
+            return 0x80000108;
+    }
+    offsets[1] = 0;
+    for (len = 1; len < 15; len++)
+        offsets[len + 1] = offsets[len] + count[len];
+    for (sym = 0; sym < n; sym++) {
+        if (lengths[sym] != 0)
+            symbol[offsets[lengths[sym]]++] = sym;
+    }
+
+    for (i = 0; i < (1U << fastBits); i++)
+        fast[i] = 0;
+    u32 code = 0;
+    u32 index = 0;
+    for (len = 1; len <= fastBits; len++) {
+        for (i = 0; i < count[len]; i++) {
+            // The codes are stored from their most significant bit, the input is read from the least significant one
+            u32 reversed = 0;
+            u32 bit;
+            for (bit = 0; bit < len; bit++)
+                reversed |= ((code >> bit) & 1) << (len - 1 - bit);
+            for (; reversed < (1U << fastBits); reversed += 1 << len)
+                fast[reversed] = (symbol[index] << 4) | len;
+            code++;
+            index++;
+        }
+        code <<= 1;
+    }
+    return 0;
+}
+
+/* Decodes a symbol from the 'available' next bits of the input, and returns the number of bits used in 'used' */
+s32 DeflateDecodeSymbol(const u16 *fast, u32 fastBits, const u16 *count, const u16 *symbol, u32 bits, u32 available,
+                        u32 *used)
+{
+    u32 entry = fast[bits & ((1 << fastBits) - 1)];
+    if (entry != 0) {
+        if ((entry & 0xF) > available)
+            return DEFLATE_SYM_NEED_INPUT;
+        *used = entry & 0xF;
+        return entry >> 4;
+    }
+    s32 code = 0;
+    s32 first = 0;
+    s32 index = 0;
+    u32 len;
+    for (len = 1; len < 16; len++) {
+        if (len > available)
+            return DEFLATE_SYM_NEED_INPUT;
+        code |= (bits >> (len - 1)) & 1;
+        if (code - first < count[len]) {
+            *used = len;
+            return symbol[index + code - first];
+        }
+        index += count[len];
+        first = (first + count[len]) << 1;
+        code <<= 1;
+    }
+    return DEFLATE_SYM_INVALID;
+}
+
+void DeflateBuildFixedCodes(SceKernelDeflateStream *stream)
+{
+    u32 i;
+    for (i = 0; i < 144; i++)
+        stream->lengths[i] = 8;
+    for (; i < 256; i++)
+        stream->lengths[i] = 9;
+    for (; i < 280; i++)
+        stream->lengths[i] = 7;
+    for (; i < 288; i++)
+        stream->lengths[i] = 8;
+    for (; i < 288 + 30; i++)
+        stream->lengths[i] = 5;
+    DeflateBuildCode(stream->lenFast, SCE_KERNEL_DEFLATE_LEN_FAST_BITS, stream->lenCount, stream->lenSymbol,
+                     stream->lengths, 288);
+    DeflateBuildCode(stream->distFast, SCE_KERNEL_DEFLATE_DIST_FAST_BITS, stream->distCount, stream->distSymbol,
+                     stream->lengths + 288, 30);
+}
+
+/* Copies 'n' bytes from 'dist' bytes before the output position, 'n' being at most the ring buffer size */
+void DeflateCopyMatch(u8 *window, u32 mask, u32 outPos, u32 dist, u32 n)
+{
+    u32 from = outPos - dist;
+    if ((outPos & mask) > mask - (n - 1) || (from & mask) > mask - (n - 1)) {
+        // The source or the destination wraps around the ring buffer
+        while (n-- != 0)
+            window[outPos++ & mask] = window[from++ & mask];
+        return;
+    }
+    u8 *dst = &window[outPos & mask];
+    const u8 *src = &window[from & mask];
+    // With a distance close to the ring size, the source is just ahead of the destination. memcpy() creates
+    // the destination cache lines without reading them, so the source must not share one of them either way.
+    if (n >= 16 && dist >= n && ((from - outPos) & mask) >= n + 64)
+        memcpy(dst, src, n);
+    else if (dist == 1)
+        memset(dst, *src, n);
+    else {
+        // The source overlaps the destination: behind it, the bytes are repeated every 'dist' bytes
+        while (n >= 4) {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = src[3];
+            dst += 4;
+            src += 4;
+            n -= 4;
+        }
+        while (n-- != 0)
+            *(dst++) = *(src++);
+    }
+}
+
+/*
+ * Decompresses until the end of the stream, the end of the input, or until the output position reaches 'outEnd'.
+ * Returns DEFLATE_END, DEFLATE_NEED_INPUT, DEFLATE_NEED_OUTPUT, or an error code.
+ */
+s32 DeflateRun(SceKernelDeflateStream *stream, u32 outEnd)
+{
+    const u8 *in = stream->in;
+    const u8 *inEnd = in + stream->inSize;
+    u64 bitBuf = stream->bitBuf;
+    u32 bitCount = stream->bitCount;
+    u8 *window = stream->window;
+    u32 mask = stream->windowMask;
+    u32 outPos = stream->outPos;
+    u32 used, extra, n;
+    s32 sym, ret;
+
+    for (;;) {
+        while (bitCount <= 56 && in != inEnd) {
+            bitBuf |= (u64)*(in++) << bitCount;
+            bitCount += 8;
+        }
+        switch (stream->state) {
+        case DEFLATE_STATE_HEADER:
+            if (stream->final) {
+                stream->state = DEFLATE_STATE_DONE;
+                break;
+            }
+            if (bitCount < 3) {
+                ret = DEFLATE_NEED_INPUT;
+                goto end;
+            }
+            stream->final = bitBuf & 1;
+            switch ((bitBuf >> 1) & 3) {
+            case 0:
+                stream->state = DEFLATE_STATE_STORED;
+                break;
+            case 1:
+                DeflateBuildFixedCodes(stream);
+                stream->state = DEFLATE_STATE_CODES;
+                break;
+            case 2:
+                stream->state = DEFLATE_STATE_TABLE;
+                break;
+            default:
+                ret = 0x80000108;
+                goto end;
+            }
+            bitBuf >>= 3;
+            bitCount -= 3;
+            break;
+
+        case DEFLATE_STATE_STORED:
+            // The length is byte-aligned: as the input is read by bytes, this can be done again when resuming
+            bitBuf >>= bitCount & 7;
+            bitCount &= ~7;
+            if (bitCount < 32) {
+                ret = DEFLATE_NEED_INPUT;
+                goto end;
+            }
+            if ((bitBuf & 0xFFFF) != (~(bitBuf >> 16) & 0xFFFF)) {
+                ret = 0x80000108;
+                goto end;
+            }
+            stream->len = bitBuf & 0xFFFF;
+            bitBuf >>= 32;
+            bitCount -= 32;
+            stream->state = DEFLATE_STATE_COPY;
+            break;
+
+        case DEFLATE_STATE_COPY:
+            while (stream->len != 0 && bitCount != 0) {
+                if (outPos == outEnd) {
+                    ret = DEFLATE_NEED_OUTPUT;
+                    goto end;
+                }
+                window[outPos++ & mask] = bitBuf & 0xFF;
+                bitBuf >>= 8;
+                bitCount -= 8;
+                stream->len--;
+            }
+            while (stream->len != 0) {
+                if (outPos == outEnd) {
+                    ret = DEFLATE_NEED_OUTPUT;
+                    goto end;
+                }
+                if (in == inEnd) {
+                    ret = DEFLATE_NEED_INPUT;
+                    goto end;
+                }
+                n = DEFLATE_MIN(DEFLATE_MIN(stream->len, (u32)(inEnd - in)), outEnd - outPos);
+                // Do not wrap around the ring buffer
+                n = DEFLATE_MIN(n, mask - (outPos & mask) + 1);
+                memcpy(&window[outPos & mask], in, n);
+                in += n;
+                outPos += n;
+                stream->len -= n;
+            }
+            stream->state = DEFLATE_STATE_HEADER;
+            break;
+
+        case DEFLATE_STATE_TABLE:
+            if (bitCount < 14) {
+                ret = DEFLATE_NEED_INPUT;
+                goto end;
+            }
+            stream->nlen = (bitBuf & 0x1F) + 257;
+            stream->ndist = ((bitBuf >> 5) & 0x1F) + 1;
+            stream->ncode = ((bitBuf >> 10) & 0xF) + 4;
+            bitBuf >>= 14;
+            bitCount -= 14;
+            if (stream->nlen > 286 || stream->ndist > 30) {
+                ret = 0x80000108;
+                goto end;
+            }
+            stream->index = 0;
+            stream->state = DEFLATE_STATE_LENLENS;
+            break;
+
+        case DEFLATE_STATE_LENLENS:
+            // One length is read at a time, so that the bit buffer is filled before each
+            if (stream->index < stream->ncode) {
+                if (bitCount < 3) {
+                    ret = DEFLATE_NEED_INPUT;
+                    goto end;
+                }
+                stream->lengths[g_DeflateLengthOrder[stream->index++]] = bitBuf & 7;
+                bitBuf >>= 3;
+                bitCount -= 3;
+                break;
+            }
+            for (; stream->index < 19; stream->index++)
+                stream->lengths[g_DeflateLengthOrder[stream->index]] = 0;
+            // The code length code is temporarily kept in the distance code tables
+            ret = DeflateBuildCode(stream->distFast, SCE_KERNEL_DEFLATE_DIST_FAST_BITS, stream->distCount,
+                                   stream->distSymbol, stream->lengths, 19);
+            if (ret < 0)
+                goto end;
+            stream->index = 0;
+            stream->state = DEFLATE_STATE_CODELENS;
+            break;
+
+        case DEFLATE_STATE_CODELENS:
+            if (stream->index < stream->nlen + stream->ndist) {
+                sym = DeflateDecodeSymbol(stream->distFast, SCE_KERNEL_DEFLATE_DIST_FAST_BITS, stream->distCount,
+                                          stream->distSymbol, (u32)bitBuf, bitCount, &used);
+                if (sym < 0) {
+                    ret = (sym == DEFLATE_SYM_NEED_INPUT) ? DEFLATE_NEED_INPUT : (s32)0x80000108;
+                    goto end;
+                }
+                if (sym < 16) {
+                    stream->lengths[stream->index++] = sym;
+                    bitBuf >>= used;
+                    bitCount -= used;
+                    break;
+                }
+                u32 repeat, value = 0;
+                if (sym == 16) {
+                    extra = 2;
+                    repeat = 3;
+                    if (stream->index == 0) {
+                        ret = 0x80000108;
+                        goto end;
+                    }
+                    value = stream->lengths[stream->index - 1];
+                } else if (sym == 17) {
+                    extra = 3;
+                    repeat = 3;
+                } else {
+                    extra = 7;
+                    repeat = 11;
+                }
+                if (bitCount < used + extra) {
+                    ret = DEFLATE_NEED_INPUT;
+                    goto end;
+                }
+                repeat += (u32)(bitBuf >> used) & ((1 << extra) - 1);
+                bitBuf >>= used + extra;
+                bitCount -= used + extra;
+                if (stream->index + repeat > stream->nlen + stream->ndist) {
+                    ret = 0x80000108;
+                    goto end;
+                }
+                while (repeat-- != 0)
+                    stream->lengths[stream->index++] = value;
+                break;
+            }
+            // A block without end code cannot be decoded
+            if (stream->lengths[256] == 0) {
+                ret = 0x80000108;
+                goto end;
+            }
+            ret = DeflateBuildCode(stream->lenFast, SCE_KERNEL_DEFLATE_LEN_FAST_BITS, stream->lenCount,
+                                   stream->lenSymbol, stream->lengths, stream->nlen);
+            if (ret < 0)
+                goto end;
+            ret = DeflateBuildCode(stream->distFast, SCE_KERNEL_DEFLATE_DIST_FAST_BITS, stream->distCount,
+                                   stream->distSymbol, stream->lengths + stream->nlen, stream->ndist);
+            if (ret < 0)
+                goto end;
+            stream->state = DEFLATE_STATE_CODES;
+            break;
+
+        case DEFLATE_STATE_CODES:
+            for (;;) {
+                while (bitCount <= 56 && in != inEnd) {
+                    bitBuf |= (u64)*(in++) << bitCount;
+                    bitCount += 8;
+                }
+                sym = DeflateDecodeSymbol(stream->lenFast, SCE_KERNEL_DEFLATE_LEN_FAST_BITS, stream->lenCount,
+                                          stream->lenSymbol, (u32)bitBuf, bitCount, &used);
+                if (sym < 256) {
+                    if (sym < 0) {
+                        ret = (sym == DEFLATE_SYM_NEED_INPUT) ? DEFLATE_NEED_INPUT : (s32)0x80000108;
+                        goto end;
+                    }
+                    if (outPos == outEnd) {
+                        ret = DEFLATE_NEED_OUTPUT;
+                        goto end;
+                    }
+                    window[outPos++ & mask] = sym;
+                    bitBuf >>= used;
+                    bitCount -= used;
+                    continue;
+                }
+                if (sym == 256) {
+                    bitBuf >>= used;
+                    bitCount -= used;
+                    stream->state = DEFLATE_STATE_HEADER;
+                    break;
+                }
+                // The length, distance and their extra bits are consumed together
+                sym -= 257;
+                if (sym >= 29) {
+                    ret = 0x80000108;
+                    goto end;
+                }
+                extra = g_DeflateLengthExtra[sym];
+                if (bitCount < used + extra) {
+                    ret = DEFLATE_NEED_INPUT;
+                    goto end;
+                }
+                u32 len = g_DeflateLengthBase[sym] + ((u32)(bitBuf >> used) & ((1 << extra) - 1));
+                u32 total = used + extra;
+                sym = DeflateDecodeSymbol(stream->distFast, SCE_KERNEL_DEFLATE_DIST_FAST_BITS, stream->distCount,
+                                          stream->distSymbol, (u32)(bitBuf >> total), bitCount - total, &used);
+                if (sym < 0 || sym >= 30) {
+                    ret = (sym == DEFLATE_SYM_NEED_INPUT) ? DEFLATE_NEED_INPUT : (s32)0x80000108;
+                    goto end;
+                }
+                total += used;
+                extra = g_DeflateDistExtra[sym];
+                if (bitCount < total + extra) {
+                    ret = DEFLATE_NEED_INPUT;
+                    goto end;
+                }
+                u32 dist = g_DeflateDistBase[sym] + ((u32)(bitBuf >> total) & ((1 << extra) - 1));
+                if (dist > outPos) {
+                    ret = 0x80000108;
+                    goto end;
+                }
+                bitBuf >>= total + extra;
+                bitCount -= total + extra;
+                stream->len = len;
+                stream->dist = dist;
+                stream->state = DEFLATE_STATE_MATCH;
+                break;
+            }
+            break;
+
+        case DEFLATE_STATE_MATCH:
+            n = DEFLATE_MIN(stream->len, outEnd - outPos);
+            if (n != 0) {
+                DeflateCopyMatch(window, mask, outPos, stream->dist, n);
+                outPos += n;
+                stream->len -= n;
+            }
+            if (stream->len != 0) {
+                ret = DEFLATE_NEED_OUTPUT;
+                goto end;
+            }
+            stream->state = DEFLATE_STATE_CODES;
+            break;
+
+        case DEFLATE_STATE_DONE:
+            // Only whole bytes following the stream are kept, see sceKernelDeflateDecompress()
+            bitBuf >>= bitCount & 7;
+            bitCount &= ~7;
+            ret = DEFLATE_END;
+            goto end;
+        }
+    }
+
+end:
+    stream->in = in;
+    stream->inSize = inEnd - in;
+    stream->bitBuf = bitBuf;
+    stream->bitCount = bitCount;
+    stream->outPos = outPos;
+    return ret;
+}
+
+s32 sceKernelDeflateStreamInit(SceKernelDeflateStream *stream, u8 *buf, u32 size, u32 attr)
+{
+    if (stream == NULL || buf == NULL)
+        return 0x80000103;
+    if ((attr & SCE_KERNEL_DEFLATE_RING) != 0) {
+        if (size < SCE_KERNEL_DEFLATE_WINDOW_SIZE || (size & (size - 1)) != 0)
+            return 0x80000104;
+        stream->windowMask = size - 1;
+        stream->outLimit = 0xFFFFFFFF;
+    } else {
+        stream->windowMask = 0xFFFFFFFF;
+        stream->outLimit = size;
+    }
+    stream->in = NULL;
+    stream->inSize = 0;
+    stream->window = buf;
+    stream->outPos = 0;
+    stream->state = DEFLATE_STATE_HEADER;
+    stream->final = 0;
+    stream->bitBuf = 0;
+    stream->bitCount = 0;
+    return 0;
+}
+
+s32 sceKernelDeflateStreamDecompress(SceKernelDeflateStream *stream, u32 maxOut, u32 *outSize)
+{
+    u32 startPos = stream->outPos;
+    if (stream->windowMask != 0xFFFFFFFF)
+        maxOut = DEFLATE_MIN(maxOut, stream->windowMask + 1);
+    else
+        maxOut = DEFLATE_MIN(maxOut, stream->outLimit - startPos);
+    s32 ret = DeflateRun(stream, startPos + maxOut);
+    if (outSize != NULL)
+        *outSize = stream->outPos - startPos;
+    if (ret == DEFLATE_NEED_OUTPUT) {
+        // A linear buffer cannot receive more output
+        if (stream->outPos == stream->outLimit)
+            return 0x80000104;
+        ret = 0;
+    }
+    return ret;
+}
+
+/*
+ * Takes at most 'size' of the bytes following the end of the stream which were already read from the input,
+ * for the formats storing data after it. Returns the number of bytes taken.
+ */
+u32 DeflateStreamGetRemainder(SceKernelDeflateStream *stream, u8 *buf, u32 size)
+{
+    u32 count = 0;
+    if (stream->state != DEFLATE_STATE_DONE)
+        return 0;
+    while (count < size && stream->bitCount >= 8) {
+        buf[count++] = stream->bitBuf & 0xFF;
+        stream->bitBuf >>= 8;
+        stream->bitCount -= 8;
+    }
+    return count;
+}
+
+int sceKernelDeflateDecompress(u8 *dest, u32 destSize, const void *src, void **next)
+{
+    SceKernelDeflateStream stream;
+    s32 ret = sceKernelDeflateStreamInit(&stream, dest, destSize, 0);
+    if (ret < 0)
+        return ret;
+    // The end of the input is not known, the stream tells it
+    stream.in = src;
+    stream.inSize = 0xFFFFFFFF - (u32)src;
+    ret = DeflateRun(&stream, destSize);
+    if (ret < 0)
+        return ret;
+    if (ret != DEFLATE_END)
+        return 0x80000104;
+    if (next != NULL)
+        *next = (void *)(stream.in - (stream.bitCount >> 3));
+    return stream.outPos;
+}
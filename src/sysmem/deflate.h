@@ -0,0 +1,9 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <sysmem_utils_kernel.h>
+
+u32 DeflateStreamGetRemainder(SceKernelDeflateStream *stream, u8 *buf, u32 size);
+
+#endif
+
@@ -0,0 +1,312 @@
+#include <common_imp.h>
+
+#include <sysmem_sysclib.h>
+
+#include "digest.h"
+
+/*
+ * MD5 (RFC 1321) and SHA-1 (FIPS 180-1) compression functions, with all the rounds unrolled.
+ * 4-byte aligned blocks are read straight from the input; other blocks are copied first.
+ */
+
+#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define MD5_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+
+#define MD5_STEP(f, a, b, c, d, x, k, s) do { \
+    (a) += f((b), (c), (d)) + (x) + (k); \
+    (a) = ROTL((a), (s)) + (b); \
+} while (0)
+
+void Md5Block(u32 *h, const u8 *data)
+{
+    u32 buf[16];
+    const u32 *x = (const u32 *)data;
+    if (((u32)data & 3) != 0) {
+        memcpy(buf, data, 64);
+        x = buf;
+    }
+    u32 a = h[0];
+    u32 b = h[1];
+    u32 c = h[2];
+    u32 d = h[3];
+
+    MD5_STEP(MD5_F, a, b, c, d, x[0], 0xD76AA478, 7);
+    MD5_STEP(MD5_F, d, a, b, c, x[1], 0xE8C7B756, 12);
+    MD5_STEP(MD5_F, c, d, a, b, x[2], 0x242070DB, 17);
+    MD5_STEP(MD5_F, b, c, d, a, x[3], 0xC1BDCEEE, 22);
+    MD5_STEP(MD5_F, a, b, c, d, x[4], 0xF57C0FAF, 7);
+    MD5_STEP(MD5_F, d, a, b, c, x[5], 0x4787C62A, 12);
+    MD5_STEP(MD5_F, c, d, a, b, x[6], 0xA8304613, 17);
+    MD5_STEP(MD5_F, b, c, d, a, x[7], 0xFD469501, 22);
+    MD5_STEP(MD5_F, a, b, c, d, x[8], 0x698098D8, 7);
+    MD5_STEP(MD5_F, d, a, b, c, x[9], 0x8B44F7AF, 12);
+    MD5_STEP(MD5_F, c, d, a, b, x[10], 0xFFFF5BB1, 17);
+    MD5_STEP(MD5_F, b, c, d, a, x[11], 0x895CD7BE, 22);
+    MD5_STEP(MD5_F, a, b, c, d, x[12], 0x6B901122, 7);
+    MD5_STEP(MD5_F, d, a, b, c, x[13], 0xFD987193, 12);
+    MD5_STEP(MD5_F, c, d, a, b, x[14], 0xA679438E, 17);
+    MD5_STEP(MD5_F, b, c, d, a, x[15], 0x49B40821, 22);
+
+    MD5_STEP(MD5_G, a, b, c, d, x[1], 0xF61E2562, 5);
+    MD5_STEP(MD5_G, d, a, b, c, x[6], 0xC040B340, 9);
+    MD5_STEP(MD5_G, c, d, a, b, x[11], 0x265E5A51, 14);
+    MD5_STEP(MD5_G, b, c, d, a, x[0], 0xE9B6C7AA, 20);
+    MD5_STEP(MD5_G, a, b, c, d, x[5], 0xD62F105D, 5);
+    MD5_STEP(MD5_G, d, a, b, c, x[10], 0x02441453, 9);
+    MD5_STEP(MD5_G, c, d, a, b, x[15], 0xD8A1E681, 14);
+    MD5_STEP(MD5_G, b, c, d, a, x[4], 0xE7D3FBC8, 20);
+    MD5_STEP(MD5_G, a, b, c, d, x[9], 0x21E1CDE6, 5);
+    MD5_STEP(MD5_G, d, a, b, c, x[14], 0xC33707D6, 9);
+    MD5_STEP(MD5_G, c, d, a, b, x[3], 0xF4D50D87, 14);
+    MD5_STEP(MD5_G, b, c, d, a, x[8], 0x455A14ED, 20);
+    MD5_STEP(MD5_G, a, b, c, d, x[13], 0xA9E3E905, 5);
+    MD5_STEP(MD5_G, d, a, b, c, x[2], 0xFCEFA3F8, 9);
+    MD5_STEP(MD5_G, c, d, a, b, x[7], 0x676F02D9, 14);
+    MD5_STEP(MD5_G, b, c, d, a, x[12], 0x8D2A4C8A, 20);
+
+    MD5_STEP(MD5_H, a, b, c, d, x[5], 0xFFFA3942, 4);
+    MD5_STEP(MD5_H, d, a, b, c, x[8], 0x8771F681, 11);
+    MD5_STEP(MD5_H, c, d, a, b, x[11], 0x6D9D6122, 16);
+    MD5_STEP(MD5_H, b, c, d, a, x[14], 0xFDE5380C, 23);
+    MD5_STEP(MD5_H, a, b, c, d, x[1], 0xA4BEEA44, 4);
+    MD5_STEP(MD5_H, d, a, b, c, x[4], 0x4BDECFA9, 11);
+    MD5_STEP(MD5_H, c, d, a, b, x[7], 0xF6BB4B60, 16);
+    MD5_STEP(MD5_H, b, c, d, a, x[10], 0xBEBFBC70, 23);
+    MD5_STEP(MD5_H, a, b, c, d, x[13], 0x289B7EC6, 4);
+    MD5_STEP(MD5_H, d, a, b, c, x[0], 0xEAA127FA, 11);
+    MD5_STEP(MD5_H, c, d, a, b, x[3], 0xD4EF3085, 16);
+    MD5_STEP(MD5_H, b, c, d, a, x[6], 0x04881D05, 23);
+    MD5_STEP(MD5_H, a, b, c, d, x[9], 0xD9D4D039, 4);
+    MD5_STEP(MD5_H, d, a, b, c, x[12], 0xE6DB99E5, 11);
+    MD5_STEP(MD5_H, c, d, a, b, x[15], 0x1FA27CF8, 16);
+    MD5_STEP(MD5_H, b, c, d, a, x[2], 0xC4AC5665, 23);
+
+    MD5_STEP(MD5_I, a, b, c, d, x[0], 0xF4292244, 6);
+    MD5_STEP(MD5_I, d, a, b, c, x[7], 0x432AFF97, 10);
+    MD5_STEP(MD5_I, c, d, a, b, x[14], 0xAB9423A7, 15);
+    MD5_STEP(MD5_I, b, c, d, a, x[5], 0xFC93A039, 21);
+    MD5_STEP(MD5_I, a, b, c, d, x[12], 0x655B59C3, 6);
+    MD5_STEP(MD5_I, d, a, b, c, x[3], 0x8F0CCC92, 10);
+    MD5_STEP(MD5_I, c, d, a, b, x[10], 0xFFEFF47D, 15);
+    MD5_STEP(MD5_I, b, c, d, a, x[1], 0x85845DD1, 21);
+    MD5_STEP(MD5_I, a, b, c, d, x[8], 0x6FA87E4F, 6);
+    MD5_STEP(MD5_I, d, a, b, c, x[15], 0xFE2CE6E0, 10);
+    MD5_STEP(MD5_I, c, d, a, b, x[6], 0xA3014314, 15);
+    MD5_STEP(MD5_I, b, c, d, a, x[13], 0x4E0811A1, 21);
+    MD5_STEP(MD5_I, a, b, c, d, x[4], 0xF7537E82, 6);
+    MD5_STEP(MD5_I, d, a, b, c, x[11], 0xBD3AF235, 10);
+    MD5_STEP(MD5_I, c, d, a, b, x[2], 0x2AD7D2BB, 15);
+    MD5_STEP(MD5_I, b, c, d, a, x[9], 0xEB86D391, 21);
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+}
+
+#define SHA1_F0(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define SHA1_F1(x, y, z) ((x) ^ (y) ^ (z))
+#define SHA1_F2(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define SHA1_F3(x, y, z) ((x) ^ (y) ^ (z))
+
+/* The message schedule is kept in a 16-word ring */
+#define SHA1_W(i) (w[(i) & 15] = ROTL(w[((i) + 13) & 15] ^ w[((i) + 8) & 15] ^ w[((i) + 2) & 15] ^ w[(i) & 15], 1))
+
+#define SHA1_STEP(f, a, b, c, d, e, k, x) do { \
+    (e) += ROTL((a), 5) + f((b), (c), (d)) + (k) + (x); \
+    (b) = ROTL((b), 30); \
+} while (0)
+
+#define SHA1_STEP5(f, k, x0, x1, x2, x3, x4) do { \
+    SHA1_STEP(f, a, b, c, d, e, k, x0); \
+    SHA1_STEP(f, e, a, b, c, d, k, x1); \
+    SHA1_STEP(f, d, e, a, b, c, k, x2); \
+    SHA1_STEP(f, c, d, e, a, b, k, x3); \
+    SHA1_STEP(f, b, c, d, e, a, k, x4); \
+} while (0)
+
+void Sha1Block(u32 *h, const u8 *data)
+{
+    u32 w[16];
+    u32 i;
+    // The words are big-endian
+    if (((u32)data & 3) == 0) {
+        for (i = 0; i < 16; i++)
+            w[i] = pspWsbw(((const u32 *)data)[i]);
+    } else {
+        for (i = 0; i < 16; i++)
+            w[i] = (data[i * 4] << 24) | (data[i * 4 + 1] << 16) | (data[i * 4 + 2] << 8) | data[i * 4 + 3];
+    }
+    u32 a = h[0];
+    u32 b = h[1];
+    u32 c = h[2];
+    u32 d = h[3];
+    u32 e = h[4];
+
+    SHA1_STEP5(SHA1_F0, 0x5A827999, w[0], w[1], w[2], w[3], w[4]);
+    SHA1_STEP5(SHA1_F0, 0x5A827999, w[5], w[6], w[7], w[8], w[9]);
+    SHA1_STEP5(SHA1_F0, 0x5A827999, w[10], w[11], w[12], w[13], w[14]);
+    SHA1_STEP5(SHA1_F0, 0x5A827999, w[15], SHA1_W(16), SHA1_W(17), SHA1_W(18), SHA1_W(19));
+
+    SHA1_STEP5(SHA1_F1, 0x6ED9EBA1, SHA1_W(20), SHA1_W(21), SHA1_W(22), SHA1_W(23), SHA1_W(24));
+    SHA1_STEP5(SHA1_F1, 0x6ED9EBA1, SHA1_W(25), SHA1_W(26), SHA1_W(27), SHA1_W(28), SHA1_W(29));
+    SHA1_STEP5(SHA1_F1, 0x6ED9EBA1, SHA1_W(30), SHA1_W(31), SHA1_W(32), SHA1_W(33), SHA1_W(34));
+    SHA1_STEP5(SHA1_F1, 0x6ED9EBA1, SHA1_W(35), SHA1_W(36), SHA1_W(37), SHA1_W(38), SHA1_W(39));
+
+    SHA1_STEP5(SHA1_F2, 0x8F1BBCDC, SHA1_W(40), SHA1_W(41), SHA1_W(42), SHA1_W(43), SHA1_W(44));
+    SHA1_STEP5(SHA1_F2, 0x8F1BBCDC, SHA1_W(45), SHA1_W(46), SHA1_W(47), SHA1_W(48), SHA1_W(49));
+    SHA1_STEP5(SHA1_F2, 0x8F1BBCDC, SHA1_W(50), SHA1_W(51), SHA1_W(52), SHA1_W(53), SHA1_W(54));
+    SHA1_STEP5(SHA1_F2, 0x8F1BBCDC, SHA1_W(55), SHA1_W(56), SHA1_W(57), SHA1_W(58), SHA1_W(59));
+
+    SHA1_STEP5(SHA1_F3, 0xCA62C1D6, SHA1_W(60), SHA1_W(61), SHA1_W(62), SHA1_W(63), SHA1_W(64));
+    SHA1_STEP5(SHA1_F3, 0xCA62C1D6, SHA1_W(65), SHA1_W(66), SHA1_W(67), SHA1_W(68), SHA1_W(69));
+    SHA1_STEP5(SHA1_F3, 0xCA62C1D6, SHA1_W(70), SHA1_W(71), SHA1_W(72), SHA1_W(73), SHA1_W(74));
+    SHA1_STEP5(SHA1_F3, 0xCA62C1D6, SHA1_W(75), SHA1_W(76), SHA1_W(77), SHA1_W(78), SHA1_W(79));
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+void Md5Init(SceKernelUtilsMd5Context *ctx)
+{
+    ctx->h[0] = 0x67452301;
+    ctx->h[1] = 0xEFCDAB89;
+    ctx->h[2] = 0x98BADCFE;
+    ctx->h[3] = 0x10325476;
+    ctx->ullTotalLen = 0;
+    ctx->usRemains = 0;
+    ctx->usComputed = 0;
+}
+
+void Md5Update(SceKernelUtilsMd5Context *ctx, const u8 *data, u32 size)
+{
+    u32 remaining = ctx->usRemains;
+    ctx->ullTotalLen += size;
+    if (remaining != 0) {
+        u32 n = 64 - remaining;
+        if (n > size)
+            n = size;
+        memcpy(ctx->buf + remaining, data, n);
+        remaining += n;
+        data += n;
+        size -= n;
+        if (remaining != 64) {
+            ctx->usRemains = remaining;
+            return;
+        }
+        Md5Block(ctx->h, ctx->buf);
+    }
+    // The whole blocks are hashed straight from the input
+    while (size >= 64) {
+        Md5Block(ctx->h, data);
+        data += 64;
+        size -= 64;
+    }
+    memcpy(ctx->buf, data, size);
+    ctx->usRemains = size;
+}
+
+void Md5Final(SceKernelUtilsMd5Context *ctx)
+{
+    u32 remaining = ctx->usRemains;
+    u32 i;
+    memset(ctx->buf + remaining, 0, 64 - remaining);
+    ctx->buf[remaining] = 0x80;
+    if (remaining >= 56) {
+        Md5Block(ctx->h, ctx->buf);
+        memset(ctx->buf, 0, 64);
+    }
+    u64 bits = ctx->ullTotalLen * 8;
+    for (i = 0; i < 8; i++)
+        ctx->buf[56 + i] = bits >> (i * 8);
+    Md5Block(ctx->h, ctx->buf);
+    memset(ctx->buf, 0, 64);
+    ctx->usRemains = 0;
+    ctx->usComputed = 1;
+}
+
+void Sha1Init(SceKernelUtilsSha1Context *ctx)
+{
+    ctx->h[0] = 0x67452301;
+    ctx->h[1] = 0xEFCDAB89;
+    ctx->h[2] = 0x98BADCFE;
+    ctx->h[3] = 0x10325476;
+    ctx->h[4] = 0xC3D2E1F0;
+    ctx->ullTotalLen = 0;
+    ctx->usRemains = 0;
+    ctx->usComputed = 0;
+}
+
+void Sha1Update(SceKernelUtilsSha1Context *ctx, const u8 *data, u32 size)
+{
+    u32 remaining = ctx->usRemains;
+    ctx->ullTotalLen += size;
+    if (remaining != 0) {
+        u32 n = 64 - remaining;
+        if (n > size)
+            n = size;
+        memcpy(ctx->buf + remaining, data, n);
+        remaining += n;
+        data += n;
+        size -= n;
+        if (remaining != 64) {
+            ctx->usRemains = remaining;
+            return;
+        }
+        Sha1Block(ctx->h, ctx->buf);
+    }
+    while (size >= 64) {
+        Sha1Block(ctx->h, data);
+        data += 64;
+        size -= 64;
+    }
+    memcpy(ctx->buf, data, size);
+    ctx->usRemains = size;
+}
+
+/* Also stores the digest words in the big-endian order in 'h', which is where the digest is read from */
+void Sha1Final(SceKernelUtilsSha1Context *ctx)
+{
+    u32 remaining = ctx->usRemains;
+    u32 i;
+    memset(ctx->buf + remaining, 0, 64 - remaining);
+    ctx->buf[remaining] = 0x80;
+    if (remaining >= 56) {
+        Sha1Block(ctx->h, ctx->buf);
+        memset(ctx->buf, 0, 64);
+    }
+    u64 bits = ctx->ullTotalLen * 8;
+    for (i = 0; i < 8; i++)
+        ctx->buf[56 + i] = bits >> (56 - i * 8);
+    Sha1Block(ctx->h, ctx->buf);
+    for (i = 0; i < 5; i++)
+        ctx->h[i] = pspWsbw(ctx->h[i]);
+    memset(ctx->buf, 0, 64);
+    ctx->usRemains = 0;
+    ctx->usComputed = 1;
+}
+
+void Md5Digest(const u8 *data, u32 size, u8 *digest)
+{
+    SceKernelUtilsMd5Context ctx;
+    Md5Init(&ctx);
+    Md5Update(&ctx, data, size);
+    Md5Final(&ctx);
+    memcpy(digest, ctx.h, 16);
+}
+
+void Sha1Digest(const u8 *data, u32 size, u8 *digest)
+{
+    SceKernelUtilsSha1Context ctx;
+    Sha1Init(&ctx);
+    Sha1Update(&ctx, data, size);
+    Sha1Final(&ctx);
+    memcpy(digest, ctx.h, 20);
+}
@@ -0,0 +1,36 @@
+#ifndef DIGEST_H
+#define DIGEST_H
+
+typedef struct
+{
+    u32 h[4];
+    u32 pad;
+    u16 usRemains;
+    u16 usComputed;
+    u64 ullTotalLen;
+    u8 buf[64];
+} SceKernelUtilsMd5Context;
+
+typedef struct
+{
+    u32 h[5];
+    u16 usRemains;
+    u16 usComputed;
+    u64 ullTotalLen;
+    u8 buf[64];
+} SceKernelUtilsSha1Context;
+
+void Md5Block(u32 *h, const u8 *data);
+void Md5Init(SceKernelUtilsMd5Context *ctx);
+void Md5Update(SceKernelUtilsMd5Context *ctx, const u8 *data, u32 size);
+void Md5Final(SceKernelUtilsMd5Context *ctx);
+void Md5Digest(const u8 *data, u32 size, u8 *digest);
+
+void Sha1Block(u32 *h, const u8 *data);
+void Sha1Init(SceKernelUtilsSha1Context *ctx);
+void Sha1Update(SceKernelUtilsSha1Context *ctx, const u8 *data, u32 size);
+void Sha1Final(SceKernelUtilsSha1Context *ctx);
+void Sha1Digest(const u8 *data, u32 size, u8 *digest);
+
+#endif
+
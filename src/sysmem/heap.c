@@ -5,6 +5,7 @@
 #include "intr.h"
 #include "memory.h"
 #include "partition.h"
+#include "trace.h"
 
 #include "heap.h"
 
@@ -17,12 +18,22 @@ s32 heap_do_totalfreesize(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc, int
 s32 _TotalFreeSize(SceSysmemHeap *heap);
 s32 _DeleteHeap(SceSysmemHeap *heap);
 
+u32 HeapSizeClass(u32 size);
+SceSysmemLowheap *HeapBlockOwner(SceSysmemHeap *heap, SceSysmemLowheapBlock *block);
+s32 HeapCacheBlock(SceSysmemHeap *heap, void *addr);
+void *HeapRefillSizeClass(SceSysmemHeap *heap, u32 sizeClass);
+u32 HeapFlushSizeClasses(SceSysmemHeap *heap);
+void HeapReleaseBlock(SceSysmemHeap *heap, SceSysmemHeapBlock *block);
+u32 HeapCountEmptyBlocks(SceSysmemHeap *heap);
+u32 HeapTrim(SceSysmemHeap *heap, u32 keepCount);
+
 // 145A4
 SceSysmemUidCB *g_HeapType;
 
 SceUID sceKernelCreateHeap(SceUID mpid, SceSize size, int flag, const char *name)
 {
     int oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceSysmemMemoryPartition *part = MpidToCB(mpid);
     SceSysmemUidCB *uid;
     if (part == NULL) {
@@ -59,18 +70,162 @@ SceUID sceKernelCreateHeap(SceUID mpid, SceSize size, int flag, const char *name
     block->prev = block;
     initheap((SceSysmemLowheap*)(block + 1), size - 8);
     heap->firstBlock = block;
+    if ((flag & SCE_KERNEL_HEAP_ATTR_SEGREGATED) != 0) {
+        /* The caches live in the first block, which is only released when the heap is deleted */
+        heap->sizeClasses = hmalloc(heap, (SceSysmemLowheap*)(block + 1), HEAP_SIZE_CLASS_COUNT * sizeof(SceSysmemHeapSizeClass), 0);
+        if (heap->sizeClasses == NULL) {
+            ((SceSysmemLowheap*)(block + 1))->addr = 0;
+            _FreePartitionMemory(block);
+            heap->firstBlock = NULL;
+            sceKernelDeleteUID(uid->uid);
+            resumeIntr(oldIntr);
+            return 0x800200DC;
+        }
+        memset(heap->sizeClasses, 0, HEAP_SIZE_CLASS_COUNT * sizeof(SceSysmemHeapSizeClass));
+    }
     resumeIntr(oldIntr);
     return uid->uid;
 }
 
+/* Returns the size class of an allocation of 'size' bytes (HEAP_SIZE_CLASS_COUNT if it is too big for one) */
+u32 HeapSizeClass(u32 size)
+{
+    if (size > HEAP_SIZE_CLASS_MAX)
+        return HEAP_SIZE_CLASS_COUNT;
+    if (size < 8)
+        size = 8;
+    return (UPALIGN8(size) >> 3) - 1;
+}
+
+/* Finds the lowheap of 'heap' owning the allocated lowheap block 'block', NULL if there is none */
+SceSysmemLowheap *HeapBlockOwner(SceSysmemHeap *heap, SceSysmemLowheapBlock *block)
+{
+    SceSysmemLowheap *lowh = (SceSysmemLowheap *)block->next;
+    if ((u32)lowh - heap->partAddr >= heap->partSize || lowh->addr != (u32)lowh - 1)
+        return NULL;
+    if ((u32)block < (u32)(lowh + 1) || (u32)block >= (u32)lowh + lowh->size)
+        return NULL;
+    SceSysmemHeapBlock *cur = heap->firstBlock;
+    for (;;) {
+        if ((SceSysmemLowheap *)(cur + 1) == lowh)
+            return lowh;
+        cur = cur->next;
+        if (cur == heap->firstBlock)
+            return NULL;
+    }
+}
+
+/*
+ * Puts a freed small block in its size class cache. Returns 1 if it was cached, 0 if it must be given back to its
+ * lowheap, and 0x800200D3 if it already is in the cache (the block is freed twice).
+ */
+s32 HeapCacheBlock(SceSysmemHeap *heap, void *addr)
+{
+    if (addr == NULL || ((u32)addr & 7) != 0 || (u32)addr - heap->partAddr >= heap->partSize)
+        return 0;
+    SceSysmemLowheapBlock *block = (SceSysmemLowheapBlock *)addr - 1;
+    if (block->count < 2 || block->count - 1 > HEAP_SIZE_CLASS_COUNT)
+        return 0;
+    if (HeapBlockOwner(heap, block) == NULL)
+        return 0;
+    SceSysmemHeapSizeClass *sizeClass = &heap->sizeClasses[block->count - 2];
+    /* Cached blocks are still allocated in their lowheap, so this is the only place a double free can be seen */
+    void *cur;
+    for (cur = sizeClass->head; cur != NULL; cur = *(void **)cur) {
+        if (cur == addr)
+            return 0x800200D3;
+    }
+    if (sizeClass->count >= HEAP_SIZE_CLASS_DEPTH)
+        return 0;
+    /* The block stays allocated in the lowheap; its first word links it in the cache */
+    *(void **)addr = sizeClass->head;
+    sizeClass->head = addr;
+    sizeClass->count++;
+    return 1;
+}
+
+/*
+ * Allocates a block of the given size class from the lowheaps, plus a few more which are put in the class cache
+ * so the next allocations don't need to walk the lowheap free lists. Returns NULL if no lowheap had enough space.
+ */
+void *HeapRefillSizeClass(SceSysmemHeap *heap, u32 sizeClass)
+{
+    SceSysmemHeapSizeClass *cache = &heap->sizeClasses[sizeClass];
+    u32 size = (sizeClass + 1) * 8;
+    SceSysmemHeapBlock *block = heap->firstBlock;
+    for (;;) {
+        SceSysmemLowheap *lowh = (SceSysmemLowheap*)(block + 1);
+        void *ret = hmalloc(heap, lowh, size, 0);
+        if (ret != NULL) {
+            u32 i;
+            for (i = 1; i < HEAP_SIZE_CLASS_REFILL && cache->count < HEAP_SIZE_CLASS_DEPTH; i++) {
+                void *extra = hmalloc(heap, lowh, size, 0);
+                if (extra == NULL)
+                    break;
+                *(void **)extra = cache->head;
+                cache->head = extra;
+                cache->count++;
+            }
+            if (i > 1)
+                heap->cacheRefills++;
+            return ret;
+        }
+        block = block->next;
+        if (block == heap->firstBlock)
+            return NULL;
+    }
+}
+
+/* Gives back all the blocks kept in the size class caches to their lowheap; returns the number of blocks released */
+u32 HeapFlushSizeClasses(SceSysmemHeap *heap)
+{
+    u32 count = 0;
+    u32 i;
+    for (i = 0; i < HEAP_SIZE_CLASS_COUNT; i++) {
+        void *cur = heap->sizeClasses[i].head;
+        heap->sizeClasses[i].head = NULL;
+        heap->sizeClasses[i].count = 0;
+        while (cur != NULL) {
+            void *next = *(void **)cur;
+            SceSysmemLowheapBlock *block = (SceSysmemLowheapBlock *)cur - 1;
+            hfree(heap, (SceSysmemLowheap *)block->next, cur);
+            count++;
+            cur = next;
+        }
+    }
+    return count;
+}
+
 void *_AllocHeapMemory(SceSysmemHeap *heap, u32 size, u32 align)
 {
     if (size > 0x20000000)
         return 0;
     if (align != 0 && ((align & 3) != 0 || align > 0x80 || ((align - 1) & align) != 0))
         return 0;
+    if (heap->sizeClasses != NULL && align <= 8) {
+        u32 sizeClass = HeapSizeClass(size);
+        if (sizeClass < HEAP_SIZE_CLASS_COUNT) {
+            SceSysmemHeapSizeClass *cache = &heap->sizeClasses[sizeClass];
+            void *ret = cache->head;
+            if (ret != NULL) {
+                cache->head = *(void **)ret;
+                cache->count--;
+                heap->cacheHits++;
+                return ret;
+            }
+            heap->cacheMisses++;
+            ret = HeapRefillSizeClass(heap, sizeClass);
+            if (ret != NULL)
+                return ret;
+        }
+    }
     // 30A8
-    SceSysmemHeapBlock *block = heap->firstBlock;
+    /* Start with the block which satisfied the last allocation, it is the most likely to have space left */
+    SceSysmemHeapBlock *start = heap->lastBlock;
+    if (start == NULL || ((SceSysmemLowheap*)(start + 1))->addr != (u32)(start + 1) - 1 || start->next->prev != start)
+        start = heap->firstBlock;
+    SceSysmemHeapBlock *block = start;
+    heap->allocCount++;
     // 30B4
     for (;;) {
         if ((int)block - heap->partAddr >= heap->partSize) {
@@ -81,12 +236,19 @@ void *_AllocHeapMemory(SceSysmemHeap *heap, u32 size, u32 align)
             pspBreak(0);
         }
         // 30F4
+        heap->allocWalks++;
         void *ret = hmalloc(heap, (SceSysmemLowheap*)(block + 1), size, align);
-        if (ret != NULL)
+        if (ret != NULL) {
+            heap->lastBlock = block;
             return ret;
-        if (block == heap->firstBlock)
-            break;
+        }
         block = block->next;
+        if (block == start) {
+            /* Merge the cached small blocks back before trying again or growing the heap */
+            if (heap->sizeClasses != NULL && HeapFlushSizeClasses(heap) != 0)
+                continue;
+            break;
+        }
     }
     if (heap->size < 4) // 312C
         return heap;
@@ -117,11 +279,19 @@ void *_AllocHeapMemory(SceSysmemHeap *heap, u32 size, u32 align)
     block->prev = heap->firstBlock->prev;
     heap->firstBlock->prev = block;
     block->prev->next = block;
+    heap->lastBlock = block;
     return hmalloc(heap, (SceSysmemLowheap*)(block + 1), size, align);
 }
 
 s32 _FreeHeapMemory(SceSysmemHeap *heap, void *addr)
 {
+    if (heap->sizeClasses != NULL) {
+        s32 ret = HeapCacheBlock(heap, addr);
+        if (ret < 0)
+            return ret;
+        if (ret != 0)
+            return 0;
+    }
     SceSysmemHeapBlock *block = heap->firstBlock->next;
     // 3254
     for (;;) {
@@ -139,10 +309,9 @@ s32 _FreeHeapMemory(SceSysmemHeap *heap, void *addr)
             if (block != heap->firstBlock) {
                 if (checkheapnouse(lowh) != 0) {
                     // 3300
-                    lowh->addr = 0;
-                    block->next->prev = block->prev;
-                    block->prev->next = block->next;
-                    _FreePartitionMemory(block);
+                    /* Keep a few empty blocks if asked to, so the next burst doesn't need to grow the heap again */
+                    if (heap->maxEmptyBlocks == 0 || HeapCountEmptyBlocks(heap) > heap->maxEmptyBlocks)
+                        HeapReleaseBlock(heap, block);
                 }
                 return 0;
             }
@@ -153,6 +322,87 @@ s32 _FreeHeapMemory(SceSysmemHeap *heap, void *addr)
     }
 }
 
+/* Gives back a grown block of the heap to the partition */
+void HeapReleaseBlock(SceSysmemHeap *heap, SceSysmemHeapBlock *block)
+{
+    SceSysmemLowheap *lowh = (SceSysmemLowheap*)(block + 1);
+    if (heap->lastBlock == block)
+        heap->lastBlock = NULL;
+    lowh->addr = 0;
+    block->next->prev = block->prev;
+    block->prev->next = block->next;
+    _FreePartitionMemory(block);
+    heap->releasedBlocks++;
+}
+
+/* Returns the number of grown blocks of the heap which don't contain any allocation */
+u32 HeapCountEmptyBlocks(SceSysmemHeap *heap)
+{
+    u32 count = 0;
+    SceSysmemHeapBlock *block = heap->firstBlock->next;
+    while (block != heap->firstBlock) {
+        if (checkheapnouse((SceSysmemLowheap*)(block + 1)) != 0)
+            count++;
+        block = block->next;
+    }
+    return count;
+}
+
+/* Releases the empty grown blocks of the heap, except for 'keepCount' of them; returns the number of blocks released */
+u32 HeapTrim(SceSysmemHeap *heap, u32 keepCount)
+{
+    u32 count = 0;
+    /* Cached blocks keep their lowheap busy */
+    if (heap->sizeClasses != NULL)
+        HeapFlushSizeClasses(heap);
+    SceSysmemHeapBlock *block = heap->firstBlock->next;
+    while (block != heap->firstBlock) {
+        SceSysmemHeapBlock *next = block->next;
+        if (checkheapnouse((SceSysmemLowheap*)(block + 1)) != 0) {
+            if (keepCount != 0)
+                keepCount--;
+            else {
+                HeapReleaseBlock(heap, block);
+                count++;
+            }
+        }
+        block = next;
+    }
+    return count;
+}
+
+s32 sceKernelSetHeapTrimThreshold(SceUID id, u32 maxEmptyBlocks)
+{
+    s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
+    SceSysmemUidCB *uid;
+    s32 ret = sceKernelGetUIDcontrolBlockWithType(id, g_HeapType, &uid);
+    if (ret != 0) {
+        resumeIntr(oldIntr);
+        return ret;
+    }
+    SceSysmemHeap *heap = UID_CB_TO_DATA(uid, g_HeapType, SceSysmemHeap);
+    heap->maxEmptyBlocks = maxEmptyBlocks;
+    HeapTrim(heap, maxEmptyBlocks);
+    resumeIntr(oldIntr);
+    return 0;
+}
+
+s32 sceKernelHeapCompact(SceUID id)
+{
+    s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
+    SceSysmemUidCB *uid;
+    s32 ret = sceKernelGetUIDcontrolBlockWithType(id, g_HeapType, &uid);
+    if (ret != 0) {
+        resumeIntr(oldIntr);
+        return ret;
+    }
+    ret = HeapTrim(UID_CB_TO_DATA(uid, g_HeapType, SceSysmemHeap), 0);
+    resumeIntr(oldIntr);
+    return ret;
+}
+
 int sceKernelQueryHeapInfo(SceUID id, SceSysmemHeapInfo *info)
 {
     if (info->size < 64)
@@ -166,6 +416,9 @@ int sceKernelQueryHeapInfo(SceUID id, SceSysmemHeapInfo *info)
         return ret;
     }
     SceSysmemHeap *heap = UID_CB_TO_DATA(uid, g_HeapType, SceSysmemHeap);
+    /* Report the cached blocks as free */
+    if (heap->sizeClasses != NULL)
+        HeapFlushSizeClasses(heap);
     // 33B8
     int i;
     for (i = 0; i < 6; i++)
@@ -233,6 +486,41 @@ int sceKernelQueryHeapInfo(SceUID id, SceSysmemHeapInfo *info)
     return 0;
 }
 
+s32 sceKernelQueryHeapStats(SceUID id, SceSysmemHeapStats *stats)
+{
+    if (stats->size < sizeof(SceSysmemHeapStats))
+        return 0x800200D2;
+    s32 oldIntr = suspendIntr();
+    SceSysmemUidCB *uid;
+    s32 ret = sceKernelGetUIDcontrolBlockWithType(id, g_HeapType, &uid);
+    if (ret != 0) {
+        resumeIntr(oldIntr);
+        return ret;
+    }
+    SceSysmemHeap *heap = UID_CB_TO_DATA(uid, g_HeapType, SceSysmemHeap);
+    stats->size = sizeof(SceSysmemHeapStats);
+    stats->cacheHits = heap->cacheHits;
+    stats->cacheMisses = heap->cacheMisses;
+    stats->cacheRefills = heap->cacheRefills;
+    stats->cachedBlocks = 0;
+    if (heap->sizeClasses != NULL) {
+        u32 i;
+        for (i = 0; i < HEAP_SIZE_CLASS_COUNT; i++)
+            stats->cachedBlocks += heap->sizeClasses[i].count;
+    }
+    stats->ringLength = 0;
+    SceSysmemHeapBlock *block = heap->firstBlock;
+    do {
+        stats->ringLength++;
+        block = block->next;
+    } while (block != heap->firstBlock);
+    stats->allocCount = heap->allocCount;
+    stats->allocWalks = heap->allocWalks;
+    stats->releasedBlocks = heap->releasedBlocks;
+    resumeIntr(oldIntr);
+    return 0;
+}
+
 s32 sceKernelQueryLowheapInfo(SceSysmemHeapBlock *block, SceSysmemLowheapInfo *info)
 {
     u32 maxInfoSize = info->size;
@@ -324,6 +612,7 @@ int _CreateHeap(void *partition, int size, int attr, SceSysmemHeapBlock **out)
 int sceKernelDeleteHeap(SceUID id)
 {
     int oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     int ret = sceKernelDeleteUID(id);
     resumeIntr(oldIntr);
     return ret;
@@ -332,6 +621,7 @@ int sceKernelDeleteHeap(SceUID id)
 void *sceKernelAllocHeapMemoryWithOption(SceUID id, int size, SceSysmemHeapAllocOption *opt)
 {
     int oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceSysmemUidCB *uid;
     if (sceKernelGetUIDcontrolBlockWithType(id, g_HeapType, &uid) != 0) {
         // 382C
@@ -347,6 +637,7 @@ void *sceKernelAllocHeapMemoryWithOption(SceUID id, int size, SceSysmemHeapAlloc
 void *sceKernelAllocHeapMemory(SceUID id, int size)
 {
     int oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceSysmemUidCB *uid;
     if (sceKernelGetUIDcontrolBlockWithType(id, g_HeapType, &uid) != 0) {
         resumeIntr(oldIntr);
@@ -361,6 +652,7 @@ void *sceKernelAllocHeapMemory(SceUID id, int size)
 s32 sceKernelFreeHeapMemory(SceUID id, void *addr)
 {
     s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceSysmemUidCB *uid;
     s32 ret = sceKernelGetUIDcontrolBlockWithType(id, g_HeapType, &uid);
     if (ret == 0)
@@ -389,6 +681,15 @@ s32 heap_do_initialize(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc, int fun
     heap->size = 0;
     heap->partId = 0;
     heap->firstBlock = NULL;
+    heap->sizeClasses = NULL;
+    heap->cacheHits = 0;
+    heap->cacheMisses = 0;
+    heap->cacheRefills = 0;
+    heap->lastBlock = NULL;
+    heap->maxEmptyBlocks = 0;
+    heap->allocCount = 0;
+    heap->allocWalks = 0;
+    heap->releasedBlocks = 0;
     return uid->uid;
 }
 
@@ -454,6 +755,8 @@ s32 _DeleteHeap(SceSysmemHeap *heap)
 s32 _TotalFreeSize(SceSysmemHeap *heap)
 {
     s32 size = 0;
+    if (heap->sizeClasses != NULL)
+        HeapFlushSizeClasses(heap);
     SceSysmemHeapBlock *cur = heap->firstBlock;
     for (;;) {
         if ((u32)cur - heap->partAddr >= heap->partSize) {
@@ -9,12 +9,35 @@ typedef struct {
     // followed by blocks
 } SceSysmemLowheap;
 
+/* Largest allocation size kept in a per-size-class free list (SCE_KERNEL_HEAP_ATTR_SEGREGATED heaps) */
+#define HEAP_SIZE_CLASS_MAX     256
+/* One size class every 8 bytes, from 8 to HEAP_SIZE_CLASS_MAX */
+#define HEAP_SIZE_CLASS_COUNT   (HEAP_SIZE_CLASS_MAX / 8)
+/* Maximum number of freed blocks kept per size class */
+#define HEAP_SIZE_CLASS_DEPTH   16
+/* Number of blocks taken from the lowheap at once when a size class is empty */
+#define HEAP_SIZE_CLASS_REFILL  4
+
+typedef struct {
+    void *head; // 0 first cached block, the next ones are linked through their first word
+    u32 count; // 4
+} SceSysmemHeapSizeClass;
+
 typedef struct {
     int size; // 0
     int partId; // 4
     u32 partAddr; // 8
     u32 partSize; // 12
     SceSysmemHeapBlock *firstBlock; // 16
+    SceSysmemHeapSizeClass *sizeClasses; // 20 one cache per size class (NULL if the heap is not segregated)
+    u32 cacheHits; // 24
+    u32 cacheMisses; // 28
+    u32 cacheRefills; // 32
+    SceSysmemHeapBlock *lastBlock; // 36 block which satisfied the last allocation, tried first by the next one
+    u32 maxEmptyBlocks; // 40 number of empty grown blocks kept instead of being released
+    u32 allocCount; // 44
+    u32 allocWalks; // 48 number of lowheaps tried by all the allocations
+    u32 releasedBlocks; // 52
 } SceSysmemHeap;
 
 void HeapInit(void);
@@ -1,4 +1,5 @@
 #include <stdarg.h>
+#include <sysmem_kdebug.h>
 #include <sysmem_sysclib.h>
 
 #include <common_imp.h>
@@ -7,6 +8,28 @@
 #include "start.h"
 
 int kprnt(short *arg0, const char *fmt, va_list ap, int userMode);
+void KprintfRingPutchar(short *work, int c);
+
+/*
+ * When a buffer is set with sceKernelKprintfSetBuffer(), kprnt() formats the messages into this ring instead of
+ * calling the debug putchar handler, and sceKernelKprintfDrain() later sends them to the handler. The messages are
+ * formatted with the interrupts suspended so there is a single producer, which only writes 'head', and a single
+ * consumer, which only writes 'tail'. A message which doesn't fit is dropped entirely.
+ */
+typedef struct {
+    char *buf;
+    u32 size; // power of 2, 0 if the messages aren't buffered
+    volatile u32 head; // end of the last complete message
+    volatile u32 tail; // start of the data not drained yet
+    u32 cur; // end of the message being formatted
+    u32 overflow; // size of the message being formatted which didn't fit
+    u32 dropped;
+    u32 droppedSize;
+} SceKprintfRing;
+
+SceKprintfRing g_KprintfRing;
+/* Work area given to KprintfRingPutchar(), so the one of the putchar handler is only used by the drain */
+short g_KprintfRingWork[4];
 
 // 14434
 char kprnt_outbuf[260];
@@ -204,12 +227,16 @@ int kprnt(short *arg0, const char *fmt, va_list ap, int userMode)
 {
     char str[20];
     void (*func)(short*, int) = kprintf_putchar_handler;
+    if (g_KprintfRing.size != 0) {
+        func = KprintfRingPutchar;
+        arg0 = g_KprintfRingWork;
+    }
     *(short*)(arg0 + 0) = 1;
     int base = 10;
     *(short*)(arg0 + 2) = 0;
     int curArg = 0;
     s64 longVar;
-    if (kprintf_putchar_handler == NULL || fmt == NULL)
+    if (func == NULL || fmt == NULL)
         return 0;
     func(arg0, 512);
     char *hexNumChars = "0123456789abcdef";
@@ -639,6 +666,79 @@ int kprnt(short *arg0, const char *fmt, va_list ap, int userMode)
     }
 }
 
+void KprintfRingPutchar(short *work __attribute__((unused)), int c)
+{
+    SceKprintfRing *ring = &g_KprintfRing;
+    if (c == 512) {
+        // start of a message
+        ring->cur = ring->head;
+        ring->overflow = 0;
+    } else if (c == 513) {
+        // end of a message
+        if (ring->overflow != 0) {
+            ring->dropped++;
+            ring->droppedSize += ring->cur - ring->head + ring->overflow;
+        } else
+            ring->head = ring->cur;
+    } else if (c < 256) {
+        if (ring->overflow != 0 || ring->cur - ring->tail >= ring->size)
+            ring->overflow++;
+        else
+            ring->buf[(ring->cur++) & (ring->size - 1)] = c;
+    }
+}
+
+s32 sceKernelKprintfSetBuffer(void *buf, u32 size)
+{
+    if (buf != NULL && (size < 64 || (size & (size - 1)) != 0))
+        return 0x80000104;
+    s32 oldIntr = suspendIntr();
+    g_KprintfRing.size = 0;
+    g_KprintfRing.buf = buf;
+    g_KprintfRing.head = 0;
+    g_KprintfRing.tail = 0;
+    g_KprintfRing.dropped = 0;
+    g_KprintfRing.droppedSize = 0;
+    if (buf != NULL)
+        g_KprintfRing.size = size;
+    resumeIntr(oldIntr);
+    return 0;
+}
+
+s32 sceKernelKprintfDrain(u32 maxSize)
+{
+    SceKprintfRing *ring = &g_KprintfRing;
+    void (*func)(short*, int) = kprintf_putchar_handler;
+    if (ring->size == 0 || func == NULL)
+        return 0;
+    u32 tail = ring->tail;
+    u32 size = ring->head - tail;
+    if (size > maxSize)
+        size = maxSize;
+    if (size == 0)
+        return 0;
+    u32 i;
+    func(kprintwork, 512);
+    for (i = 0; i < size; i++)
+        func(kprintwork, ring->buf[(tail + i) & (ring->size - 1)]);
+    func(kprintwork, 513);
+    ring->tail = tail + size;
+    return size;
+}
+
+s32 sceKernelKprintfGetBufferStats(SceKernelKprintfBufferStats *stats)
+{
+    if (stats == NULL)
+        return 0x80000103;
+    s32 oldIntr = suspendIntr();
+    stats->size = g_KprintfRing.size;
+    stats->used = g_KprintfRing.head - g_KprintfRing.tail;
+    stats->dropped = g_KprintfRing.dropped;
+    stats->droppedSize = g_KprintfRing.droppedSize;
+    resumeIntr(oldIntr);
+    return 0;
+}
+
 int sceKernelPrintf(const char *fmt, ...) __attribute__((alias("KprintfForUser")));
 
 int KprintfForUser(const char *fmt, ...)
@@ -721,12 +821,12 @@ int _CheckDebugHandler(void *ptr, u32 size)
     return ret;
 }
 
-int sceKernelDebugWrite()
+int sceKernelDebugWrite(SceUID fd, const void *data, SceSize size)
 {
     int (*func)() = debug_write_handler;
     if (func == NULL)
         return 0x80020001;
-    return func();
+    return func(fd, data, size);
 }
 
 int sceKernelRegisterDebugWrite(int (*func)())
@@ -735,12 +835,12 @@ int sceKernelRegisterDebugWrite(int (*func)())
     return 0;
 }
 
-int sceKernelDebugRead()
+int sceKernelDebugRead(SceUID fd, const void *data, SceSize size)
 {
     int (*func)() = debug_read_handler;
     if (func == NULL)
         return 0x80020001;
-    return func();
+    return func(fd, data, size);
 }
 
 int sceKernelRegisterDebugRead(int (*func)())
@@ -1,5 +1,8 @@
 #include <sysmem_kernel.h>
 
+#include "intr.h"
+#include "trace.h"
+
 SceUID sceKernelAllocMemoryBlock(char *name, u32 type, u32 size, SceSysmemMemoryBlockAllocOption *opt)
 {
     s32 oldK1 = pspShiftK1();
@@ -16,7 +19,11 @@ SceUID sceKernelAllocMemoryBlock(char *name, u32 type, u32 size, SceSysmemMemory
         pspSetK1(oldK1);
         return 0x800200D8;
     }
+    // the interrupts stay disabled so that the allocation is recorded with this caller
+    s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceUID id = sceKernelAllocPartitionMemory(2, name, type, size, 0);
+    resumeIntr(oldIntr);
     pspSetK1(oldK1);
     return id;
 }
@@ -24,7 +31,10 @@ SceUID sceKernelAllocMemoryBlock(char *name, u32 type, u32 size, SceSysmemMemory
 s32 sceKernelFreeMemoryBlock(SceUID id)
 {
     s32 oldK1 = pspShiftK1();
+    s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     s32 ret = sceKernelFreePartitionMemory(id);
+    resumeIntr(oldIntr);
     pspSetK1(oldK1);
     return ret;
 }
@@ -6,6 +6,8 @@
 #include "sysmem.h"
 
 #include "memory.h"
+#include "reclaim.h"
+#include "trace.h"
 
 s32 block_do_initialize(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc, int funcId, va_list ap);
 s32 block_do_delete(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc, int funcId, va_list ap);
@@ -92,14 +94,14 @@ s32 sceKernelResizeMemoryBlock(SceUID id, s32 leftShift, s32 rightShift)
     }
     // 4F84
     if (leftShift > 0) {
-        if (prevSeg->used != 0)
+        if (prevSeg == NULL || prevSeg->used != 0)
             goto fail;
         if (prevSeg->size < leftSegs)
             goto fail;
     }
     // 4FB0
     if (rightShift > 0) {
-        if (nextSeg->used != 0)
+        if (nextSeg == NULL || nextSeg->used != 0)
             goto fail;
         if (nextSeg->size < rightSegs)
             goto fail;
@@ -130,16 +132,21 @@ s32 sceKernelResizeMemoryBlock(SceUID id, s32 leftShift, s32 rightShift)
                 ctlBlk->segCount++;
                 newPrevSeg->offset = seg->offset - leftSegs;
                 newPrevSeg->size = leftSegs;
+                part->freeSegs += leftSegs;
+                _RaiseMaxFreeSegs(part, leftSegs);
                 // 523C dup
                 updateSmemCtlBlk(part, (SceSysmemCtlBlk*)((u32)newPrevSeg & 0xFFFFFF00));
             } else {
                 // 504C dup
                 prevSeg->size += leftSegs;
+                part->freeSegs += leftSegs;
+                _RaiseMaxFreeSegs(part, prevSeg->size);
             }
         } else {
             memBlock->size += leftSegs << 8;
             seg->offset -= leftSegs;
             seg->size += leftSegs;
+            part->freeSegs -= leftSegs;
             if (prevSeg->size == leftSegs) {
                 // 5224
                 _ReturnSegBlankList(prevSeg);
@@ -173,14 +180,19 @@ s32 sceKernelResizeMemoryBlock(SceUID id, s32 leftShift, s32 rightShift)
                 ctlBlk->segCount++;
                 newNextSeg->offset = seg->offset + seg->size;
                 newNextSeg->size = rightSegs;
+                part->freeSegs += rightSegs;
+                _RaiseMaxFreeSegs(part, rightSegs);
                 updateSmemCtlBlk(part, (SceSysmemCtlBlk*)((u32)newNextSeg & 0xFFFFFF00));
             } else {
                 nextSeg->size += rightSegs;
                 nextSeg->offset -= rightSegs;
+                part->freeSegs += rightSegs;
+                _RaiseMaxFreeSegs(part, nextSeg->size);
             }
         } else {
             memBlock->size += (rightSegs << 8);
             seg->size += rightSegs;
+            part->freeSegs -= rightSegs;
             if (nextSeg->size != rightSegs) {
                 nextSeg->size -= rightSegs;
                 nextSeg->offset += rightSegs;
@@ -200,9 +212,98 @@ fail:
     return 0x800200DB;
 }
 
+/*
+ * Resize a memory block from its end, growing it in place when the segment after it is free and large enough, or
+ * else moving its content to a new area of the same partition, allocated with the block's original type and
+ * alignment. The copy runs with interrupts enabled while the block is size-locked. The UID stays the same but the
+ * address may change.
+ */
+s32 sceKernelReallocPartitionMemory(SceUID id, u32 size)
+{
+    if (size == 0 || size > 0x7FFFFF00)
+        return 0x800200D2;
+    u32 newSize = (size + 0xFF) & 0xFFFFFF00;
+    s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
+    SceSysmemUidCB *uid;
+    s32 ret = sceKernelGetUIDcontrolBlockWithType(id, g_MemBlockType, &uid);
+    if (ret != 0) {
+        resumeIntr(oldIntr);
+        return ret;
+    }
+    SceSysmemMemoryBlock *memBlock = UID_CB_TO_DATA(uid, g_MemBlockType, SceSysmemMemoryBlock);
+    SceSysmemMemoryPartition *part = memBlock->part;
+    SceSysmemSeg *seg = AddrToSeg(part, memBlock->addr);
+    if (seg == NULL || seg->used == 0 || seg->isProtected) {
+        resumeIntr(oldIntr);
+        return 0x800200DB;
+    }
+    if (seg->sizeLocked) {
+        resumeIntr(oldIntr);
+        return 0x800200DA;
+    }
+    if (newSize == memBlock->size) {
+        resumeIntr(oldIntr);
+        return 0;
+    }
+    // shrink, or grow over the next segment
+    ret = sceKernelResizeMemoryBlock(id, 0, (s32)newSize - (s32)memBlock->size);
+    if (ret != (s32)0x800200DB || newSize < memBlock->size) {
+        resumeIntr(oldIntr);
+        return ret;
+    }
+    // a block allocated at a fixed address cannot move
+    if (memBlock->type == 2) {
+        resumeIntr(oldIntr);
+        return ret;
+    }
+    void *newAddr = ReclaimAllocSysMemory(part, memBlock->type, newSize, memBlock->align);
+    if (newAddr == NULL) {
+        resumeIntr(oldIntr);
+        return 0x800200D9;
+    }
+    // size-lock the block so that it cannot be resized, jointed or separated while its content is copied
+    void *oldAddr = memBlock->addr;
+    u32 oldSize = memBlock->size;
+    seg->sizeLocked = 1;
+    resumeIntr(oldIntr);
+
+    memcpy(newAddr, oldAddr, oldSize);
+
+    oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
+    // the block may have been freed during the copy, so it is looked up again from its UID
+    ret = sceKernelGetUIDcontrolBlockWithType(id, g_MemBlockType, &uid);
+    if (ret == 0) {
+        memBlock = UID_CB_TO_DATA(uid, g_MemBlockType, SceSysmemMemoryBlock);
+        seg = NULL;
+        if (memBlock->part == part && memBlock->addr == oldAddr)
+            seg = AddrToSeg(part, oldAddr);
+        if (seg == NULL)
+            ret = 0x800200DB;
+    }
+    if (ret != 0) {
+        _freeSysMemory(part, newAddr);
+        resumeIntr(oldIntr);
+        return ret;
+    }
+    seg->sizeLocked = 0;
+    ret = _freeSysMemory(part, oldAddr);
+    if (ret != 0) {
+        _freeSysMemory(part, newAddr);
+        resumeIntr(oldIntr);
+        return ret;
+    }
+    memBlock->addr = newAddr;
+    memBlock->size = newSize;
+    resumeIntr(oldIntr);
+    return 0;
+}
+
 s32 sceKernelJointMemoryBlock(SceUID id1, SceUID id2)
 {
     s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceSysmemUidCB *uid1, *uid2;
     s32 ret = sceKernelGetUIDcontrolBlockWithType(id1, g_MemBlockType, &uid1);
     if (ret != 0)
@@ -243,6 +344,8 @@ s32 sceKernelJointMemoryBlock(SceUID id1, SceUID id2)
     newMemBlock->addr = memBlock1->addr;
     newMemBlock->size = seg1->size << 8;
     newMemBlock->part = memBlock1->part;
+    newMemBlock->type = memBlock1->type;
+    newMemBlock->align = memBlock1->align;
     if (sceKernelIsToolMode() != 0 && sceKernelDipsw(24) == 1) { // 5614
         if (newMemBlock->part == MpidToCB(2)) {
             newMemBlock->size -= 256;
@@ -270,6 +373,7 @@ fail:
 s32 sceKernelSeparateMemoryBlock(SceUID id, u32 cutBefore, u32 size)
 {
     s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceSysmemUidCB *uid;
     s32 ret = sceKernelGetUIDcontrolBlockWithType(id, g_MemBlockType, &uid);
     if (ret != 0)
@@ -337,6 +441,8 @@ s32 sceKernelSeparateMemoryBlock(SceUID id, u32 cutBefore, u32 size)
     newMemBlock->addr = (void *)(memBlock->part->addr + (freeSeg->offset << 8));
     newMemBlock->size = freeSeg->size << 8;
     newMemBlock->part = memBlock->part;
+    newMemBlock->type = memBlock->type;
+    newMemBlock->align = memBlock->align;
     if (sceKernelIsToolMode() != 0) {
         // 590C
         if (sceKernelDipsw(24) == 1) {
@@ -491,7 +597,7 @@ s32 sceKernelQueryMemoryBlockInfo(SceUID id, SceSysmemMemoryBlockInfo *infoPtr)
     return 0;
 }
 
-void *_allocSysMemory(SceSysmemMemoryPartition *part, int type, u32 size, u32 addr, SceSysmemCtlBlk **ctlBlkOut)
+void *SYSMEM_TRACED(_allocSysMemory)(SceSysmemMemoryPartition *part, int type, u32 size, u32 addr, SceSysmemCtlBlk **ctlBlkOut)
 {
     u32 numSegs = (size + 0xFF) >> 8;
     if (numSegs == 0)
@@ -502,9 +608,17 @@ void *_allocSysMemory(SceSysmemMemoryPartition *part, int type, u32 size, u32 ad
             (type != 0 || part->firstCtlBlk->segs[part->firstCtlBlk->firstSeg].used == 1))
             numSegs++;
     }
+    /* No free segment is big enough, don't bother scanning the control blocks.
+       Fixed-address requests still go through the lookup below, which tells why they can't be satisfied.
+       TODO: the requests which can be satisfied still scan the segments linearly. A free segment index
+       (size-ordered tree or bitmap) kept by FreeUsedSeg, SeparateSmemCtlBlk and updateSmemCtlBlk is a separate
+       work item; this bound only makes the failing requests cheap. */
+    if (type != 2 && numSegs > part->maxFreeSegs)
+        return 0;
     SceSysmemCtlBlk *curCtlBlk;
     SceSysmemSeg *curSeg;
     u32 blockOff;
+    u32 maxFreeSegs = 0;
     // (5E84)
     // 5E88
     switch (type) // jump table at 0x1355C
@@ -673,6 +787,7 @@ alloc_lo:
                         goto alloc_success;
                     goto alloc_enlargeBlock;
                 }
+                maxFreeSegs = pspMax(maxFreeSegs, curSeg->size);
             }
             // 5F1C
             i++;
@@ -681,6 +796,8 @@ alloc_lo:
         // 5F40
         curCtlBlk = curCtlBlk->next;
     }
+    /* Every free segment has been seen: the bound is now exact */
+    part->maxFreeSegs = maxFreeSegs;
     return 0;
 
 alloc_enlargeBlock:
@@ -706,6 +823,7 @@ alloc_enlargeBlock:
     }
 
 alloc_success:
+    part->freeSegs -= numSegs;
     if (sceKernelIsToolMode() && sceKernelDipsw(24) == 1 && part == MpidToCB(2)) { // 60C0
         u32 i;
         s32 *ptr = (s32*)(addr + (numSegs << 8) - 0x100);
@@ -763,6 +881,7 @@ alloc_hi:
                     }
                     goto alloc_success;
                 }
+                maxFreeSegs = pspMax(maxFreeSegs, curSeg->size);
             }
             // 61C0
             i++;
@@ -771,6 +890,7 @@ alloc_hi:
         // 61E8
         curCtlBlk = curCtlBlk->prev;
     }
+    part->maxFreeSegs = maxFreeSegs;
     return 0;
 
 alloc_addr:
@@ -839,6 +959,13 @@ s32 FreeUsedSeg(SceSysmemMemoryPartition *part, SceSysmemSeg *seg)
         if (ctlBlk->prev != NULL)
             prevSeg = &ctlBlk->segs[ctlBlk->prev->lastSeg];
     }
+    part->freeSegs += seg->size;
+    u32 freeSegs = seg->size;
+    if (prevSeg != NULL && prevSeg->used == 0)
+        freeSegs += prevSeg->size;
+    if (nextSeg != NULL && nextSeg->used == 0)
+        freeSegs += nextSeg->size;
+    _RaiseMaxFreeSegs(part, freeSegs);
     // 6960
     if (prevSeg != NULL && nextSeg != NULL)
     {
@@ -902,6 +1029,14 @@ s32 FreeUsedSeg(SceSysmemMemoryPartition *part, SceSysmemSeg *seg)
     return 0;
 }
 
+/* Called whenever a free segment of 'size' segments is created or grown.
+   Splitting or joining control blocks only moves segments, so it never has to update the bound. */
+void _RaiseMaxFreeSegs(SceSysmemMemoryPartition *part, u32 size)
+{
+    if (part->maxFreeSegs < size)
+        part->maxFreeSegs = size;
+}
+
 void SeparateSmemCtlBlk(SceSysmemMemoryPartition *part, SceSysmemCtlBlk *ctlBlk)
 {
     SceSysmemCtlBlk *allocedCtlBlk;
@@ -995,7 +1130,7 @@ SceSysmemUidLookupFunc MemBlockFuncs[] = {
 
 void MemoryBlockServiceInit(void)
 {
-    sceKernelCreateUIDtype("SceSysMemMemoryBlock", 12, MemBlockFuncs, 0, &g_MemBlockType);
+    sceKernelCreateUIDtype("SceSysMemMemoryBlock", sizeof(SceSysmemMemoryBlock), MemBlockFuncs, 0, &g_MemBlockType);
 }
 
 void InitSmemCtlBlk(SceSysmemCtlBlk *ctlBlk)
@@ -1023,7 +1158,7 @@ void *_AllocPartitionMemory(SceSysmemMemoryPartition *part, int type, int size,
         }
     }
     // 6EE0
-    return _allocSysMemory(part, type, size, addr, NULL);
+    return ReclaimAllocSysMemory(part, type, size, addr);
 }
 
 s32 sceKernelSizeLockMemoryBlock(SceUID id)
@@ -1064,6 +1199,7 @@ s32 sceKernelFreePartitionMemory(SceUID id)
 {
     SceSysmemUidCB *uid;
     s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     s32 ret = sceKernelGetUIDcontrolBlockWithType(id, g_MemBlockType, &uid);
     if (ret == 0)
         ret = sceKernelDeleteUID(id);
@@ -1076,6 +1212,7 @@ s32 sceKernelFreePartitionMemoryForUser(SceUID id)
 {
     s32 oldK1 = pspShiftK1();
     s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceSysmemUidCB *uid;
     s32 ret = sceKernelGetUIDcontrolBlockWithType(id, g_MemBlockType, &uid);
     if (ret == 0) {
@@ -1152,7 +1289,7 @@ void sceKernelProtectMemoryBlock(SceSysmemMemoryPartition *part, void *addr)
     AddrToSeg(part, addr)->isProtected = 1;
 }
 
-s32 _freeSysMemory(SceSysmemMemoryPartition *part, void *addr)
+s32 SYSMEM_TRACED(_freeSysMemory)(SceSysmemMemoryPartition *part, void *addr)
 {
     if (((u32)addr & 0xFF) != 0)
         return -1;
@@ -1229,6 +1366,8 @@ s32 block_do_initialize(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc, int fu
     memBlock->size = 0;
     memBlock->part = NULL;
     memBlock->addr = 0;
+    memBlock->type = 0;
+    memBlock->align = 0;
     return uid->uid;
 }
 
@@ -1562,7 +1701,7 @@ void JointSmemCtlBlk(SceSysmemMemoryPartition *part, SceSysmemCtlBlk *ctlBlk)
 
 Note: if allocation fails, results are probably unknown. */
 
-void *hmalloc(SceSysmemHeap *heap, SceSysmemLowheap *lowh, u32 size, u32 align)
+void *SYSMEM_TRACED(hmalloc)(SceSysmemHeap *heap, SceSysmemLowheap *lowh, u32 size, u32 align)
 {
     if (lowh == NULL)
         return NULL;
@@ -1660,7 +1799,7 @@ end_noresize:
     return curBlock + 1;
 }
 
-s32 hfree(SceSysmemHeap *heap, SceSysmemLowheap *lowh, void *ptr)
+s32 SYSMEM_TRACED(hfree)(SceSysmemHeap *heap, SceSysmemLowheap *lowh, void *ptr)
 {
     SceSysmemLowheapBlock *allocatedBlock = (SceSysmemLowheapBlock *)(ptr - 8);
     if (lowh == NULL || lowh->addr != (u32)lowh - 1)
@@ -17,6 +17,7 @@ void _QueryMemoryInfo(u32 address, SceUID *partitionId, SceUID *memoryBlockId);
 
 void *_allocSysMemory(SceSysmemMemoryPartition *part, int type, u32 size, u32 addr, SceSysmemCtlBlk **ctlBlkOut);
 s32 _freeSysMemory(SceSysmemMemoryPartition *part, void *addr);
+void _RaiseMaxFreeSegs(SceSysmemMemoryPartition *part, u32 size);
 
 void InitSmemCtlBlk(SceSysmemCtlBlk *ctlBlk);
 void updateSmemCtlBlk(SceSysmemMemoryPartition *part, SceSysmemCtlBlk *ctlBlk);
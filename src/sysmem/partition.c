@@ -1,8 +1,11 @@
 #include <sysmem_kdebug.h>
 #include <sysmem_kernel.h>
+#include <sysmem_sysclib.h>
 
 #include "intr.h"
 #include "memory.h"
+#include "reclaim.h"
+#include "trace.h"
 
 #include "partition.h"
 
@@ -143,6 +146,7 @@ void PartitionServiceInit(void)
 s32 sceKernelCreateMemoryPartition(const char *name, u32 attr, u32 addr, u32 size)
 {
     s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceSysmemUidCB *uid;
     s32 ret = sceKernelCreateUID(g_PartType, name, (pspGetK1() >> 31) & 0xFF, &uid);
     if (ret != 0) {
@@ -151,6 +155,7 @@ s32 sceKernelCreateMemoryPartition(const char *name, u32 attr, u32 addr, u32 siz
     }
     // 402C
     SceSysmemMemoryPartition *part = UID_CB_TO_DATA(uid, g_PartType, SceSysmemMemoryPartition);
+    part->watermark = 0;
     ret = _CreateMemoryPartition(part, attr, addr, size);
     if (ret != 0) {
         // 40E0
@@ -174,6 +179,8 @@ s32 sceKernelCreateMemoryPartition(const char *name, u32 attr, u32 addr, u32 siz
         ctlBlk->segCount = 1;
         ctlBlk->prev = NULL;
         part->ctlBlkCount = 1;
+        part->maxFreeSegs = part->size >> 8;
+        part->freeSegs = part->size >> 8;
         ctlBlk->freeSeg = 1;
         ctlBlk->usedSeg = 0;
         ctlBlk->next = NULL;
@@ -204,6 +211,7 @@ s32 sceKernelQueryMemoryPartitionInfo(s32 mpid, SceSysmemPartitionInfo *info)
 
 void PartitionInit(SceSysmemMemoryPartition *part)
 {
+    part->watermark = 0;
     if (part->size != 0) {
         SceSysmemCtlBlk *ctlBlk = part->firstCtlBlk;
         InitSmemCtlBlk(ctlBlk);
@@ -219,6 +227,8 @@ void PartitionInit(SceSysmemMemoryPartition *part)
         ctlBlk->segCount = 1;
         ctlBlk->prev = NULL;
         part->ctlBlkCount = 1;
+        part->maxFreeSegs = part->size >> 8;
+        part->freeSegs = part->size >> 8;
         ctlBlk->freeSeg = 1;
         ctlBlk->usedSeg = 0;
         ctlBlk->next = NULL;
@@ -366,7 +376,7 @@ s32 sceKernelFillFreeBlock(s32 mpid, u32 c)
         for (i = 0; i < curCtlBlk->segCount && curCtlBlk->segCount != curCtlBlk->usedSeg; i++) {
             if (curSeg->used == 0) {
                 // 4664
-                sceKernelFillBlock64((void*)part->addr + (curSeg->offset << 8), c, curSeg->size << 8);
+                sceKernelFillBlock((void*)part->addr + (curSeg->offset << 8), c, curSeg->size << 8);
             }
             // 4600
             curSeg = &curCtlBlk->segs[curSeg->next];
@@ -389,6 +399,8 @@ s32 partition_do_initialize(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc, in
     part->firstCtlBlk = NULL;
     part->next = NULL;
     part->addr = 0;
+    part->maxFreeSegs = 0;
+    part->freeSegs = 0;
     return uid->uid;
 }
 
@@ -410,6 +422,7 @@ s32 partition_do_delete(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc, int fu
     }
     // 476C
     cur->next = part->next;
+    ReclaimRemovePartition(part);
     _FreePartitionMemory(part->firstCtlBlk);
     sceKernelCallUIDObjCommonFunction(uid, uidWithFunc, funcId, ap);
     return uid->uid;
@@ -476,6 +489,8 @@ s32 _CreateMemoryPartition(SceSysmemMemoryPartition *part, u32 attr, u32 addr, u
     part->next = NULL;
     part->size = size;
     part->ctlBlkCount = 0;
+    part->maxFreeSegs = size >> 8;
+    part->freeSegs = size >> 8;
     if (size != 0) {
         SceSysmemMemoryPartition *prev = g_MemInfo.main;
         SceSysmemMemoryPartition *cur = prev->next;
@@ -527,6 +542,7 @@ SceUID sceKernelAllocPartitionMemory(s32 mpid, char *name, u32 type, u32 size, u
         return 0x800200E4;
     // 4B64
     s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceSysmemMemoryPartition *part = MpidToCB(mpid);
     if (part == NULL) {
         // 4CAC
@@ -546,9 +562,9 @@ SceUID sceKernelAllocPartitionMemory(s32 mpid, char *name, u32 type, u32 size, u
     SceSysmemMemoryBlock *memBlock = UID_CB_TO_DATA(uid, g_MemBlockType, SceSysmemMemoryBlock);
     void *outAddr;
     if (type == 2 && (addr & 0xFF) != 0) { // 4C70
-        outAddr = _allocSysMemory(part, type, ((addr + size + 0xFF) & 0xFFFFFF00) - (addr & 0xFFFFFF00), addr & 0xFFFFFF00, 0);
+        outAddr = ReclaimAllocSysMemory(part, type, ((addr + size + 0xFF) & 0xFFFFFF00) - (addr & 0xFFFFFF00), addr & 0xFFFFFF00);
     } else
-        outAddr = _allocSysMemory(part, type, size, addr, 0);
+        outAddr = ReclaimAllocSysMemory(part, type, size, addr);
     // 4BDC
     if (outAddr == NULL) {
         // 4C14
@@ -562,6 +578,10 @@ SceUID sceKernelAllocPartitionMemory(s32 mpid, char *name, u32 type, u32 size, u
     memBlock->size = (size + 0xFF) & 0xFFFFFF00;
     memBlock->part = part;
     memBlock->addr = outAddr;
+    memBlock->type = type;
+    memBlock->align = 0;
+    if (type == 3 || type == 4)
+        memBlock->align = addr;
     resumeIntr(oldIntr);
     return uid->uid;
 }
@@ -586,7 +606,11 @@ SceUID sceKernelAllocPartitionMemoryForUser(s32 mpid, char *name, u32 type, u32
         return 0x800200D3;
     }
     // 4D54
+    // the interrupts stay disabled so that the allocation is recorded with this caller
+    s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     ret = sceKernelAllocPartitionMemory(mpid, name, type, size, addr);
+    resumeIntr(oldIntr);
     pspSetK1(oldK1);
     return ret;
 }
@@ -22,6 +22,9 @@ typedef struct SceSysmemMemoryPartition {
     SceSysmemCtlBlk *firstCtlBlk; // 16
     SceSysmemCtlBlk *lastCtlBlk; // 20
     u32 ctlBlkCount; // 24
+    u32 maxFreeSegs; // 28 upper bound of the largest free segment size (in 256-byte units), so too big requests fail without a scan
+    u32 watermark; // 32 free size (in 256-byte units) below which the reclaim handlers are called, 0 if none
+    u32 freeSegs; // 36 total free size (in 256-byte units), updated by every allocation, free and resize
 } SceSysmemMemoryPartition;
 
 SceSysmemMemoryPartition *MpidToCB(int mpid);
@@ -53,7 +56,9 @@ typedef struct {
     void *addr;
     u32 size;
     SceSysmemMemoryPartition *part;
-} SceSysmemMemoryBlock; // size: 12; allocated space in partition
+    u32 type; /* allocation type, reused when sceKernelReallocPartitionMemory() has to move the block */
+    u32 align; /* alignment requested by types 3 and 4, 0 for the other types */
+} SceSysmemMemoryBlock; // size: 20; allocated space in partition
 
 extern SceSysmemUidCB *g_PartType;
 extern SceSysmemMemInfo g_MemInfo;
@@ -0,0 +1,136 @@
+#include <sysmem_kernel.h>
+
+#include "intr.h"
+#include "memory.h"
+#include "partition.h"
+
+#include "reclaim.h"
+
+/*
+ * Memory pressure handling: drivers with discardable caches register a handler which releases memory of a
+ * partition when asked to. When an allocation fails, the handlers of the partition are called from the cheapest
+ * to the most expensive, and the allocation is retried each time one of them released something. When a
+ * partition has a watermark, the handlers are also called after an allocation leaving less free memory.
+ */
+
+typedef struct {
+    SceSysmemReclaimHandler handler;
+    void *param;
+    SceSysmemMemoryPartition *part;
+    u32 cost;
+} SceSysmemReclaimEntry;
+
+/* Sorted by increasing cost */
+SceSysmemReclaimEntry g_ReclaimHandlers[SYSMEM_RECLAIM_MAX_HANDLERS];
+u32 g_ReclaimHandlerCount;
+/* Set while the handlers run, so the allocations they do can't call them again */
+s32 g_Reclaiming;
+
+u32 ReclaimRun(SceSysmemMemoryPartition *part, u32 size, u32 start);
+
+/*
+ * Call the handlers of a partition from the index 'start' until one of them releases memory. Returns the index
+ * following this handler, or 0 if none of them released anything.
+ */
+u32 ReclaimRun(SceSysmemMemoryPartition *part, u32 size, u32 start)
+{
+    u32 i;
+    if (g_Reclaiming)
+        return 0;
+    g_Reclaiming = 1;
+    for (i = start; i < g_ReclaimHandlerCount; i++) {
+        SceSysmemReclaimEntry *entry = &g_ReclaimHandlers[i];
+        if (entry->part == part && entry->handler(size, entry->param) != 0) {
+            g_Reclaiming = 0;
+            return i + 1;
+        }
+    }
+    g_Reclaiming = 0;
+    return 0;
+}
+
+void *ReclaimAllocSysMemory(SceSysmemMemoryPartition *part, int type, u32 size, u32 addr)
+{
+    void *ret = _allocSysMemory(part, type, size, addr, NULL);
+    u32 next = 0;
+    while (ret == NULL && (next = ReclaimRun(part, size, next)) != 0)
+        ret = _allocSysMemory(part, type, size, addr, NULL);
+    if (ret != NULL && part->watermark != 0 && !g_Reclaiming) {
+        if (part->freeSegs < part->watermark)
+            ReclaimRun(part, (part->watermark - part->freeSegs) << 8, 0);
+    }
+    return ret;
+}
+
+/* Drop the handlers of a partition which is being deleted, so they can't be called for a reused control block */
+void ReclaimRemovePartition(SceSysmemMemoryPartition *part)
+{
+    s32 oldIntr = suspendIntr();
+    u32 i, j = 0;
+    for (i = 0; i < g_ReclaimHandlerCount; i++) {
+        if (g_ReclaimHandlers[i].part != part)
+            g_ReclaimHandlers[j++] = g_ReclaimHandlers[i];
+    }
+    g_ReclaimHandlerCount = j;
+    resumeIntr(oldIntr);
+}
+
+s32 sceKernelRegisterReclaimHandler(s32 mpid, SceSysmemReclaimHandler handler, u32 cost, void *param)
+{
+    if (handler == NULL)
+        return 0x800200D2;
+    s32 oldIntr = suspendIntr();
+    SceSysmemMemoryPartition *part = MpidToCB(mpid);
+    if (part == NULL) {
+        resumeIntr(oldIntr);
+        return 0x800200D6;
+    }
+    if (g_ReclaimHandlerCount == SYSMEM_RECLAIM_MAX_HANDLERS) {
+        resumeIntr(oldIntr);
+        return 0x80020001;
+    }
+    // keep the handlers of the same cost in registration order
+    u32 i = g_ReclaimHandlerCount;
+    while (i > 0 && g_ReclaimHandlers[i - 1].cost > cost) {
+        g_ReclaimHandlers[i] = g_ReclaimHandlers[i - 1];
+        i--;
+    }
+    g_ReclaimHandlers[i].handler = handler;
+    g_ReclaimHandlers[i].param = param;
+    g_ReclaimHandlers[i].part = part;
+    g_ReclaimHandlers[i].cost = cost;
+    g_ReclaimHandlerCount++;
+    resumeIntr(oldIntr);
+    return 0;
+}
+
+s32 sceKernelUnregisterReclaimHandler(SceSysmemReclaimHandler handler, void *param)
+{
+    s32 oldIntr = suspendIntr();
+    u32 i;
+    for (i = 0; i < g_ReclaimHandlerCount; i++) {
+        if (g_ReclaimHandlers[i].handler == handler && g_ReclaimHandlers[i].param == param) {
+            g_ReclaimHandlerCount--;
+            for (; i < g_ReclaimHandlerCount; i++)
+                g_ReclaimHandlers[i] = g_ReclaimHandlers[i + 1];
+            resumeIntr(oldIntr);
+            return 0;
+        }
+    }
+    resumeIntr(oldIntr);
+    return 0x80020001;
+}
+
+s32 sceKernelSetPartitionWatermark(s32 mpid, u32 size)
+{
+    s32 oldIntr = suspendIntr();
+    SceSysmemMemoryPartition *part = MpidToCB(mpid);
+    if (part == NULL) {
+        resumeIntr(oldIntr);
+        return 0x800200D6;
+    }
+    part->watermark = (size + 0xFF) >> 8;
+    resumeIntr(oldIntr);
+    return 0;
+}
+
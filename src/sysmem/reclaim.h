@@ -0,0 +1,13 @@
+#ifndef RECLAIM_H
+#define RECLAIM_H
+
+#include "partition.h"
+
+/* Maximum number of registered reclaim handlers */
+#define SYSMEM_RECLAIM_MAX_HANDLERS 16
+
+void *ReclaimAllocSysMemory(SceSysmemMemoryPartition *part, int type, u32 size, u32 addr);
+void ReclaimRemovePartition(SceSysmemMemoryPartition *part);
+
+#endif
+
@@ -1,8 +1,11 @@
 #include <stdarg.h>
 
 #include <common_imp.h>
+#include <sysmem_kernel.h>
 #include <sysmem_sysclib.h>
 
+#include "memory.h"
+
 #define CTYPE_DOWNCASE_LETTER 0x01
 #define CTYPE_UPCASE_LETTER   0x02
 #define CTYPE_CIPHER          0x04
@@ -13,6 +16,19 @@
 
 #define CTYPE_LETTER (CTYPE_DOWNCASE_LETTER | CTYPE_UPCASE_LETTER)
 
+/*
+ * Unless sysmem is built with SYSCLIB_BYTEWISE_STRING ("make BYTEWISE_STRING=1"), the string and memory
+ * scanning functions process a word at a time once their pointers are aligned. Only aligned words are
+ * read, so a string is never read past the word holding its terminator, which cannot cross a page.
+ */
+#ifndef SYSCLIB_BYTEWISE_STRING
+#define WORD_ALIGNED(ptr) (((u32)(ptr) & 3) == 0)
+/* Non-zero if one of the bytes of the word is zero */
+#define WORD_HAS_ZERO(w) (((w) - 0x01010101) & ~(w) & 0x80808080)
+/* The byte 'c' copied in each byte of a word */
+#define WORD_REPEAT(c) (((c) & 0xFF) * 0x01010101)
+#endif
+
 // 135F0
 u8 _ctype_[] =
 {
@@ -197,141 +213,196 @@ char *index(char *s, int c)
     return NULL;
 }
 
-u64 __udivmoddi4(u64 arg01, u64 arg23, u64 *v)
+/*
+ * 64-bit division without the bit by bit shift-subtract loop: 32-bit divisors are handled with at most two
+ * hardware divisions of a 64-bit value by 32 bits, themselves done with 32-bit divisions on normalized 16-bit
+ * digits; 64-bit divisors estimate the quotient from their normalized high word and correct it by one.
+ * Dividing by zero returns 0 and leaves the remainder untouched.
+ */
+
+u32 DivU64ByU32(u32 hi, u32 lo, u32 div, u32 *mod);
+u64 DivModU64(u64 num, u64 div, u64 *mod);
+
+/* Divide hi:lo by div, where hi < div so the quotient fits in 32 bits */
+u32 DivU64ByU32(u32 hi, u32 lo, u32 div, u32 *mod)
 {
-    u64 or = arg01 | arg23;
-    if (arg23 == 0)
-        return 0;
-    int shift = 0;
-    // D288
-    while ((or & 1) == 0) {
-        or >>= 1;
-        shift++;
+    u32 shift = __builtin_clz(div);
+    div <<= shift;
+    if (shift != 0)
+    {
+        hi = (hi << shift) | (lo >> (32 - shift));
+        lo <<= shift;
+    }
+    u32 div1 = div >> 16;
+    u32 div0 = div & 0xFFFF;
+    u32 lo1 = lo >> 16;
+    u32 lo0 = lo & 0xFFFF;
+
+    // estimate the high 16 bits of the quotient, which is at most 2 too large
+    u32 q1 = hi / div1;
+    u32 rem = hi - q1 * div1;
+    while (q1 >= 0x10000 || q1 * div0 > ((rem << 16) | lo1))
+    {
+        q1--;
+        rem += div1;
+        if (rem >= 0x10000)
+            break;
     }
-    // D2A4
-    int shift2 = 0;
-    if ((or & 0xFFFFFFFF00000000) != 0)
+    u32 mid = (hi << 16) + lo1 - q1 * div;
+
+    // same for the low 16 bits
+    u32 q0 = mid / div1;
+    rem = mid - q0 * div1;
+    while (q0 >= 0x10000 || q0 * div0 > ((rem << 16) | lo0))
     {
-        // D380
-        for (;;)
+        q0--;
+        rem += div1;
+        if (rem >= 0x10000)
+            break;
+    }
+    if (mod != NULL)
+        *mod = ((mid << 16) + lo0 - q0 * div) >> shift;
+    return (q1 << 16) | q0;
+}
+
+u64 DivModU64(u64 num, u64 div, u64 *mod)
+{
+    u32 numHi = num >> 32;
+    u32 divHi = div >> 32;
+    u32 divLo = (u32)div;
+    if (divHi == 0)
+    {
+        u32 r;
+        if ((divLo & (divLo - 1)) == 0)
         {
-            // D3A8
-            if (arg23 >= arg01 || (s64)arg23 < 0)
-                break;
-            arg23 <<= 1;
-            shift2++;
+            // power of 2
+            if (mod != NULL)
+                *mod = num & (divLo - 1);
+            return num >> __builtin_ctz(divLo);
         }
-        // D3C4
-        u64 t01 = (u64)1 << shift2;
-        // D3FC
-        u64 b12 = 0;
-        // D414
-        while (t01 != 0)
+        if (numHi == 0)
         {
-            if (arg01 >= arg23)
-            {
-                // D42C
-                arg01 -= arg23;
-                b12 |= t01;
-            }
-            // D444
-            t01 >>= 1;
-            arg23 >>= 1;
+            if (mod != NULL)
+                *mod = (u32)num % divLo;
+            return (u32)num / divLo;
+        }
+        u32 qHi = 0;
+        if (numHi >= divLo)
+        {
+            qHi = numHi / divLo;
+            numHi -= qHi * divLo;
         }
-        // D468
-        *v = arg01;
-        return b12;
+        u32 qLo = DivU64ByU32(numHi, (u32)num, divLo, &r);
+        if (mod != NULL)
+            *mod = r;
+        return ((u64)qHi << 32) | qLo;
     }
-    int div1, div2;
-    div2 = arg23 >> shift;
-    div1 = arg01 >> shift;
-    // D318
-    // D330
-    u64 shifted = div1 % div2;
-    // D368
-    *v = shifted << shift;
-    return div1 / div2;
+    if (num < div)
+    {
+        if (mod != NULL)
+            *mod = num;
+        return 0;
+    }
+    // the quotient is below 2^32: divide num / 2 by the top 32 bits of the normalized divisor
+    u32 shift = __builtin_clz(divHi);
+    u32 top = (u32)((div << shift) >> 32);
+    u64 half = num >> 1;
+    u32 q = DivU64ByU32((u32)(half >> 32), (u32)half, top, NULL);
+    q = (u32)(((u64)q << shift) >> 31);
+    if (q != 0)
+        q--;
+    u64 rem = num - (u64)q * div;
+    if (rem >= div)
+    {
+        q++;
+        rem -= div;
+    }
+    if (mod != NULL)
+        *mod = rem;
+    return q;
+}
+
+u64 __udivmoddi4(u64 arg01, u64 arg23, u64 *v)
+{
+    if (arg23 == 0)
+        return 0;
+    return DivModU64(arg01, arg23, v);
 }
 
 u64 __udivdi3(u64 arg01, u64 arg23)
 {
-    int shift;
-    u64 num, result;
     if (arg23 == 0)
         return 0;
-    shift = 0;
-    // D4B0
-    for (shift = 0; (arg23 & 1) == 0; shift++)
-        arg23 >>= 1;
-    // D4CC
-    num = arg01 >> shift;
-    // D4FC
-    arg01 = num;
-    if (((num | arg23) >> 32) == 0) {
-        // D524
-        return (u32)arg01 / (u32)arg23;
-    }
-    // D53C
-    num = arg01;
-    if ((s64)arg01 < 0) {
-        // D660
-        num = -1;
-    }
-    // D554
-    // (D55C)
-    // D560
-    for (shift = 0; arg23 < num; shift++)
-        arg23 <<= 1;
-    // D58C
-    num = (u64)1 << shift;
-    // D5C4
-    result = 0;
-    // D5D8
-    while (num != 0)
-    {
-        if (arg01 >= arg23)
-        {
-            // D5F0
-            arg01 -= arg23;
-            result |= num;
-        }
-        // D608
-        num >>= 1;
-        arg23 >>= 1;
-    }
-    // D630
-    return result;
+    return DivModU64(arg01, arg23, NULL);
 }
 
 u64 __umoddi3(u64 arg01, u64 arg23)
 {
-    u64 mod;
-    __udivmoddi4(arg01, arg23, &mod);
+    u64 mod = 0;
+    if (arg23 != 0)
+        DivModU64(arg01, arg23, &mod);
     return mod;
 }
 
 void *memchr(const void *s, int c, int n)
 {
-    if (s != NULL)
+    const u8 *curS = s;
+    if (s == NULL)
+        return NULL;
+#ifndef SYSCLIB_BYTEWISE_STRING
+    while (n > 0 && !WORD_ALIGNED(curS))
     {
-        // D6A8
-        while ((n--) > 0)
-        {
-            if (*(char*)s == (c & 0xFF))
-                return (void *)s;
-            s++;
-        }
+        if (*curS == (c & 0xFF))
+            return (void *)curS;
+        curS++;
+        n--;
+    }
+    u32 pattern = WORD_REPEAT(c);
+    while (n >= 4 && !WORD_HAS_ZERO(*(const u32*)curS ^ pattern))
+    {
+        curS += 4;
+        n -= 4;
+    }
+#endif
+    // D6A8
+    while ((n--) > 0)
+    {
+        if (*curS == (c & 0xFF))
+            return (void *)curS;
+        curS++;
     }
     return NULL;
 }
 
 int memcmp(const void *s1, const void *s2, int n)
 {
+    const u8 *curS1 = s1;
+    const u8 *curS2 = s2;
+#ifndef SYSCLIB_BYTEWISE_STRING
+    if (n >= 8 && ((u32)curS1 & 3) == ((u32)curS2 & 3))
+    {
+        while (!WORD_ALIGNED(curS1) && *curS1 == *curS2)
+        {
+            curS1++;
+            curS2++;
+            n--;
+        }
+        if (WORD_ALIGNED(curS1))
+        {
+            while (n >= 4 && *(const u32*)curS1 == *(const u32*)curS2)
+            {
+                curS1 += 4;
+                curS2 += 4;
+                n -= 4;
+            }
+        }
+    }
+#endif
     // D6D8
     while ((n--) > 0)
     {
-        u8 a = *((u8*)s1++);
-        u8 b = *((u8*)s2++);
+        u8 a = *(curS1++);
+        u8 b = *(curS2++);
         if (a != b)
         {
             // D700
@@ -343,121 +414,201 @@ int memcmp(const void *s1, const void *s2, int n)
     return 0;
 }
 
-void *sceKernelMemcpy(void *dst, const void *src, u32 n)
-{
-    const char *curSrc = (const char*)src;
-    char *curDst = (char*)dst;
-    char *end = (char*)dst + n;
+/*
+ * Copies of at least COPY_LINES_SIZE bytes to a cached segment create the cache lines of the
+ * destination dirty instead of loading them from the memory, when these lines cannot hold source bytes
+ * not copied yet. A source with another alignment than the destination is read by aligned words which
+ * are shifted and merged, so no byte is read outside of the words holding the source.
+ */
+#define COPY_SMALL_SIZE 8
+#define COPY_LINES_SIZE 128
 
-    asm(".set noat");
+#define CREATE_DIRTY_LINE(ptr) pspCache(0x18, ptr)
 
-    if (dst == src)
-        return dst;
-    if (n >= 8)
+/* Builds the destination word from two consecutive aligned source words (little endian) */
+#define MERGE_WORDS(lo, hi, shift) (((lo) >> (shift)) | ((hi) << (32 - (shift))))
+
+void CopyForward(u8 *dst, const u8 *src, u32 n, s32 createLines);
+void CopyBackward(u8 *dst, const u8 *src, u32 n, s32 createLines);
+
+void CopyForward(u8 *dst, const u8 *src, u32 n, s32 createLines)
+{
+    u8 *end = dst + n;
+    if (n >= COPY_SMALL_SIZE)
     {
-        // D754
-        if (((int)dst & 3) != 0)
+        while (((u32)dst & 3) != 0)
+            *(dst++) = *(src++);
+        u32 *curDst = (u32*)dst;
+        u32 *wordEnd = (u32*)((u32)end & 0xFFFFFFFC);
+        u32 *lineEnd = curDst;
+        if (createLines && (((u32)dst >> 29) & 3) == 0 && n >= COPY_LINES_SIZE)
+            lineEnd = (u32*)((u32)end & 0xFFFFFFC0);
+        u32 i;
+        if (((u32)src & 3) == 0)
         {
-            // D96C
-            int align = 4 - ((int)dst & 3);
-            asm("lwl $at, 3(%0)\n \
-                 lwr $at, 0(%0)\n \
-                 swr $at, 0(%1)" : : "r" (src), "r" (dst) : "at");
-            curSrc = src + align;
-            curDst = dst + align;
+            const u32 *curSrc = (const u32*)src;
+            if (curDst != lineEnd)
+            {
+                while ((u32)curDst != UPALIGN64((u32)curDst))
+                    *(curDst++) = *(curSrc++);
+                while (curDst != lineEnd)
+                {
+                    CREATE_DIRTY_LINE(curDst);
+                    for (i = 0; i < 16; i++)
+                        curDst[i] = curSrc[i];
+                    curDst += 16;
+                    curSrc += 16;
+                }
+            }
+            while (curDst != wordEnd)
+                *(curDst++) = *(curSrc++);
+            src = (const u8*)curSrc;
         }
-        // D75C
-        if ((((int)curDst >> 29) & 3) == 0 && n >= 128)
+        else
         {
-            if (((int)curSrc & 3) != 0)
+            u32 offset = (u32)src & 3;
+            u32 shift = offset * 8;
+            const u32 *curSrc = (const u32*)((u32)src - offset);
+            u32 lo = *(curSrc++);
+            if (curDst != lineEnd)
             {
-                // D86C
-                // D874
-                while ((u32)curDst != UPALIGN64((int)curDst))
+                while ((u32)curDst != UPALIGN64((u32)curDst))
                 {
-                    asm("lwl $at, 3(%0)\n \
-                         lwr $at, 0(%0)\n \
-                         addiu %0, %0, 4\n \
-                         addiu %1, %1, 4\n \
-                         sw $at, -4(%1)" : : "r" (curSrc), "r" (curDst) : "at");
+                    u32 hi = *(curSrc++);
+                    *(curDst++) = MERGE_WORDS(lo, hi, shift);
+                    lo = hi;
                 }
-                // D890
-                // D894
-                do
+                while (curDst != lineEnd)
                 {
-                    pspCache(0x18, curDst);
-                    int i;
-                    for (i = 0; i < 4; i++)
+                    CREATE_DIRTY_LINE(curDst);
+                    for (i = 0; i < 16; i++)
                     {
-                        asm("lwl $at, 3(%0)\n \
-                             lwr $at, 0(%0)\n \
-                             lwr $a3, 7(%0)\n \
-                             lwr $a3, 4(%0)\n \
-                             lwr $t0, 11(%0)\n \
-                             lwr $t0, 8(%0)\n \
-                             lwr $t1, 15(%0)\n \
-                             lwr $t1, 12(%0)\n \
-                             sw  $at, 0(%1)\n \
-                             sw  $a3, 4(%1)\n \
-                             sw  $t0, 8(%1)\n \
-                             sw  $t1, 12(%1)" : : "r" (curSrc + i * 16), "r" (curDst + i * 16) : "at", "a3", "t0", "t1");
-                        curSrc += 64;
-                        curDst += 64;
+                        u32 hi = curSrc[i];
+                        curDst[i] = MERGE_WORDS(lo, hi, shift);
+                        lo = hi;
                     }
-                } while (curDst != (void*)((int)end & 0xFFFFFFC0));
+                    curDst += 16;
+                    curSrc += 16;
+                }
             }
-            else
+            while (curDst != wordEnd)
             {
-                // D784
-                while ((u32)curDst != UPALIGN64((int)curDst))
+                u32 hi = *(curSrc++);
+                *(curDst++) = MERGE_WORDS(lo, hi, shift);
+                lo = hi;
+            }
+            src = (const u8*)curSrc - 4 + offset;
+        }
+        dst = (u8*)curDst;
+    }
+    while (dst != end)
+        *(dst++) = *(src++);
+}
+
+void CopyBackward(u8 *dst, const u8 *src, u32 n, s32 createLines)
+{
+    u8 *curDst = dst + n;
+    const u8 *curSrc = src + n;
+    if (n >= COPY_SMALL_SIZE)
+    {
+        while (((u32)curDst & 3) != 0)
+            *(--curDst) = *(--curSrc);
+        u32 *curWord = (u32*)curDst;
+        u32 *wordStart = (u32*)UPALIGN4((u32)dst);
+        u32 *lineStart = curWord;
+        if (createLines && (((u32)dst >> 29) & 3) == 0 && n >= COPY_LINES_SIZE)
+            lineStart = (u32*)UPALIGN64((u32)dst);
+        u32 i;
+        if (((u32)curSrc & 3) == 0)
+        {
+            const u32 *srcWord = (const u32*)curSrc;
+            if (curWord != lineStart)
+            {
+                while (((u32)curWord & 63) != 0)
+                    *(--curWord) = *(--srcWord);
+                while (curWord != lineStart)
+                {
+                    curWord -= 16;
+                    srcWord -= 16;
+                    CREATE_DIRTY_LINE(curWord);
+                    for (i = 0; i < 16; i++)
+                        curWord[i] = srcWord[i];
+                }
+            }
+            while (curWord != wordStart)
+                *(--curWord) = *(--srcWord);
+            curSrc = (const u8*)srcWord;
+        }
+        else
+        {
+            u32 offset = (u32)curSrc & 3;
+            u32 shift = offset * 8;
+            const u32 *srcWord = (const u32*)((u32)curSrc - offset);
+            u32 hi = *srcWord;
+            if (curWord != lineStart)
+            {
+                while (((u32)curWord & 63) != 0)
                 {
-                    asm("lw $at, 0(%0)\n \
-                         addiu %0, %0, 4\n \
-                         sw $at, 0(%1)\n \
-                         addiu %1, %1, 4" : : "r" (curSrc), "r" (curDst) : "at");
+                    u32 lo = *(--srcWord);
+                    *(--curWord) = MERGE_WORDS(lo, hi, shift);
+                    hi = lo;
                 }
-                // D79C
-                // D7A0
-                do
+                while (curWord != lineStart)
                 {
-                    pspCache(0x18, curDst);
-                    int i;
-                    for (i = 0; i < 4; i++)
+                    curWord -= 16;
+                    srcWord -= 16;
+                    CREATE_DIRTY_LINE(curWord);
+                    for (i = 16; i-- > 0;)
                     {
-                        asm("lw $at, 0(%0)\n \
-                             lw $a3, 4(%0)\n \
-                             lw $t0, 8(%0)\n \
-                             lw $t1, 12(%0)\n \
-                             sw $at, 0(%1)\n \
-                             sw $a3, 4(%1)\n \
-                             sw $t0, 8(%1)\n \
-                             sw $t1, 12(%1)" : : "r" (curSrc + i * 16), "r" (curDst + i * 16) : "at", "a3", "t0", "t1");
-                        curSrc += 64;
-                        curDst += 64;
+                        u32 lo = srcWord[i];
+                        curWord[i] = MERGE_WORDS(lo, hi, shift);
+                        hi = lo;
                     }
-                } while (curDst != (void*)((int)end & 0xFFFFFFC0));
+                }
             }
-            // D830
-            if ((void*)((int)end & 0xFFFFFFC0) == end)
-                return dst;
-            curDst = (void*)((int)end & 0xFFFFFFC0);
-        }
-        // D83C
-        // D84C
-        while (curDst != (void*)((int)end & 0xFFFFFFFC))
-        {
-            asm("lwl %0, 3(%1)\n \
-                 lwr %0, 0(%1)" : "=r" (curDst) : "r" (curSrc));
-            curDst += 4;
-            curSrc += 4;
+            while (curWord != wordStart)
+            {
+                u32 lo = *(--srcWord);
+                *(--curWord) = MERGE_WORDS(lo, hi, shift);
+                hi = lo;
+            }
+            curSrc = (const u8*)srcWord + offset;
         }
-        // D864
+        curDst = (u8*)curWord;
+    }
+    while (curDst != dst)
+        *(--curDst) = *(--curSrc);
+}
+
+void *sceKernelMemcpy(void *dst, const void *src, u32 n)
+{
+    u8 *curDst = dst;
+    const u8 *curSrc = src;
+    if (dst == src)
+        return dst;
+    // Short copies are unrolled, in the decreasing address order
+    switch (n)
+    {
+    case 7:
+        curDst[6] = curSrc[6];
+    case 6:
+        curDst[5] = curSrc[5];
+    case 5:
+        curDst[4] = curSrc[4];
+    case 4:
+        curDst[3] = curSrc[3];
+    case 3:
+        curDst[2] = curSrc[2];
+    case 2:
+        curDst[1] = curSrc[1];
+    case 1:
+        curDst[0] = curSrc[0];
+    case 0:
+        return dst;
+    default:
+        CopyForward(curDst, curSrc, n, 1);
+        return dst;
     }
-    // D730
-    // D738
-    while (curDst != end)
-        *(curDst++) = *(curSrc++);
-    return dst;
 }
 
 void *memcpy(void *dst, const void *src, u32 n)
@@ -467,24 +618,60 @@ void *memcpy(void *dst, const void *src, u32 n)
     return sceKernelMemcpy(dst, src, n);
 }
 
+/*
+ * Fills 'size' bytes at 'dst' with the word 'c', as if the whole area had been written with 32-bit stores
+ * (so the bytes of 'c' repeat with the alignment of the address, not of 'dst').
+ * The whole cache lines of a cached area are filled by sceKernelFillBlock64(), which creates them dirty in the
+ * data cache instead of reading them from the memory before they are overwritten.
+ */
+void *sceKernelFillBlock(void *dst, u32 c, u32 size)
+{
+    u8 *curDst = (u8*)dst;
+    u8 *end = (u8*)dst + size;
+    u32 *curWord;
+    u32 *endWord = (u32*)((u32)end & 0xFFFFFFFC);
+
+    while (((u32)curDst & 3) != 0 && curDst != end) {
+        *curDst = c >> (((u32)curDst & 3) * 8);
+        curDst++;
+    }
+    curWord = (u32*)curDst;
+#ifdef __mips__
+    // Only the cached segments (kuseg, kseg0) can have their lines created dirty
+    if (((0x2C >> (((u32)dst >> 29) & 7)) & 1) == 0 && size >= 128) {
+        u32 *lineEnd = (u32*)((u32)end & 0xFFFFFFC0);
+        while ((u32)curWord != UPALIGN64((u32)curWord))
+            *(curWord++) = c;
+        sceKernelFillBlock64(curWord, c, (u32)lineEnd - (u32)curWord);
+        curWord = lineEnd;
+    }
+#endif
+    while (curWord < endWord)
+        *(curWord++) = c;
+    curDst = (u8*)curWord;
+    while (curDst < end) {
+        *curDst = c >> (((u32)curDst & 3) * 8);
+        curDst++;
+    }
+    return dst;
+}
+
 void *memmove(void *dst, const void *src, int n)
 {
-    char *dst2 = dst;
-    const char *src2 = src;
     if (dst == NULL)
         return NULL;
+    if (n <= 0 || dst == src)
+        return dst;
+    // The cache lines can only be created when they cannot hold source bytes which were not copied yet
     if (dst < src)
     {
         // D9E4
-        // D9EC
-        while ((n--) > 0)
-            *(dst2++) = *(src2++);
+        CopyForward(dst, src, n, (u32)src - (u32)dst >= 64);
     }
     else
     {
         // D9C0
-        while ((--n) >= 0)
-            dst2[n] = src2[n];
+        CopyBackward(dst, src, n, (u32)dst - (u32)src >= 64);
     }
     return dst;
 }
@@ -516,12 +703,12 @@ int prnt(prnt_callback cb, void *ctx, const char *fmt, va_list args)
             int numAlign = 0; // with %* or %0123456789
             int sign = '\0';
             int base;
-            int number;
+            u32 number = 0;
             int stringLen;
             char *s;
             int len;
             // DABC
-            do
+            for (;;)
             {
                 fmt++;
                 // DAC0
@@ -620,7 +807,7 @@ int prnt(prnt_callback cb, void *ctx, const char *fmt, va_list args)
                     {
                         // DF00
                         number = va_arg(args, int);
-                        if (number < 0)
+                        if ((s32)number < 0)
                         {
                             // DFBC
                             number = -number;
@@ -796,7 +983,7 @@ int prnt(prnt_callback cb, void *ctx, const char *fmt, va_list args)
                 // DF18
                 usedPrecision = precision;
                 s = &string[21];
-                if (flag >= 0)
+                if (precision >= 0)
                     flag &= 0xFFFFFFDF;
                 if (number != 0 || precision != 0)
                 {
@@ -870,7 +1057,8 @@ int prnt(prnt_callback cb, void *ctx, const char *fmt, va_list args)
                 // DE68
                 // DE6C
                 count += pspMax(maxSize, numAlign);
-            } while (0);
+                break;
+            }
         }
         else
         {
@@ -898,13 +1086,209 @@ char *rindex(const char *s, char c)
     return 0;
 }
 
+/*
+ * Fast path of sprintf() and snprintf(), used when the format only has %%, %c, %d, %i, %p, %s, %u, %x and %X
+ * conversions with optional '-' and '0' flags, width and 'l' modifier. The literal runs and converted fields
+ * are written directly to the buffer instead of one character at a time through a prnt() callback.
+ */
+
+#define PRNT_MIN(a, b) (((a) < (b)) ? (a) : (b))
+/* Store the character 'c' at 'pos' in the buffer 'str' of 'size' characters if it fits, and advance 'pos' */
+#define PRNT_PUT(str, size, pos, c) do { \
+    if ((pos) < (size)) \
+        (str)[pos] = (c); \
+    (pos)++; \
+} while (0)
+
+/* Two decimal digits for every number below 100 */
+const char g_PrntDigitPairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+s32 PrntFastSupported(const char *fmt);
+u32 PrntDecimal(char *end, u32 n);
+s32 PrntFast(char *str, u32 size, const char *fmt, va_list args);
+
+/* Check the whole format before the fast path consumes any argument, so prnt() can still be used */
+s32 PrntFastSupported(const char *fmt)
+{
+    for (;;)
+    {
+        char c = *(fmt++);
+        if (c == '\0')
+            return 1;
+        if (c != '%')
+            continue;
+        while (*fmt == '-' || *fmt == '0')
+            fmt++;
+        while (*fmt >= '0' && *fmt <= '9')
+            fmt++;
+        if (*fmt == 'l')
+            fmt++;
+        switch (*(fmt++))
+        {
+        case '%': case 'c': case 'd': case 'i': case 'p': case 's': case 'u': case 'x': case 'X':
+            break;
+        default:
+            return 0;
+        }
+    }
+}
+
+/* Write the decimal digits of n backwards from end, returning their count */
+u32 PrntDecimal(char *end, u32 n)
+{
+    char *cur = end;
+    while (n >= 100)
+    {
+        u32 pair = (n % 100) * 2;
+        n /= 100;
+        cur -= 2;
+        cur[0] = g_PrntDigitPairs[pair];
+        cur[1] = g_PrntDigitPairs[pair + 1];
+    }
+    if (n >= 10)
+    {
+        cur -= 2;
+        cur[0] = g_PrntDigitPairs[n * 2];
+        cur[1] = g_PrntDigitPairs[n * 2 + 1];
+    }
+    else
+        *(--cur) = '0' + n;
+    return end - cur;
+}
+
+/*
+ * Format at most 'size' characters followed by a terminator to str, returning the length of the whole formatted
+ * string, or -1 without consuming any argument if the format isn't handled.
+ */
+s32 PrntFast(char *str, u32 size, const char *fmt, va_list args)
+{
+    char number[12];
+    u32 pos = 0;
+    if (!PrntFastSupported(fmt))
+        return -1;
+    for (;;)
+    {
+        // literal run
+        const char *run = fmt;
+        while (*fmt != '\0' && *fmt != '%')
+            fmt++;
+        u32 len = fmt - run;
+        if (len != 0)
+        {
+            if (pos < size)
+                memcpy(str + pos, run, PRNT_MIN(len, size - pos));
+            pos += len;
+        }
+        if (*fmt == '\0')
+            break;
+
+        // conversion
+        s32 left = 0;
+        char pad = ' ';
+        u32 width = 0;
+        char sign = '\0';
+        const char *field = number;
+        fmt++;
+        for (;; fmt++)
+        {
+            if (*fmt == '-')
+                left = 1;
+            else if (*fmt == '0')
+                pad = '0';
+            else
+                break;
+        }
+        while (*fmt >= '0' && *fmt <= '9')
+            width = width * 10 + *(fmt++) - '0';
+        if (*fmt == 'l')
+            fmt++;
+        switch (*(fmt++))
+        {
+        case '%':
+            number[0] = '%';
+            len = 1;
+            width = 0;
+            break;
+        case 'c':
+            number[0] = (char)va_arg(args, int);
+            len = 1;
+            break;
+        case 'd':
+        case 'i': {
+            s32 n = va_arg(args, s32);
+            u32 abs = n;
+            if (n < 0)
+            {
+                sign = '-';
+                abs = -abs;
+            }
+            len = PrntDecimal(number + sizeof(number), abs);
+            field = number + sizeof(number) - len;
+            break;
+        }
+        case 'u':
+            len = PrntDecimal(number + sizeof(number), va_arg(args, u32));
+            field = number + sizeof(number) - len;
+            break;
+        case 'p':
+        case 'x':
+        case 'X': {
+            const char *digits = (fmt[-1] == 'X') ? "0123456789ABCDEF" : "0123456789abcdef";
+            u32 n = va_arg(args, u32);
+            char *cur = number + sizeof(number);
+            do
+            {
+                *(--cur) = digits[n & 0xF];
+                n >>= 4;
+            } while (n != 0);
+            field = cur;
+            len = number + sizeof(number) - cur;
+            break;
+        }
+        default: // 's'
+            field = va_arg(args, char*);
+            if (field == NULL)
+                field = "(null)";
+            len = strlen(field);
+            break;
+        }
+
+        // padding, sign and field
+        u32 fill = 0;
+        if (width > len + (sign != '\0'))
+            fill = width - len - (sign != '\0');
+        if (!left && pad == ' ')
+            for (; fill != 0; fill--)
+                PRNT_PUT(str, size, pos, ' ');
+        if (sign != '\0')
+            PRNT_PUT(str, size, pos, sign);
+        if (!left)
+            for (; fill != 0; fill--)
+                PRNT_PUT(str, size, pos, '0');
+        if (pos < size)
+            memcpy(str + pos, field, PRNT_MIN(len, size - pos));
+        pos += len;
+        for (; fill != 0; fill--)
+            PRNT_PUT(str, size, pos, ' ');
+    }
+    str[PRNT_MIN(pos, size)] = '\0';
+    return pos;
+}
+
 int sprintf(char *str, const char *format, ...)
 {
     va_list ap;
     char *ctx[1];
     va_start(ap, format);
     ctx[0] = str;
-    int ret = prnt((prnt_callback)sprintf_char, (void*)ctx, format, ap);
+    int ret = PrntFast(str, 0xFFFFFFFF, format, ap);
+    if (ret < 0)
+        ret = prnt((prnt_callback)sprintf_char, (void*)ctx, format, ap);
     va_end(ap);
     return ret;
 }
@@ -917,7 +1301,11 @@ int snprintf(char *str, u32 size, const char *format, ...)
     ctx[0] = size - 1;
     ctx[1] = 0;
     ctx[2] = (int)str;
-    int ret = prnt((prnt_callback)snprintf_char, ctx, format, ap);
+    int ret = -1;
+    if (size != 0)
+        ret = PrntFast(str, size - 1, format, ap);
+    if (ret < 0)
+        ret = prnt((prnt_callback)snprintf_char, ctx, format, ap);
     va_end(ap);
     return ret;
 }
@@ -961,12 +1349,28 @@ char *strchr(const char *s, char c)
     if (s == NULL)
         return NULL;
     // E3F4
-    do
+    if (*s == c)
+        return (char *)s;
+    s++;
+#ifndef SYSCLIB_BYTEWISE_STRING
+    while (!WORD_ALIGNED(s))
     {
+        if (*s == '\0')
+            return NULL;
         if (*s == c)
             return (char *)s;
         s++;
-    } while (*s != '\0');
+    }
+    u32 pattern = WORD_REPEAT(c);
+    while (!WORD_HAS_ZERO(*(const u32*)s) && !WORD_HAS_ZERO(*(const u32*)s ^ pattern))
+        s += 4;
+#endif
+    while (*s != '\0')
+    {
+        if (*s == c)
+            return (char *)s;
+        s++;
+    }
     return NULL;
 }
 
@@ -974,6 +1378,24 @@ int strcmp(const char *s1, const char *s2)
 {
     if (s1 != NULL && s2 != NULL)
     {
+#ifndef SYSCLIB_BYTEWISE_STRING
+        if (((u32)s1 & 3) == ((u32)s2 & 3))
+        {
+            while (!WORD_ALIGNED(s1) && *s1 == *s2 && *s1 != '\0')
+            {
+                s1++;
+                s2++;
+            }
+            if (WORD_ALIGNED(s1))
+            {
+                while (*(const u32*)s1 == *(const u32*)s2 && !WORD_HAS_ZERO(*(const u32*)s1))
+                {
+                    s1 += 4;
+                    s2 += 4;
+                }
+            }
+        }
+#endif
         // E444, E464, E468
         while (*(s1++) == *(s2++))
             if (*(s1 - 1) == '\0')
@@ -1151,6 +1573,34 @@ int strncmp(const char *s1, const char *s2, int n)
         // E89C
         if ((--n) < 0)
             return 0;
+#ifndef SYSCLIB_BYTEWISE_STRING
+        if (n >= 8 && ((u32)s1 & 3) == ((u32)s2 & 3))
+        {
+            const char *start = s1;
+            while (!WORD_ALIGNED(s1) && *s1 == *s2 && *s1 != '\0')
+            {
+                s1++;
+                s2++;
+                n--;
+            }
+            if (WORD_ALIGNED(s1))
+            {
+                while (n >= 4 && *(const u32*)s1 == *(const u32*)s2 && !WORD_HAS_ZERO(*(const u32*)s1))
+                {
+                    s1 += 4;
+                    s2 += 4;
+                    n -= 4;
+                }
+            }
+            // Resume on the last matching character so the loop below checks the next one for a terminator
+            if (s1 != start)
+            {
+                s1--;
+                s2--;
+                n++;
+            }
+        }
+#endif
         // E8D0, E8D4
         while (*(s1++) == *(s2++))
             if (*s1 == '\0' || (--n) < 0)
@@ -1208,13 +1658,23 @@ u32 strnlen(const char *s, int maxlen)
 
 u32 strlen(const char *s)
 {
-    int len = 0;
+    const char *curS = s;
     if (s == NULL)
         return 0;
+#ifndef SYSCLIB_BYTEWISE_STRING
+    while (!WORD_ALIGNED(curS))
+    {
+        if (*curS == '\0')
+            return curS - s;
+        curS++;
+    }
+    while (!WORD_HAS_ZERO(*(const u32*)curS))
+        curS += 4;
+#endif
     // E9E0
-    while (*(s++) != '\0')
-        len++;
-    return len;
+    while (*curS != '\0')
+        curS++;
+    return curS - s;
 }
 
 char *strrchr(char *s, int c)
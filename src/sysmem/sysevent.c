@@ -1,10 +1,86 @@
 #include <common_imp.h>
+#include <sysmem_kdebug.h>
 #include <sysmem_sysevent.h>
 
 #include "intr.h"
 
+/*
+ * Besides the list of all the handlers, every handler is linked into one list per byte of its type mask, so
+ * a dispatch only walks the handlers interested in the suspend, resume, speed change (...) events. All the
+ * lists are sorted by priority. The per-handler bookkeeping is kept in the reserved words of the handler.
+ */
+
+#define SYSEVENT_BUCKET_COUNT       4
+#define SYSEVENT_BUCKET_MASK(b)     (0xFF << ((b) * 8))
+
+/* reserved[] layout */
+#define SYSEVENT_PRIORITY(h)        ((h)->reserved[0])
+#define SYSEVENT_LINK(h, b)         (*(SceSysEventHandler **)&(h)->reserved[1 + (b)])
+#define SYSEVENT_TAG(h)             ((h)->reserved[5])
+#define SYSEVENT_LAST_TIME(h)       ((h)->reserved[6])
+#define SYSEVENT_MAX_TIME(h)        ((h)->reserved[7])
+#define SYSEVENT_BUCKETS(h)         ((h)->reserved[8])
+
+/* Marks a registered handler; it depends on the handler address so a copied handler isn't registered */
+#define SYSEVENT_TAG_VALUE(h)       ((s32)(h) ^ 0x53797345)
+
 // 140F0
 SceSysEventHandler *g_pHandlers;
+SceSysEventHandler *g_pTypeHandlers[SYSEVENT_BUCKET_COUNT];
+
+SceSysEventHandler **SysEventNext(SceSysEventHandler *handler, s32 bucket);
+void SysEventInsert(SceSysEventHandler **head, SceSysEventHandler *handler, s32 bucket);
+void SysEventRemove(SceSysEventHandler **head, SceSysEventHandler *handler, s32 bucket);
+s32 SysEventGetBucket(s32 typeMask);
+
+/* Get the link to the next handler in the list of a bucket, or in the list of all the handlers if bucket is -1 */
+SceSysEventHandler **SysEventNext(SceSysEventHandler *handler, s32 bucket)
+{
+    if (bucket < 0)
+        return &handler->next;
+    return &SYSEVENT_LINK(handler, bucket);
+}
+
+/* Insert a handler before the first one of the same or a higher priority */
+void SysEventInsert(SceSysEventHandler **head, SceSysEventHandler *handler, s32 bucket)
+{
+    SceSysEventHandler **link = head;
+    while (*link != NULL && SYSEVENT_PRIORITY(*link) < SYSEVENT_PRIORITY(handler))
+        link = SysEventNext(*link, bucket);
+    *SysEventNext(handler, bucket) = *link;
+    *link = handler;
+}
+
+void SysEventRemove(SceSysEventHandler **head, SceSysEventHandler *handler, s32 bucket)
+{
+    SceSysEventHandler **link = head;
+    while (*link != NULL)
+    {
+        if (*link == handler)
+        {
+            *link = *SysEventNext(handler, bucket);
+            return;
+        }
+        link = SysEventNext(*link, bucket);
+    }
+}
+
+/* Get the only bucket covering a type mask, or -1 if it spans several buckets and needs the full list */
+s32 SysEventGetBucket(s32 typeMask)
+{
+    s32 ret = -1;
+    s32 i;
+    for (i = 0; i < SYSEVENT_BUCKET_COUNT; i++)
+    {
+        if ((typeMask & SYSEVENT_BUCKET_MASK(i)) != 0)
+        {
+            if (ret >= 0)
+                return -1;
+            ret = i;
+        }
+    }
+    return ret;
+}
 
 int sceKernelUnregisterSysEventHandler(SceSysEventHandler *handler)
 {
@@ -15,29 +91,21 @@ int sceKernelUnregisterSysEventHandler(SceSysEventHandler *handler)
         resumeIntr(oldIntr);
         return 0x80020001;
     }
-    SceSysEventHandler *cur = g_pHandlers;
-    SceSysEventHandler *prev = NULL;
-    // C84C
-    while (cur != NULL)
+    if (SYSEVENT_TAG(handler) != SYSEVENT_TAG_VALUE(handler))
     {
-        if (cur == handler)
-        {
-            // C88C
-            if (prev == NULL) {
-                // C8A0
-                g_pHandlers = cur->next;
-            }
-            else
-                prev->next = cur->next;
-            break;
-        }
-        prev = cur;
-        cur = cur->next;
+        resumeIntr(oldIntr);
+        return 0x80020068;
     }
+    SysEventRemove(&g_pHandlers, handler, -1);
+    s32 i;
+    for (i = 0; i < SYSEVENT_BUCKET_COUNT; i++)
+    {
+        if ((SYSEVENT_BUCKETS(handler) & (1 << i)) != 0)
+            SysEventRemove(&g_pTypeHandlers[i], handler, i);
+    }
+    SYSEVENT_TAG(handler) = 0;
     // C864
     resumeIntr(oldIntr);
-    if (cur == NULL)
-        return 0x80020068;
     return 0;
 }
 
@@ -45,8 +113,9 @@ int sceKernelSysEventDispatch(int ev_type_mask, int ev_id, char* ev_name, void*
 {
     int oldGp = pspGetGp();
     int ret = 0;
+    s32 bucket = SysEventGetBucket(ev_type_mask);
     int oldIntr = suspendIntr();
-    SceSysEventHandler *cur = g_pHandlers;
+    SceSysEventHandler *cur = (bucket < 0) ? g_pHandlers : g_pTypeHandlers[bucket];
     // C928
     while (cur != NULL)
     {
@@ -56,9 +125,14 @@ int sceKernelSysEventDispatch(int ev_type_mask, int ev_id, char* ev_name, void*
             cur->busy = 1;
             resumeIntr(oldIntr);
             pspSetGp(cur->gp);
+            u32 start = pspCop0StateGet(COP0_STATE_COUNT);
             ret = cur->handler(ev_id, ev_name, param, result);
+            u32 time = pspCop0StateGet(COP0_STATE_COUNT) - start;
             oldIntr = suspendIntr();
             cur->busy = 0;
+            SYSEVENT_LAST_TIME(cur) = time;
+            if (time > (u32)SYSEVENT_MAX_TIME(cur))
+                SYSEVENT_MAX_TIME(cur) = time;
             if (ret < 0 && break_nonzero != 0)
             {
                 // C9D8
@@ -69,7 +143,7 @@ int sceKernelSysEventDispatch(int ev_type_mask, int ev_id, char* ev_name, void*
             ret = 0;
         }
         // C934
-        cur = cur->next;
+        cur = *SysEventNext(cur, bucket);
     }
     // C940
     resumeIntr(oldIntr);
@@ -79,52 +153,53 @@ int sceKernelSysEventDispatch(int ev_type_mask, int ev_id, char* ev_name, void*
 
 int sceKernelSysEventInit(void)
 {
+    s32 i;
     g_pHandlers = NULL;
+    for (i = 0; i < SYSEVENT_BUCKET_COUNT; i++)
+        g_pTypeHandlers[i] = NULL;
     return 0;
 }
 
 int sceKernelIsRegisterSysEventHandler(SceSysEventHandler* handler)
 {
-    int oldIntr = suspendIntr();
-    SceSysEventHandler *cur = g_pHandlers;
-    // CA24
-    while (cur != NULL)
-    {
-        if (cur == handler)
-            break;
-        cur = cur->next;
-    }
-    // CA38
-    resumeIntr(oldIntr);
-    return (cur != NULL);
+    if (handler == NULL)
+        return 0;
+    return (SYSEVENT_TAG(handler) == SYSEVENT_TAG_VALUE(handler));
 }
 
 int sceKernelRegisterSysEventHandler(SceSysEventHandler* handler)
 {
-    int oldIntr1 = suspendIntr();
-    int oldIntr2 = suspendIntr();
-    SceSysEventHandler *cur = g_pHandlers;
-    // CA90
-    while (cur != NULL)
+    return sceKernelRegisterSysEventHandlerWithPriority(handler, SCE_SYSEVENT_DEFAULT_PRIORITY);
+}
+
+s32 sceKernelRegisterSysEventHandlerWithPriority(SceSysEventHandler *handler, s32 priority)
+{
+    s32 oldIntr = suspendIntr();
+    if (SYSEVENT_TAG(handler) == SYSEVENT_TAG_VALUE(handler))
     {
-        if (cur == handler)
-            break;
-        cur = cur->next;
+        resumeIntr(oldIntr);
+        return 0x80020067;
     }
-    // CAA4
-    resumeIntr(oldIntr2);
-    if (cur == NULL)
+    handler->busy = 0;
+    // CAE0
+    handler->gp = pspGetGp();
+    SYSEVENT_PRIORITY(handler) = priority;
+    SYSEVENT_LAST_TIME(handler) = 0;
+    SYSEVENT_MAX_TIME(handler) = 0;
+    SYSEVENT_BUCKETS(handler) = 0;
+    SysEventInsert(&g_pHandlers, handler, -1);
+    s32 i;
+    for (i = 0; i < SYSEVENT_BUCKET_COUNT; i++)
     {
-        handler->busy = 0;
-        // CAE0
-        handler->gp = pspGetGp();
-        handler->next = g_pHandlers;
-        g_pHandlers = handler;
-        resumeIntr(oldIntr1);
-        return 0;
+        if ((handler->typeMask & SYSEVENT_BUCKET_MASK(i)) != 0)
+        {
+            SysEventInsert(&g_pTypeHandlers[i], handler, i);
+            SYSEVENT_BUCKETS(handler) |= 1 << i;
+        }
     }
-    resumeIntr(oldIntr1);
-    return 0x80020067;
+    SYSEVENT_TAG(handler) = SYSEVENT_TAG_VALUE(handler);
+    resumeIntr(oldIntr);
+    return 0;
 }
 
 SceSysEventHandler *sceKernelReferSysEventHandler(void)
@@ -132,3 +207,17 @@ SceSysEventHandler *sceKernelReferSysEventHandler(void)
     return g_pHandlers;
 }
 
+s32 sceKernelSysEventPrintTimes(void)
+{
+    s32 oldIntr = suspendIntr();
+    SceSysEventHandler *cur = g_pHandlers;
+    Kprintf("<< sysevent handler times (cycles) >>\n");
+    while (cur != NULL)
+    {
+        Kprintf("%s: mask %08x prio %d last %u max %u\n", cur->name, cur->typeMask, SYSEVENT_PRIORITY(cur),
+                SCE_SYSEVENT_HANDLER_LAST_TIME(cur), SCE_SYSEVENT_HANDLER_MAX_TIME(cur));
+        cur = cur->next;
+    }
+    resumeIntr(oldIntr);
+    return 0;
+}
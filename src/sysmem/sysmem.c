@@ -225,6 +225,9 @@ int SysMemPostInit(SceSysmemMemoryPartition *mainPart, SceSysmemPartTable *partT
     g_MemInfo.kernel = kernelPart;
     kernelPart->firstCtlBlk = mainPart->firstCtlBlk;
     kernelPart->ctlBlkCount = mainPart->ctlBlkCount;
+    kernelPart->maxFreeSegs = mainPart->maxFreeSegs;
+    kernelPart->freeSegs = mainPart->freeSegs;
+    kernelPart->watermark = 0;
     kernelPart->lastCtlBlk = mainPart->firstCtlBlk;
     g_MemInfo.main = kernelPart;
     MemoryBlockServiceInit();
@@ -234,6 +237,9 @@ int SysMemPostInit(SceSysmemMemoryPartition *mainPart, SceSysmemPartTable *partT
     memBlock->addr = memblk_kernel.addr;
     memBlock->size = memblk_kernel.size;
     memBlock->part = memblk_kernel.part;
+    // the protected blocks are never moved, like the blocks allocated at a fixed address
+    memBlock->type = 2;
+    memBlock->align = 0;
     sceKernelProtectMemoryBlock(memblk_kernel.part, memblk_kernel.addr);
     sceKernelCreateUID(g_MemBlockType, "SceSystemBlock", (pspGetK1() >> 31) & 0xFF, &uidKernel);
     memBlock = UID_CB_TO_DATA(uidKernel, g_MemBlockType, SceSysmemMemoryBlock);
@@ -241,6 +247,8 @@ int SysMemPostInit(SceSysmemMemoryPartition *mainPart, SceSysmemPartTable *partT
     memBlock->addr = memblk_memman.addr;
     memBlock->size = memblk_memman.size;
     memBlock->part = memblk_memman.part;
+    memBlock->type = 2;
+    memBlock->align = 0;
     sceKernelProtectMemoryBlock(memblk_memman.part, memblk_memman.addr);
     if (partTable->unk4 != 3)
         info = &partTable->other1;
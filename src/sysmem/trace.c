@@ -0,0 +1,133 @@
+#include <sysmem_kdebug.h>
+#include <sysmem_kernel.h>
+
+#include "intr.h"
+#include "memory.h"
+#include "partition.h"
+
+#include "trace.h"
+
+/* SysmemTraceResumeIntr() calls the real function */
+#undef resumeIntr
+
+/*
+ * Allocation tracing, enabled by building sysmem with SYSMEM_TRACE defined ("make TRACE=1").
+ * Every partition and lowheap allocation and free is recorded in a ring buffer, which can be printed with
+ * sceKernelPrintSysmemTrace() and analyzed on the host with utils/sysmem-trace.
+ */
+
+#ifdef SYSMEM_TRACE
+
+typedef struct {
+    u32 time; // 0 CP0 count register
+    u32 ra; // 4 return address of the exported function called from outside sysmem
+    u32 kind; // 8 SYSMEM_TRACE_*
+    u32 obj; // 12 partition start address or lowheap
+    u32 arg; // 16 size for allocations, address for frees
+    u32 result; // 20 address for allocations, error code for frees
+} SceSysmemTraceEntry; // size: 24
+
+SceSysmemTraceEntry g_TraceEntries[SYSMEM_TRACE_SIZE];
+/* Total number of records, including the overwritten ones */
+u32 g_TraceCount;
+/* Return address of the exported function called from outside sysmem running with the interrupts disabled, or 0 */
+u32 g_TraceCaller;
+
+/* Bounds of the sysmem code, from the linker script */
+extern char _ftext[], _etext[];
+
+void SysmemTraceRecord(u32 kind, u32 obj, u32 arg, u32 result);
+
+void SysmemTraceSetCaller(u32 ra)
+{
+    /* Exported functions called by sysmem itself keep the caller of the outermost one */
+    if (ra >= (u32)_ftext && ra < (u32)_etext)
+        return;
+    g_TraceCaller = ra;
+}
+
+void SysmemTraceResumeIntr(s32 oldIntr)
+{
+    // Only the outermost resumeIntr() enables the interrupts
+    if (oldIntr != 0)
+        g_TraceCaller = 0;
+    resumeIntr(oldIntr);
+}
+
+void SysmemTraceRecord(u32 kind, u32 obj, u32 arg, u32 result)
+{
+    s32 oldIntr = suspendIntr();
+    SceSysmemTraceEntry *entry = &g_TraceEntries[g_TraceCount % SYSMEM_TRACE_SIZE];
+    entry->time = pspCop0StateGet(COP0_STATE_COUNT);
+    entry->ra = g_TraceCaller;
+    entry->kind = kind;
+    entry->obj = obj;
+    entry->arg = arg;
+    entry->result = result;
+    g_TraceCount++;
+    resumeIntr(oldIntr);
+}
+
+void *_allocSysMemory(SceSysmemMemoryPartition *part, int type, u32 size, u32 addr, SceSysmemCtlBlk **ctlBlkOut)
+{
+    void *ret = _allocSysMemoryUntraced(part, type, size, addr, ctlBlkOut);
+    SysmemTraceRecord(SYSMEM_TRACE_ALLOC_SEGS, part->addr, size, (u32)ret);
+    return ret;
+}
+
+s32 _freeSysMemory(SceSysmemMemoryPartition *part, void *addr)
+{
+    s32 ret = _freeSysMemoryUntraced(part, addr);
+    SysmemTraceRecord(SYSMEM_TRACE_FREE_SEGS, part->addr, (u32)addr, ret);
+    return ret;
+}
+
+void *hmalloc(SceSysmemHeap *heap, SceSysmemLowheap *lowh, u32 size, u32 align)
+{
+    void *ret = hmallocUntraced(heap, lowh, size, align);
+    SysmemTraceRecord(SYSMEM_TRACE_HEAP_ALLOC, (u32)lowh, size, (u32)ret);
+    return ret;
+}
+
+s32 hfree(SceSysmemHeap *heap, SceSysmemLowheap *lowh, void *ptr)
+{
+    s32 ret = hfreeUntraced(heap, lowh, ptr);
+    SysmemTraceRecord(SYSMEM_TRACE_HEAP_FREE, (u32)lowh, (u32)ptr, ret);
+    return ret;
+}
+
+#endif
+
+/*
+ * Dump format, one record per line:
+ *   P <partition start> <partition size>
+ *   <kind> <time> <caller> <partition or lowheap> <size or address> <result>
+ * All the numbers are hexadecimal; records are printed from the oldest to the newest.
+ */
+s32 sceKernelPrintSysmemTrace(void)
+{
+#ifdef SYSMEM_TRACE
+    s32 oldIntr = suspendIntr();
+    Kprintf("<< sysmem trace >>\n");
+    SceSysmemMemoryPartition *part = g_MemInfo.main;
+    while (part != NULL) {
+        Kprintf("P %08x %08x\n", part->addr, part->size);
+        part = part->next;
+    }
+    u32 lost = 0;
+    if (g_TraceCount > SYSMEM_TRACE_SIZE)
+        lost = g_TraceCount - SYSMEM_TRACE_SIZE;
+    u32 i;
+    for (i = lost; i < g_TraceCount; i++) {
+        SceSysmemTraceEntry *entry = &g_TraceEntries[i % SYSMEM_TRACE_SIZE];
+        Kprintf("%c %08x %08x %08x %08x %08x\n", entry->kind, entry->time, entry->ra, entry->obj, entry->arg, entry->result);
+    }
+    Kprintf("<< end of trace: %u records, %u lost >>\n", g_TraceCount, lost);
+    resumeIntr(oldIntr);
+    return 0;
+#else
+    Kprintf("sysmem was built without SYSMEM_TRACE\n");
+    return 0x80020001;
+#endif
+}
+
@@ -0,0 +1,46 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "heap.h"
+#include "partition.h"
+
+/* Kinds of trace records, also used as the first character of the dumped lines */
+#define SYSMEM_TRACE_ALLOC_SEGS     'A' // _allocSysMemory(part, size) = addr
+#define SYSMEM_TRACE_FREE_SEGS      'F' // _freeSysMemory(part, addr) = error code
+#define SYSMEM_TRACE_HEAP_ALLOC     'a' // hmalloc(lowh, size) = addr
+#define SYSMEM_TRACE_HEAP_FREE      'f' // hfree(lowh, addr) = error code
+
+/* Number of records kept; the oldest ones are overwritten */
+#define SYSMEM_TRACE_SIZE           512
+
+#ifdef SYSMEM_TRACE
+
+/* The allocators are wrapped to record every call: their real implementation is renamed */
+#define SYSMEM_TRACED(func) func##Untraced
+
+void *_allocSysMemoryUntraced(SceSysmemMemoryPartition *part, int type, u32 size, u32 addr, SceSysmemCtlBlk **ctlBlkOut);
+s32 _freeSysMemoryUntraced(SceSysmemMemoryPartition *part, void *addr);
+void *hmallocUntraced(SceSysmemHeap *heap, SceSysmemLowheap *lowh, u32 size, u32 align);
+s32 hfreeUntraced(SceSysmemHeap *heap, SceSysmemLowheap *lowh, void *ptr);
+
+void SysmemTraceSetCaller(u32 ra);
+void SysmemTraceResumeIntr(s32 oldIntr);
+
+/*
+ * Used by the exported functions which can allocate or free memory, once they have disabled the interrupts, to
+ * record the module calling them. The return address of the allocators themselves would always point inside sysmem.
+ */
+#define SYSMEM_TRACE_CALLER() SysmemTraceSetCaller((u32)__builtin_return_address(0))
+
+/* The caller is forgotten when the interrupts are enabled again, at the end of the exported function */
+#define resumeIntr(oldIntr) SysmemTraceResumeIntr(oldIntr)
+
+#else
+
+#define SYSMEM_TRACED(func) func
+#define SYSMEM_TRACE_CALLER()
+
+#endif
+
+#endif
+
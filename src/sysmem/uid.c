@@ -6,6 +6,7 @@
 #include "intr.h"
 #include "memory.h"
 #include "partition.h"
+#include "trace.h"
 
 typedef struct SceSysmemHoldElem {
     struct SceSysmemHoldElem *next; // 0
@@ -26,6 +27,27 @@ typedef struct {
     SceSysmemUidCB *uid0; // 20
 } SceSysmemHoldElement;
 
+typedef struct SceSysmemUidNameEntry {
+    struct SceSysmemUidNameEntry *next; // 0
+    SceSysmemUidCB *uid; // 4
+    u32 order; // 8: value of g_uidTypeList.count when the object was created
+} SceSysmemUidNameEntry; // size: 12
+
+/* Number of buckets of the object name index (must be a power of 2) */
+#define UID_NAME_HASH_SIZE 256
+
+typedef struct {
+    SceSysmemUidCB *type; // 0
+    s32 funcId; // 4
+    SceSysmemUidFunc func; // 8: NULL if the type doesn't implement the function
+    SceSysmemUidCB *uidWithFunc; // 12
+    u32 hits; // 16
+    u32 fills; // 20
+} SceSysmemUidFuncCacheEntry; // size: 24
+
+/* Number of entries of the method cache (must be a power of 2) */
+#define UID_FUNC_CACHE_SIZE 64
+
 s32 obj_no_op(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc, int funcId, va_list ap);
 s32 obj_do_delete(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc, int funcId, va_list ap);
 s32 obj_do_delete2(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc, int funcId, va_list ap);
@@ -39,6 +61,13 @@ s32 obj_do_initialize(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc, int func
 void InitUidBasic(SceSysmemUidCB *root, char *rootName, SceSysmemUidCB *metaRoot, char *metaRootName, SceSysmemUidCB *basic, char *basicName, SceSysmemUidCB *metaBasic, char *metaBasicName);
 SceSysmemUidCB *search_UidType_By_Name(const char *name);
 SceSysmemUidCB *search_UIDObj_By_Name_With_Type(const char *name, SceSysmemUidCB *type);
+SceSysmemUidCB *search_UIDObj_By_Name(const char *name, SceSysmemUidCB *type);
+u32 UidNameHash(const char *name);
+s32 AddUidNameEntry(SceSysmemUidCB *uid);
+void RemoveUidNameEntry(SceSysmemUidCB *uid);
+void LinkUidNameEntry(SceSysmemUidNameEntry *entry);
+SceSysmemUidNameEntry *UnlinkUidNameEntry(SceSysmemUidCB *uid);
+void InvalidateUidFuncCache(void);
 
 // 140D8
 SceSysmemHeap EHeap4UID;
@@ -52,6 +81,14 @@ SceUID HeapCBUid;
 // 145B0
 SceSysmemUidList g_uidTypeList;
 
+/* Index of all the UID objects by name, so searching them doesn't need to walk every type */
+SceSysmemUidNameEntry *g_uidNameHash[UID_NAME_HASH_SIZE];
+
+/* Resolved (type, function ID) pairs, so calls don't walk the inheritance chain and the function tables each time */
+SceSysmemUidFuncCacheEntry g_uidFuncCache[UID_FUNC_CACHE_SIZE];
+u32 g_uidFuncCacheHits;
+u32 g_uidFuncCacheMisses;
+
 void InitUid(void)
 {
     SceSysmemHeapBlock *heapBlock = NULL;
@@ -188,6 +225,7 @@ s32 sceKernelCallUIDFunction(SceUID id, int funcId, ...)
     va_list ap;
     va_start(ap, funcId);
     s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceSysmemUidCB *uid = (SceSysmemUidCB*)(0x88000000 | (((u32)id >> 7) << 2));
     if (id < 0) {
         // ACAC (dup)
@@ -221,6 +259,7 @@ s32 sceKernelCallUIDObjFunction(SceSysmemUidCB *uid, s32 funcId, ...)
     SceSysmemUidFunc func = NULL;
     SceSysmemUidCB *parentUid;
     s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     sceKernelLookupUIDFunction(uid->meta, funcId, &func, &parentUid);
     s32 ret;
     if (func == NULL) {
@@ -238,6 +277,21 @@ int sceKernelLookupUIDFunction(SceSysmemUidCB *uid, int id, SceSysmemUidFunc *fu
 {
     int oldIntr = suspendIntr();
     *func = NULL;
+    SceSysmemUidFuncCacheEntry *entry = &g_uidFuncCache[(((u32)uid >> 2) ^ (u32)id ^ ((u32)id >> 16)) & (UID_FUNC_CACHE_SIZE - 1)];
+    if (uid != NULL && entry->type == uid && entry->funcId == id) {
+        entry->hits++;
+        g_uidFuncCacheHits++;
+        if (entry->func == NULL) {
+            resumeIntr(oldIntr);
+            return 0x800200CE;
+        }
+        *parentUidWithFunc = entry->uidWithFunc;
+        *func = entry->func;
+        resumeIntr(oldIntr);
+        return 0;
+    }
+    g_uidFuncCacheMisses++;
+    SceSysmemUidCB *type = uid;
     // AE18
     while (uid != NULL) {
         if (uid->funcTable != NULL) {
@@ -248,19 +302,61 @@ int sceKernelLookupUIDFunction(SceSysmemUidCB *uid, int id, SceSysmemUidFunc *fu
                     // AE80
                     *parentUidWithFunc = uid;
                     *func = cur->func;
-                    resumeIntr(oldIntr);
-                    return 0;
+                    break;
                 }
                 cur++;
             }
+            if (*func != NULL)
+                break;
         }
         // (AE48)
         uid = uid->PARENT1;
         // AE4C
     }
+    if (type != NULL) {
+        if (entry->type != type || entry->funcId != id) {
+            entry->hits = 0;
+            entry->fills = 0;
+        }
+        entry->type = type;
+        entry->funcId = id;
+        entry->func = *func;
+        entry->uidWithFunc = uid;
+        entry->fills++;
+    }
     // AE54
     resumeIntr(oldIntr);
-    return 0x800200CE;
+    if (*func == NULL)
+        return 0x800200CE;
+    return 0;
+}
+
+void InvalidateUidFuncCache(void)
+{
+    memset(g_uidFuncCache, 0, sizeof(g_uidFuncCache));
+}
+
+s32 sceKernelPrintUidFuncCache(void)
+{
+    s32 oldIntr = suspendIntr();
+    Kprintf("<< UID method cache >>\n");
+    Kprintf("  hits %u, misses %u\n", g_uidFuncCacheHits, g_uidFuncCacheMisses);
+    SceSysmemUidCB *type = g_uidTypeList.root;
+    do {
+        u32 hits = 0, fills = 0;
+        u32 i;
+        for (i = 0; i < UID_FUNC_CACHE_SIZE; i++) {
+            if (g_uidFuncCache[i].type == type) {
+                hits += g_uidFuncCache[i].hits;
+                fills += g_uidFuncCache[i].fills;
+            }
+        }
+        if (hits + fills != 0)
+            Kprintf("  [%s]: %u hits, %u misses\n", type->name, hits, fills);
+        type = type->next.next;
+    } while (type != g_uidTypeList.root);
+    resumeIntr(oldIntr);
+    return 0;
 }
 
 s32 sceKernelCallUIDObjCommonFunction(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc, s32 funcId, va_list ap)
@@ -288,6 +384,7 @@ int sceKernelCreateUIDtypeInherit(const char *parentName, const char *name, int
     if (parentName == NULL || name == NULL)
         return 0x80020001;
     int oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     if (search_UidType_By_Name(name) != 0)
     {
         // B1A8
@@ -349,6 +446,7 @@ int sceKernelCreateUIDtypeInherit(const char *parentName, const char *name, int
     uidType->funcTable = funcTable;
     *uidTypeOut = uidType;
     metaUidType->funcTable = metaFuncTable;
+    InvalidateUidFuncCache();
     resumeIntr(oldIntr);
     return 0;
 }
@@ -358,6 +456,7 @@ int sceKernelCreateUID(SceSysmemUidCB *type, const char *name, char k1, SceSysme
     if (type == NULL || name == NULL)
         return 0x80020001;
     int oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     *outUid = NULL;
     SceSysmemUidCB *uid = AllocSceUIDobjectCB(type->childSize * 4);
     if (uid == NULL) {
@@ -384,6 +483,15 @@ int sceKernelCreateUID(SceSysmemUidCB *type, const char *name, char k1, SceSysme
     uid->size = type->size;
     uid->childSize = type->childSize;
     uid->meta = type;
+    if (AddUidNameEntry(uid) != 0) {
+        uid->PARENT0->nextChild = uid->nextChild;
+        uid->nextChild->PARENT0 = uid->PARENT0;
+        FreeSceUIDnamestr(nameBuf);
+        FreeSceUIDobjectCB(uid);
+        *outUid = NULL;
+        resumeIntr(oldIntr);
+        return 0x80020190;
+    }
     sceKernelCallUIDObjFunction(uid, 0xD310D2D9);
     resumeIntr(oldIntr);
     return 0;
@@ -398,14 +506,7 @@ SceUID sceKernelSearchUIDbyName(const char *name, SceUID typeId)
     SceSysmemUidCB *uid;
     if (typeId == 0) {
         // B438
-        SceSysmemUidCB *cur = g_uidTypeList.root;
-        // B444
-        do {
-            uid = search_UIDObj_By_Name_With_Type(name, cur);
-            if (uid != NULL)
-                break;
-            cur = cur->next.next;
-        } while (cur != g_uidTypeList.root);
+        uid = search_UIDObj_By_Name(name, NULL);
     } else {
         SceSysmemUidCB *typeUid = (SceSysmemUidCB*)(0x88000000 | (((u32)typeId >> 7) * 4));
         if ((typeId & 0x80000001) != 1 || (u32)typeUid < part->addr ||
@@ -420,7 +521,7 @@ SceUID sceKernelSearchUIDbyName(const char *name, SceUID typeId)
             resumeIntr(oldIntr);
             return 0x800200C9;
         }
-        uid = search_UIDObj_By_Name_With_Type(name, typeUid);
+        uid = search_UIDObj_By_Name(name, typeUid);
     }
     // (B41C)
     // B420
@@ -462,20 +563,87 @@ SceSysmemUidCB *search_UIDObj_By_Name_With_Type(const char *name, SceSysmemUidCB
         if (name != NULL && parent->name != NULL) {
             const char *curName = name;
             char *curParentName = parent->name;
-            char lastChar = *curParentName;
             // B53C, B540
-            while (lastChar == *(curName++)) {
-                if (lastChar == '\0')
+            while (*curParentName == *(curName++)) {
+                if (*(curParentName++) == '\0')
                     return parent;
-                lastChar = *(curParentName++);
             }
         }
-        type = type->PARENT0;
+        parent = parent->PARENT0;
         // B52C
     }
     return 0;
 }
 
+u32 UidNameHash(const char *name)
+{
+    u32 hash = 0;
+    while (*name != '\0')
+        hash = hash * 31 + (u8)*(name++);
+    return (hash ^ (hash >> 8)) & (UID_NAME_HASH_SIZE - 1);
+}
+
+/* Indexes a new object, in the bucket of its name */
+s32 AddUidNameEntry(SceSysmemUidCB *uid)
+{
+    SceSysmemUidNameEntry *entry = _AllocHeapMemory(&EHeap4UID, sizeof(SceSysmemUidNameEntry), 0);
+    if (entry == NULL)
+        return 0x80020190;
+    entry->uid = uid;
+    entry->order = g_uidTypeList.count;
+    LinkUidNameEntry(entry);
+    return 0;
+}
+
+void RemoveUidNameEntry(SceSysmemUidCB *uid)
+{
+    SceSysmemUidNameEntry *entry = UnlinkUidNameEntry(uid);
+    if (entry != NULL)
+        _FreeHeapMemory(&EHeap4UID, entry);
+}
+
+void LinkUidNameEntry(SceSysmemUidNameEntry *entry)
+{
+    u32 hash = UidNameHash(entry->uid->name);
+    entry->next = g_uidNameHash[hash];
+    g_uidNameHash[hash] = entry;
+}
+
+/* Takes the entry of the object out of the bucket of its current name, returns NULL if it has none */
+SceSysmemUidNameEntry *UnlinkUidNameEntry(SceSysmemUidCB *uid)
+{
+    SceSysmemUidNameEntry **prev = &g_uidNameHash[UidNameHash(uid->name)];
+    SceSysmemUidNameEntry *cur = *prev;
+    while (cur != NULL) {
+        if (cur->uid == uid) {
+            *prev = cur->next;
+            return cur;
+        }
+        prev = &cur->next;
+        cur = cur->next;
+    }
+    return NULL;
+}
+
+/*
+ * Searches an object by name, in the given type or in all of them if 'type' is NULL.
+ * If several objects match, the first one created is returned.
+ */
+SceSysmemUidCB *search_UIDObj_By_Name(const char *name, SceSysmemUidCB *type)
+{
+    SceSysmemUidNameEntry *cur = g_uidNameHash[UidNameHash(name)];
+    SceSysmemUidNameEntry *found = NULL;
+    while (cur != NULL) {
+        if ((type == NULL || cur->uid->meta == type) && strcmp(cur->uid->name, name) == 0
+            && (found == NULL || (s32)(cur->order - found->order) < 0))
+            found = cur;
+        cur = cur->next;
+    }
+    if (found == NULL)
+        return NULL;
+    return found->uid;
+}
+
 // 13570
 SceSysmemUidLookupFunc RootFuncs[] = {
     { 0xD310D2D9, obj_no_op },
@@ -565,12 +733,17 @@ int _sceKernelCreateUIDtypeInherit_sub(SceSysmemUidCB *root, SceSysmemUidCB *bas
 int sceKernelCreateUIDtype(const char *name, int size, SceSysmemUidLookupFunc *funcTable,
                            SceSysmemUidLookupFunc *metaFuncTable, SceSysmemUidCB **uidTypeOut)
 {
-    return sceKernelCreateUIDtypeInherit("Basic", name, size, funcTable, metaFuncTable, uidTypeOut);
+    s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
+    s32 ret = sceKernelCreateUIDtypeInherit("Basic", name, size, funcTable, metaFuncTable, uidTypeOut);
+    resumeIntr(oldIntr);
+    return ret;
 }
 
 s32 sceKernelDeleteUIDtype(SceSysmemUidCB *uid)
 {
     s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     if (uid->PARENT0 != uid || uid->meta->next.next != NULL) {
         // B8B0
         resumeIntr(oldIntr);
@@ -588,6 +761,7 @@ s32 sceKernelDeleteUIDtype(SceSysmemUidCB *uid)
     FreeSceUIDnamestr(uid->meta->name);
     FreeSceUIDtypeCB(uid->meta);
     FreeSceUIDtypeCB(uid);
+    InvalidateUidFuncCache();
     resumeIntr(oldIntr);
     return 0;
 }
@@ -626,6 +800,7 @@ s32 sceKernelRenameUID(SceUID id, const char *name)
 {
     SceSysmemMemoryPartition *part = g_MemInfo.kernel;
     s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceSysmemUidCB *uid = (SceSysmemUidCB*)(0x88000000 | (((u32)id >> 7) * 4));
     if ((id & 0x80000001) != 1 || (u32)uid < part->addr ||
         (u32)uid >= part->addr + part->size || uid->uid != id) {
@@ -634,14 +809,21 @@ s32 sceKernelRenameUID(SceUID id, const char *name)
         return 0x800200CB;
     }
     // BA78
-    FreeSceUIDnamestr(uid->name);
+    // The old name is kept until the new one is allocated
     char *newName = AllocSceUIDnamestr(name, "");
     if (newName == NULL) {
         // BAAC
         resumeIntr(oldIntr);
         return 0x80020190;
     }
+    /* Types aren't in the name index, only objects are: their entry is moved to the bucket of the new name */
+    SceSysmemUidNameEntry *entry = NULL;
+    if (uid->meta->meta != g_uidTypeList.metaRoot)
+        entry = UnlinkUidNameEntry(uid);
+    FreeSceUIDnamestr(uid->name);
     uid->name = newName;
+    if (entry != NULL)
+        LinkUidNameEntry(entry);
     resumeIntr(oldIntr);
     return 0;
 }
@@ -659,7 +841,11 @@ s32 sceKernelGetUIDtype(SceUID id)
 
 s32 sceKernelDeleteUID(SceUID id)
 {
-    return sceKernelCallUIDFunction(id, 0x87089863);
+    s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
+    s32 ret = sceKernelCallUIDFunction(id, 0x87089863);
+    resumeIntr(oldIntr);
+    return ret;
 }
 
 s32 sceKernelGetUIDcontrolBlock(SceUID id, SceSysmemUidCB **uidOut)
@@ -743,6 +929,7 @@ s32 obj_no_op(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc __attribute__((un
 
 s32 obj_do_delete(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc __attribute__((unused)), int funcId __attribute__((unused)), va_list ap __attribute__((unused)))
 {
+    RemoveUidNameEntry(uid);
     uid->meta = NULL;
     uid->PARENT0->nextChild = uid->nextChild;
     uid->uid = 0;
@@ -915,6 +1102,7 @@ s32 sceKernelHoldUID(SceUID id0, SceUID id1)
     SceSysmemHoldHead *head0 = NULL;
     SceSysmemHoldHead *head1 = NULL;
     s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceSysmemUidCB *uid0 = (SceSysmemUidCB*)(0x88000000 | (((u32)id0 >> 7) * 4));
     SceSysmemUidCB *uid1 = (SceSysmemUidCB*)(0x88000000 | (((u32)id1 >> 7) * 4));
     if (id1 < 1 || id0 < 1 || uid1->uid != id1 || uid0->uid != id0) {
@@ -1003,6 +1191,7 @@ s32 sceKernelHoldUID(SceUID id0, SceUID id1)
 s32 sceKernelReleaseUID(SceUID id0, SceUID id1)
 {
     s32 oldIntr = suspendIntr();
+    SYSMEM_TRACE_CALLER();
     SceSysmemUidCB *uid0 = (SceSysmemUidCB*)(0x88000000 | (((u32)id0 >> 7) * 4));
     SceSysmemUidCB *uid1 = (SceSysmemUidCB*)(0x88000000 | (((u32)id1 >> 7) * 4));
     if (id1 < 1 || id0 < 1 || uid1->uid != id1 || uid0->uid != id0) {
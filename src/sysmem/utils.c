@@ -3,10 +3,16 @@
 #include <sysmem_sysclib.h>
 #include <sysmem_utils_kernel.h>
 
+#include "deflate.h"
+#include "digest.h"
 #include "start.h"
 
 u32 sceKernelUtilsMt19937UInt(SceKernelUtilsMt19937Context *ctx);
+void Mt19937Generate(SceKernelUtilsMt19937Context *ctx, u32 *out, u32 count);
 const void *sceKernelGzipGetCompressedData(const void *buf);
+void GzipInitCrcTable(void);
+u32 GzipCrc32(u32 crc, const u8 *data, u32 size);
+s32 GzipCollect(SceKernelGzipStream *stream, const u8 **in, const u8 *end, u32 size);
 
 int sceKernelDcacheInvalidateRangeForUser(const void *p, u32 size)
 {
@@ -84,48 +90,19 @@ int sceKernelUtilsMd5BlockUpdate(SceKernelUtilsMd5Context *ctx, u8 *data, u32 si
         // EE44
         return -1;
     }
-    int remaining = ctx->usRemains;
     if (ctx->usRemains >= 64)
     {
         // EE34
         pspSetK1(oldK1);
         return 0x800201BC;
     }
-    ctx->ullTotalLen += size;
-    int numTotal = ctx->usRemains + size;
-    // EDB0
-    while (numTotal >= 64)
-    {
-        if (remaining == 0)
-        {
-            // EE1C
-            data += 64;
-            memcpy(ctx->buf, data, 64);
-        }
-        else
-        {
-            data += 64 - remaining;
-            memcpy(ctx + remaining + 32, data, 64 - remaining);
-            remaining = 0;
-        }
-        // EDD4
-        numTotal -= 64;
-        md5BlockUpdate(ctx, ctx->buf);
-    }
-    // EDEC
-    if (numTotal != 0) {
-        // EE04
-        memcpy(ctx + remaining + 32, data, numTotal - remaining);
-    }
-    ctx->usRemains = numTotal;
-    // EDF8
+    Md5Update(ctx, data, size);
     pspSetK1(oldK1);
     return 0;
 }
 
 int sceKernelUtilsMd5BlockResult(SceKernelUtilsMd5Context *ctx, u8 *digest)
 {
-    u8 buf[64];
     int oldK1 = pspShiftK1();
     if (!pspK1PtrOk(ctx) || !pspK1PtrOk(digest)
      || ctx == NULL || digest == NULL) {
@@ -135,43 +112,22 @@ int sceKernelUtilsMd5BlockResult(SceKernelUtilsMd5Context *ctx, u8 *digest)
     // EED0
     if (ctx->usComputed == 0)
     {
-        short remain = ctx->usRemains;
-        if (remain >= 64)
+        if (ctx->usRemains >= 64)
         {
             // EFE4
             pspSetK1(oldK1);
             return 0x800201BC;
         }
-        memset(buf, 0, 64);
-        memcpy(buf, ctx->buf, remain);
-        buf[remain] = 0x80;
-        if (remain >= 56)
-        {
-            // EFC0
-            md5BlockUpdate(ctx, buf);
-            memset(buf, 0, 64);
-        }
-        // EF1C
-        u64 num = ctx->ullTotalLen * 8;
-        // EF38
-        int i;
-        for (i = 0; i < 8; i++) {
-            // EF74
-            buf[i + 56] = num >> (i * 8);
-        }
-        md5BlockUpdate(ctx, buf);
-        ctx->usComputed = 1;
-        memset(ctx->buf, 0, 64);
+        Md5Final(ctx);
     }
     // EFA8
-    memcpy(digest, ctx, 16);
+    memcpy(digest, ctx->h, 16);
     pspSetK1(oldK1);
     return 0;
 }
 
 int sceKernelUtilsMd5Digest(u8 *data, u32 size, u8 *digest)
 {
-    SceKernelUtilsMd5Context ctx;
     int oldK1 = pspShiftK1();
     if (!pspK1DynBufOk(data, size) || !pspK1PtrOk(digest))
     {
@@ -179,20 +135,7 @@ int sceKernelUtilsMd5Digest(u8 *data, u32 size, u8 *digest)
         pspSetK1(oldK1);
         return 0x800200D3;
     }
-    // F068
-    if (pspK1PtrOk(&ctx)) // ?!?
-    {
-        ctx.h[0] = 0x67452301;
-        ctx.h[1] = 0xEFCDAB89;
-        ctx.h[2] = 0x89BADCFE;
-        ctx.h[3] = 0x10325476;
-        ctx.ullTotalLen = 0;
-        ctx.usRemains = 0;
-        ctx.usComputed = 0;
-    }
-    // F0B8
-    sceKernelUtilsMd5BlockUpdate(&ctx, data, size);
-    sceKernelUtilsMd5BlockResult(&ctx, digest);
+    Md5Digest(data, size, digest);
     pspSetK1(oldK1);
     return 0;
 }
@@ -204,20 +147,13 @@ int sceKernelUtilsMd5BlockInit(SceKernelUtilsMd5Context *ctx)
         pspSetK1(oldK1);
         return 0x800200D3;
     }
-    ctx->h[0] = 0x67452301;
-    ctx->ullTotalLen = 0;
-    ctx->h[1] = 0xEFCDAB89;
-    ctx->h[2] = 0x98BADCFE;
-    ctx->h[3] = 0x10325476;
-    ctx->usRemains = 0;
-    ctx->usComputed = 0;
+    Md5Init(ctx);
     pspSetK1(oldK1);
     return 0;
 }
 
 int sceKernelUtilsSha1BlockUpdate(SceKernelUtilsSha1Context *ctx, u8 *data, u32 size)
 {
-    int buf[16];
     int oldK1 = pspShiftK1();
     if (!pspK1PtrOk(ctx) || !pspK1DynBufOk(data, size) || ctx == NULL || data == NULL)
     {
@@ -232,53 +168,19 @@ int sceKernelUtilsSha1BlockUpdate(SceKernelUtilsSha1Context *ctx, u8 *data, u32
         // F2F8
         return -1;
     }
-    u16 remaining = ctx->usRemains;
-    if (remaining >= 64)
+    if (ctx->usRemains >= 64)
     {
         // F2E8
         pspSetK1(oldK1);
         return 0x800201BC;
     }
-    ctx->ullTotalLen += size;
-    u16 total = remaining + size;
-    // F230
-    while (total >= 64)
-    {
-        if (remaining == 0)
-        {
-            // F2D4
-            memcpy(buf, data, 64);
-            data += 64;
-        }
-        else
-        {
-            memcpy(buf, ctx->buf, remaining);
-            data += 64 - remaining;
-            memcpy(buf + remaining, data, 64 - remaining);
-            remaining = 0;
-        }
-        // F264
-        // F26C
-        int i;
-        for (i = 0; i < 16; i++)
-            buf[i] = pspWsbw(buf[i]);
-        total -= 64;
-        sha1BlockUpdate((u8 *)buf, ctx);
-    }
-    // F2A4
-    if (total != 0) {
-        // F2BC
-        memcpy(&ctx->buf[remaining], data, total - remaining);
-    }
-    ctx->usRemains = total;
-    // F2B0
+    Sha1Update(ctx, data, size);
     pspSetK1(oldK1);
     return 0;
 }
 
 int sceKernelUtilsSha1BlockResult(SceKernelUtilsSha1Context *ctx, u8 *digest)
 {
-    int buf[16];
     int oldK1 = pspShiftK1();
     if (!pspK1PtrOk(ctx) || !pspK1PtrOk(digest) || ctx == NULL || digest == NULL)
     {
@@ -289,36 +191,13 @@ int sceKernelUtilsSha1BlockResult(SceKernelUtilsSha1Context *ctx, u8 *digest)
     // F384
     if (ctx->usComputed == 0)
     {
-        int i;
         if (ctx->usRemains >= 64)
         {
             // F500
             pspSetK1(oldK1);
             return 0x800201BC;
         }
-        memset(buf, 0, 64);
-        memcpy(buf, ctx->buf, ctx->usRemains);
-        buf[ctx->usRemains] = 0x80;
-        if (ctx->usRemains >= 56)
-        {
-            // F3D8
-            for (i = 0; i < 16; i++)
-                buf[i] = pspWsbw(buf[i]);
-            sha1BlockUpdate((u8 *)buf, ctx);
-            memset(buf, 0, 64);
-        }
-        // F410
-        for (i = 0; i < 8; i++)
-            ((char*)buf)[i + 56] = ctx->ullTotalLen >> (56 - i * 8);
-        // F480
-        for (i = 0; i < 16; i++)
-            buf[i] = pspWsbw(buf[i]);
-        sha1BlockUpdate((u8 *)buf, ctx);
-        // F4B0
-        for (i = 0; i < 5; i++)
-            ctx->h[i] = pspWsbw(ctx->h[i]);
-        ctx->usComputed = 1;
-        memset(ctx->buf, 0, 64);
+        Sha1Final(ctx);
     }
     // F4E8
     memcpy(digest, ctx->h, 20);
@@ -335,7 +214,7 @@ int sceKernelUtilsSha1Digest(u8 *data, u32 size, u8 *digest)
         pspSetK1(oldK1);
         return 0x800200D3;
     }
-    sha1Digest(data, size, digest);
+    Sha1Digest(data, size, digest);
     pspSetK1(oldK1);
     return 0;
 }
@@ -349,18 +228,100 @@ int sceKernelUtilsSha1BlockInit(SceKernelUtilsSha1Context *ctx)
         pspSetK1(oldK1);
         return 0x800200D3;
     }
-    ctx->ullTotalLen = 0;
-    ctx->h[0] = 0x67452301;
-    ctx->h[1] = 0xEFCDAB89;
-    ctx->h[2] = 0x98BADCFE;
-    ctx->h[3] = 0x10325476;
-    ctx->h[4] = 0xC3D2E1F0;
-    ctx->usRemains = 0;
-    ctx->usComputed = 0;
+    Sha1Init(ctx);
     pspSetK1(oldK1);
     return 0;
 }
 
+s32 sceKernelUtilsMd5DigestBatch(const SceKernelUtilsDigestEntry *entries, u32 count)
+{
+    u32 i;
+    if (entries == NULL)
+        return 0x80000103;
+    for (i = 0; i < count; i++)
+        Md5Digest(entries[i].data, entries[i].size, entries[i].digest);
+    return 0;
+}
+
+s32 sceKernelUtilsSha1DigestBatch(const SceKernelUtilsDigestEntry *entries, u32 count)
+{
+    u32 i;
+    if (entries == NULL)
+        return 0x80000103;
+    for (i = 0; i < count; i++)
+        Sha1Digest(entries[i].data, entries[i].size, entries[i].digest);
+    return 0;
+}
+
+#define MT19937_N 624
+#define MT19937_M 397
+
+/* Next state word from the current word 'u' and the one following it 'v' */
+#define MT19937_TWIST(u, v) (((((u) & 0x80000000) | ((v) & 0x7FFFFFFF)) >> 1) ^ (-((v) & 1) & 0x9908B0DF))
+
+#define MT19937_TEMPER(y) do { \
+    (y) ^= (y) >> 11; \
+    (y) ^= ((y) << 7) & 0x9D2C5680; \
+    (y) ^= ((y) << 15) & 0xEFC60000; \
+    (y) ^= (y) >> 18; \
+} while (0)
+
+/*
+ * Output 'count' words (or only advance the generator if 'out' is NULL), leaving the context in the same
+ * state as 'count' calls to mt19937UInt(): every state word is tempered for output, then replaced by its
+ * successor. The state is walked in three runs so the inner loops have no index wrapping.
+ */
+void Mt19937Generate(SceKernelUtilsMt19937Context *ctx, u32 *out, u32 count)
+{
+    u32 *mt = ctx->state;
+    u32 i = ctx->count;
+    if (i >= MT19937_N)
+        i = 0;
+    while (count != 0) {
+        u32 end;
+        if (i < MT19937_N - MT19937_M)
+            end = MT19937_N - MT19937_M;
+        else
+            end = MT19937_N - 1;
+        if (end - i > count)
+            end = i + count;
+        count -= end - i;
+        if (i < MT19937_N - MT19937_M) {
+            // words whose successor depends on the previous generation
+            for (; i < end; i++) {
+                u32 y = mt[i];
+                mt[i] = mt[i + MT19937_M] ^ MT19937_TWIST(y, mt[i + 1]);
+                if (out != NULL) {
+                    MT19937_TEMPER(y);
+                    *(out++) = y;
+                }
+            }
+        } else if (i < MT19937_N - 1) {
+            // words whose successor depends on the already regenerated ones
+            for (; i < end; i++) {
+                u32 y = mt[i];
+                mt[i] = mt[i + MT19937_M - MT19937_N] ^ MT19937_TWIST(y, mt[i + 1]);
+                if (out != NULL) {
+                    MT19937_TEMPER(y);
+                    *(out++) = y;
+                }
+            }
+        }
+        if (i == MT19937_N - 1 && count != 0) {
+            // the last word wraps around to the start of the state
+            u32 y = mt[MT19937_N - 1];
+            mt[MT19937_N - 1] = mt[MT19937_M - 1] ^ MT19937_TWIST(y, mt[0]);
+            if (out != NULL) {
+                MT19937_TEMPER(y);
+                *(out++) = y;
+            }
+            count--;
+            i = 0;
+        }
+    }
+    ctx->count = i;
+}
+
 int sceKernelUtilsMt19937Init(SceKernelUtilsMt19937Context *ctx, u32 seed)
 {
     int oldK1 = pspShiftK1();
@@ -374,11 +335,10 @@ int sceKernelUtilsMt19937Init(SceKernelUtilsMt19937Context *ctx, u32 seed)
     // F640
     int i;
     for (i = 1; i < 624; i++)
-        ctx->state[i] = (ctx->state[i - 1] ^ (ctx->state[i - 1] >> 30)) * 0x6C078965 + 1;
+        ctx->state[i] = (ctx->state[i - 1] ^ (ctx->state[i - 1] >> 30)) * 0x6C078965 + i;
     ctx->count = 0;
     // F678
-    for (i = 0; i < 624; i++)
-        sceKernelUtilsMt19937UInt(ctx);
+    Mt19937Generate(ctx, NULL, MT19937_N);
     pspSetK1(oldK1);
     return 0;
 }
@@ -395,6 +355,26 @@ u32 sceKernelUtilsMt19937UInt(SceKernelUtilsMt19937Context *ctx)
     return ret;
 }
 
+/*
+ * Fill 'buf' with 'count' random words. The sequence is the same as the one returned by 'count' calls to
+ * sceKernelUtilsMt19937UInt(), but the state is regenerated in whole runs instead of one word per call.
+ */
+s32 sceKernelUtilsMt19937Fill(SceKernelUtilsMt19937Context *ctx, u32 *buf, u32 count)
+{
+    s32 oldK1 = pspShiftK1();
+    if (count > 0x3FFFFFFF) {
+        pspSetK1(oldK1);
+        return 0x80000104;
+    }
+    if (!pspK1PtrOk(ctx) || !pspK1DynBufOk(buf, count * 4) || (buf == NULL && count != 0)) {
+        pspSetK1(oldK1);
+        return 0x800200D3;
+    }
+    Mt19937Generate(ctx, buf, count);
+    pspSetK1(oldK1);
+    return 0;
+}
+
 typedef int clock_t;
 typedef int time_t;
 
@@ -598,3 +578,154 @@ const char *sceKernelGzipGetComment(const void *buf)
     return comment;
 }
 
+/* States of a SceKernelGzipStream */
+#define GZIP_STATE_HEADER       0 // fixed header, 'count' bytes in 'buf'
+#define GZIP_STATE_EXTRALEN     1 // FEXTRA length, 'count' bytes in 'buf'
+#define GZIP_STATE_EXTRA        2 // FEXTRA data, 'count' bytes to skip
+#define GZIP_STATE_NAME         3 // FNAME
+#define GZIP_STATE_COMMENT      4 // FCOMMENT
+#define GZIP_STATE_HCRC         5 // FHCRC, 'count' bytes in 'buf'
+#define GZIP_STATE_DATA         6 // compressed data
+#define GZIP_STATE_TRAILER      7 // CRC32 and size, 'count' bytes in 'buf'
+#define GZIP_STATE_DONE         8
+
+/* CRC32 of the gzip format (polynomial 0xEDB88320), computed at the first stream initialization */
+u32 g_GzipCrcTable[256];
+
+void GzipInitCrcTable(void)
+{
+    u32 i, j;
+    if (g_GzipCrcTable[1] != 0)
+        return;
+    for (i = 0; i < 256; i++) {
+        u32 crc = i;
+        for (j = 0; j < 8; j++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        g_GzipCrcTable[i] = crc;
+    }
+}
+
+u32 GzipCrc32(u32 crc, const u8 *data, u32 size)
+{
+    crc = ~crc;
+    while (size-- != 0)
+        crc = g_GzipCrcTable[(crc ^ *(data++)) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+/* Adds input bytes to the stream buffer until it holds 'size' bytes, returns 1 once it does */
+s32 GzipCollect(SceKernelGzipStream *stream, const u8 **in, const u8 *end, u32 size)
+{
+    while (stream->count < size && *in != end)
+        stream->buf[stream->count++] = *((*in)++);
+    return stream->count == size;
+}
+
+s32 sceKernelGzipStreamInit(SceKernelGzipStream *stream, u8 *dest, u32 destSize)
+{
+    if (stream == NULL)
+        return 0x80000103;
+    s32 ret = sceKernelDeflateStreamInit(&stream->deflate, dest, destSize, 0);
+    if (ret < 0)
+        return ret;
+    GzipInitCrcTable();
+    stream->state = GZIP_STATE_HEADER;
+    stream->flags = 0;
+    stream->count = 0;
+    stream->crc32 = 0;
+    return 0;
+}
+
+s32 sceKernelGzipStreamFeed(SceKernelGzipStream *stream, const void *src, u32 size)
+{
+    const u8 *in = src;
+    const u8 *end = in + size;
+    for (;;) {
+        switch (stream->state) {
+        case GZIP_STATE_HEADER:
+            if (!GzipCollect(stream, &in, end, 10))
+                return 0;
+            if (stream->buf[0] != 0x1F || stream->buf[1] != 0x8B)
+                return 0x80000108;
+            if (stream->buf[2] != 8)
+                return 0x80000004;
+            stream->flags = stream->buf[3];
+            stream->count = 0;
+            stream->state = GZIP_STATE_EXTRALEN;
+            break;
+        case GZIP_STATE_EXTRALEN:
+            if ((stream->flags & 4) != 0) { // FEXTRA
+                if (!GzipCollect(stream, &in, end, 2))
+                    return 0;
+                stream->count = (stream->buf[1] << 8) | stream->buf[0];
+            }
+            stream->state = GZIP_STATE_EXTRA;
+            break;
+        case GZIP_STATE_EXTRA: {
+            u32 n = stream->count;
+            if ((u32)(end - in) < n)
+                n = end - in;
+            in += n;
+            stream->count -= n;
+            if (stream->count != 0)
+                return 0;
+            stream->state = GZIP_STATE_NAME;
+            break;
+        }
+        case GZIP_STATE_NAME:
+        case GZIP_STATE_COMMENT:
+            if ((stream->flags & (stream->state == GZIP_STATE_NAME ? 8 : 0x10)) != 0) { // FNAME, FCOMMENT
+                while (in != end && *in != '\0')
+                    in++;
+                if (in == end)
+                    return 0;
+                in++;
+            }
+            stream->state++;
+            break;
+        case GZIP_STATE_HCRC:
+            if ((stream->flags & 2) != 0 && !GzipCollect(stream, &in, end, 2)) // FHCRC
+                return 0;
+            stream->count = 0;
+            stream->state = GZIP_STATE_DATA;
+            break;
+        case GZIP_STATE_DATA: {
+            u32 start = stream->deflate.outPos;
+            u32 outSize;
+            stream->deflate.in = in;
+            stream->deflate.inSize = end - in;
+            s32 ret = sceKernelDeflateStreamDecompress(&stream->deflate, 0xFFFFFFFF, &outSize);
+            // The CRC32 is computed while the output is still in the data cache
+            stream->crc32 = GzipCrc32(stream->crc32, stream->deflate.window + start, outSize);
+            if (ret <= 0)
+                return ret;
+            in = stream->deflate.in;
+            stream->count = DeflateStreamGetRemainder(&stream->deflate, stream->buf, 8);
+            stream->state = GZIP_STATE_TRAILER;
+            break;
+        }
+        case GZIP_STATE_TRAILER: {
+            if (!GzipCollect(stream, &in, end, 8))
+                return 0;
+            u32 crc32 = stream->buf[0] | (stream->buf[1] << 8) | (stream->buf[2] << 16) | ((u32)stream->buf[3] << 24);
+            u32 inSize = stream->buf[4] | (stream->buf[5] << 8) | (stream->buf[6] << 16) | ((u32)stream->buf[7] << 24);
+            if (crc32 != stream->crc32 || inSize != stream->deflate.outPos)
+                return 0x80000108;
+            stream->state = GZIP_STATE_DONE;
+            break;
+        }
+        case GZIP_STATE_DONE:
+            // Anything following the file is ignored
+            return 1;
+        }
+    }
+}
+
+s32 sceKernelGzipStreamFinish(SceKernelGzipStream *stream, u32 *crc32)
+{
+    if (stream->state != GZIP_STATE_DONE)
+        return 0x80000108;
+    if (crc32 != NULL)
+        *crc32 = stream->crc32;
+    return stream->deflate.outPos;
+}
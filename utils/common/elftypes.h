@@ -139,6 +139,8 @@ typedef u32 Elf32_Word;
 #define SHT_HIUSER 0xffffffff
 
 #define SHT_PRXRELOC (SHT_LOPROC | 0xA0)
+/* Relocations grouped in runs of the same type and segments, see Elf32_RelRun */
+#define SHT_PRXRELOC_RUNS (SHT_LOPROC | 0xA2)
 
 // MIPS Reloc Entry Types
 #define R_MIPS_NONE     0
@@ -224,6 +226,16 @@ typedef struct {
 	Elf32_Word r_info; 
 } Elf32_Rel;
 
+/* Header of a run of relocations, followed by count offsets, or count (offset, addend) pairs for R_MIPS_HI16.
+ * psp-kprxgen outputs a single loadable segment, so r_ofs_base and r_addr_base are always 0 */
+typedef struct {
+	u8 r_type;
+	u8 r_ofs_base;
+	u8 r_addr_base;
+	u8 r_pad;
+	Elf32_Word r_count;
+} Elf32_RelRun;
+
 typedef struct { 
 	Elf32_Word st_name; 
 	Elf32_Addr st_value; 
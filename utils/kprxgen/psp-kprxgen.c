@@ -34,6 +34,7 @@
  * .data data
  * Section Headers
  * Relocation data
+ * Relocation runs (with -r)
  * Section Header String Table
  *
  * When stripping the sections remove anything which isn't an allocated section or a relocation section.
@@ -50,6 +51,7 @@ static int g_out_sects = 2;
 static int g_alloc_size = 0;
 static int g_mem_size = 0;
 static int g_reloc_size = 0;
+static int g_runs_size = 0;
 static int g_str_size = 1;
 
 /* Base addresses in the Elf */
@@ -57,14 +59,32 @@ static int g_phbase = 0;
 static int g_allocbase = 0;
 static int g_shbase = 0;
 static int g_relocbase = 0;
+static int g_runsbase = 0;
 static int g_shstrbase = 0;
 
 /* Specifies that the current usage is to the print the pspsdk path */
 static int g_verbose = 0;
 
+/* Output the relocations as runs too, in a SHT_PRXRELOC_RUNS section */
+static int g_reloc_runs = 0;
+static unsigned char *g_runs = NULL;
+
+/* Number of relocation types which can be output as runs (R_MIPS_NONE to R_MIPS_LO16) */
+#define RUN_TYPES (R_MIPS_LO16 + 1)
+
+/* Name of the relocation runs section */
+#define ELF_SH_RELOC_RUNS ".rel.runs"
+
+struct RunEntry
+{
+	unsigned int offset;
+	unsigned int addend;
+};
+
 static struct option arg_opts[] = 
 {
 	{"verbose", no_argument, NULL, 'v'},
+	{"reloc-runs", no_argument, NULL, 'r'},
 	{ NULL, 0, NULL, 0 }
 };
 
@@ -76,17 +96,19 @@ int process_args(int argc, char **argv)
 	g_outfile = NULL;
 	g_infile = NULL;
 
-	ch = getopt_long(argc, argv, "v", arg_opts, NULL);
+	ch = getopt_long(argc, argv, "vr", arg_opts, NULL);
 	while(ch != -1)
 	{
 		switch(ch)
 		{
 			case 'v' : g_verbose = 1;
 					   break;
+			case 'r' : g_reloc_runs = 1;
+					   break;
 			default  : break;
 		};
 
-		ch = getopt_long(argc, argv, "v", arg_opts, NULL);
+		ch = getopt_long(argc, argv, "vr", arg_opts, NULL);
 	}
 
 	argc -= optind;
@@ -110,9 +132,10 @@ int process_args(int argc, char **argv)
 
 void print_help(void)
 {
-	fprintf(stderr, "Usage: psp-prxgen [-v] infile.elf outfile.prx\n");
+	fprintf(stderr, "Usage: psp-prxgen [-v] [-r] infile.elf outfile.prx\n");
 	fprintf(stderr, "Options:\n");
 	fprintf(stderr, "-v, --verbose           : Verbose output\n");
+	fprintf(stderr, "-r, --reloc-runs        : Also output the relocations grouped by type, for faster loading\n");
 }
 
 unsigned char *load_file(const char *file)
@@ -523,6 +546,199 @@ void reindex_sections(void)
 	}
 }
 
+/* Read a word of the allocated sections */
+int read_alloc_word(unsigned int addr, unsigned int *word)
+{
+	int i;
+
+	for(i = 0; i < g_elfhead.iShnum; i++)
+	{
+		if((g_elfsections[i].blOutput) && (g_elfsections[i].iType == SHT_PROGBITS) && 
+				(addr >= g_elfsections[i].iAddr) && (addr + 4 <= g_elfsections[i].iAddr + g_elfsections[i].iSize))
+		{
+			*word = LW(*(unsigned int *) (g_elfsections[i].pData + (addr - g_elfsections[i].iAddr)));
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int compare_run_entries(const void *a, const void *b)
+{
+	const struct RunEntry *pA = (const struct RunEntry *) a;
+	const struct RunEntry *pB = (const struct RunEntry *) b;
+
+	if(pA->offset < pB->offset)
+	{
+		return -1;
+	}
+
+	return (pA->offset > pB->offset);
+}
+
+/* Group the relocations by type and sort them by offset. The R_MIPS_HI16 relocations get the full addend 
+ * made with their R_MIPS_LO16, so the loader doesn't have to pair them. Returns 0 if a relocation can't be 
+ * output as a run.
+ */
+int build_reloc_runs(void)
+{
+	struct RunEntry *pEntries[RUN_TYPES] = { NULL };
+	int iCounts[RUN_TYPES] = { 0 };
+	int iMax = 0;
+	int ret = 0;
+	int i;
+
+	for(i = 0; i < g_elfhead.iShnum; i++)
+	{
+		if((g_elfsections[i].blOutput) && 
+				((g_elfsections[i].iType == SHT_REL) || (g_elfsections[i].iType == SHT_PRXRELOC)))
+		{
+			iMax += g_elfsections[i].iSize / sizeof(Elf32_Rel);
+		}
+	}
+
+	for(i = 0; i < RUN_TYPES; i++)
+	{
+		pEntries[i] = (struct RunEntry *) malloc(sizeof(struct RunEntry) * (iMax + 1));
+		if(pEntries[i] == NULL)
+		{
+			fprintf(stderr, "Error, could not allocate memory for relocation runs\n");
+			goto end;
+		}
+	}
+
+	for(i = 0; i < g_elfhead.iShnum; i++)
+	{
+		if((g_elfsections[i].blOutput) && 
+				((g_elfsections[i].iType == SHT_REL) || (g_elfsections[i].iType == SHT_PRXRELOC)))
+		{
+			Elf32_Rel *rel;
+			int j, count;
+
+			rel = (Elf32_Rel *) g_elfsections[i].pData;
+			count = g_elfsections[i].iSize / sizeof(Elf32_Rel);
+			for(j = 0; j < count; j++)
+			{
+				unsigned int offset, type, word, lo_word;
+				struct RunEntry *pEntry;
+				int k;
+
+				offset = LW(rel[j].r_offset);
+				type = ELF32_R_TYPE(LW(rel[j].r_info));
+				if(type == R_MIPS_NONE)
+				{
+					continue;
+				}
+
+				if((type >= RUN_TYPES) || (type == R_MIPS_REL32))
+				{
+					fprintf(stderr, "Warning, relocation type %d can't be output as a run\n", type);
+					goto end;
+				}
+
+				if(!read_alloc_word(offset, &word))
+				{
+					fprintf(stderr, "Warning, relocation offset %08X is out of the allocated sections\n", offset);
+					goto end;
+				}
+
+				pEntry = &pEntries[type][iCounts[type]++];
+				pEntry->offset = offset;
+				pEntry->addend = 0;
+
+				if(type == R_MIPS_HI16)
+				{
+					/* Find the matching LO16, which can follow several HI16 */
+					for(k = j + 1; (k < count) && (ELF32_R_TYPE(LW(rel[k].r_info)) != R_MIPS_LO16); k++);
+
+					if((k == count) || !read_alloc_word(LW(rel[k].r_offset), &lo_word))
+					{
+						fprintf(stderr, "Warning, no matching LO16 relocation for the HI16 at %08X\n", offset);
+						goto end;
+					}
+
+					pEntry->addend = (word << 16) + (int) (short) (lo_word & 0xFFFF);
+				}
+			}
+		}
+	}
+
+	g_runs_size = 0;
+	for(i = 0; i < RUN_TYPES; i++)
+	{
+		if(iCounts[i] > 0)
+		{
+			g_runs_size += sizeof(Elf32_RelRun) + iCounts[i] * ((i == R_MIPS_HI16) ? 8 : 4);
+		}
+	}
+
+	g_runs = (unsigned char *) malloc(g_runs_size);
+	if(g_runs == NULL)
+	{
+		fprintf(stderr, "Error, could not allocate memory for relocation runs\n");
+		goto end;
+	}
+
+	{
+		unsigned char *pRun = g_runs;
+
+		for(i = 0; i < RUN_TYPES; i++)
+		{
+			Elf32_RelRun *run;
+			unsigned int *pWords;
+			int j;
+
+			if(iCounts[i] == 0)
+			{
+				continue;
+			}
+
+			qsort(pEntries[i], iCounts[i], sizeof(struct RunEntry), compare_run_entries);
+
+			/* There is a single loadable segment, and output_relocs() clears the segment indexes too */
+			run = (Elf32_RelRun *) pRun;
+			run->r_type = i;
+			run->r_ofs_base = 0;
+			run->r_addr_base = 0;
+			run->r_pad = 0;
+			SW(&run->r_count, iCounts[i]);
+
+			pWords = (unsigned int *) (run + 1);
+			for(j = 0; j < iCounts[i]; j++)
+			{
+				SW(pWords++, pEntries[i][j].offset);
+				if(i == R_MIPS_HI16)
+				{
+					SW(pWords++, pEntries[i][j].addend);
+				}
+			}
+
+			if(g_verbose)
+			{
+				fprintf(stderr, "Relocation run type %d, %d relocations\n", i, iCounts[i]);
+			}
+
+			pRun = (unsigned char *) pWords;
+		}
+	}
+
+	ret = 1;
+
+end:
+	for(i = 0; i < RUN_TYPES; i++)
+	{
+		free(pEntries[i]);
+	}
+
+	if(!ret)
+	{
+		g_runs_size = 0;
+	}
+
+	return ret;
+}
+
 /* Load an ELF file */
 int load_elf(const char *elf)
 {
@@ -553,6 +769,12 @@ int load_elf(const char *elf)
 
 		reindex_sections();
 
+		if(g_reloc_runs && !build_reloc_runs())
+		{
+			fprintf(stderr, "Warning, outputting the relocations without runs\n");
+			g_reloc_runs = 0;
+		}
+
 		ret = 1;
 	}
 	while(0);
@@ -623,6 +845,12 @@ int calculate_outsize(void)
 
 	alloc_size = (alloc_size + 3) & ~3;
 	mem_size = (mem_size + 3) & ~3;
+	if(g_reloc_runs)
+	{
+		str_size += strlen(ELF_SH_RELOC_RUNS) + 1;
+		out_sects++;
+	}
+
 	str_size = (str_size + 3) & ~3;
 	str_size += strlen(ELF_SH_STRTAB) + 1;
 
@@ -645,12 +873,13 @@ int calculate_outsize(void)
 	g_allocbase = (g_phbase + 2 * sizeof(Elf32_Phdr) + 0x3F) & ~0x3F;
 	g_shbase = g_allocbase + g_alloc_size;
 	g_relocbase = g_shbase + (g_out_sects * sizeof(Elf32_Shdr));
-	g_shstrbase = g_relocbase + g_reloc_size;
+	g_runsbase = g_relocbase + g_reloc_size;
+	g_shstrbase = g_runsbase + g_runs_size;
 
 	if(g_verbose)
 	{
 		fprintf(stderr, "PHBase %08X, AllocBase %08X, SHBase %08X\n", g_phbase, g_allocbase, g_shbase);
-		fprintf(stderr, "Relocbase %08X, Shstrbase %08X\n", g_relocbase, g_shstrbase);
+		fprintf(stderr, "Relocbase %08X, Runsbase %08X, Shstrbase %08X\n", g_relocbase, g_runsbase, g_shstrbase);
 		fprintf(stderr, "Total size %d\n", g_shstrbase + g_str_size);
 	}
 
@@ -717,9 +946,9 @@ void output_ph(unsigned char *data)
 
 	SW(&phdr->p_type,   0x700000A0);
 	SW(&phdr->p_offset, g_relocbase);
+	SW(&phdr->p_filesz, g_reloc_size);
 	SW(&phdr->p_vaddr,  0);
 	SW(&phdr->p_paddr,  0);
-	SW(&phdr->p_filesz, g_reloc_size);
 	SW(&phdr->p_memsz,  0);
 	SW(&phdr->p_flags,  0);
 	SW(&phdr->p_align,  0x10);
@@ -796,6 +1025,23 @@ void output_sh(unsigned char *data)
 		}
 	}
 
+	/* The runs get their own section, the loaders not knowing them use the program header */
+	if(g_reloc_runs)
+	{
+		SW(&shdr->sh_name, str_ofs);
+		str_ofs += strlen(ELF_SH_RELOC_RUNS) + 1;
+		SW(&shdr->sh_flags, 0);
+		SW(&shdr->sh_addr, 0);
+		SW(&shdr->sh_size, g_runs_size);
+		SW(&shdr->sh_link, 0);
+		SW(&shdr->sh_addralign, 4);
+		SW(&shdr->sh_entsize, 0);
+		SW(&shdr->sh_type, SHT_PRXRELOC_RUNS);
+		SW(&shdr->sh_info, 0);
+		SW(&shdr->sh_offset, g_runsbase);
+		shdr++;
+	}
+
 	/* Fill in the shstrtab section */
 	SW(&shdr->sh_name, str_ofs);
 	SW(&shdr->sh_flags, 0);
@@ -868,6 +1114,12 @@ void output_shstrtab(unsigned char *data)
 		}
 	}
 
+	if(g_reloc_runs)
+	{
+		strcpy(pData, ELF_SH_RELOC_RUNS);
+		pData += strlen(ELF_SH_RELOC_RUNS) + 1;
+	}
+
 	strcpy(pData, ELF_SH_STRTAB);
 }
 
@@ -895,6 +1147,10 @@ int output_prx(const char *prxfile)
 		output_alloc(data + g_allocbase);
 		output_sh(data + g_shbase);
 		output_relocs(data + g_relocbase);
+		if(g_reloc_runs)
+		{
+			memcpy(data + g_runsbase, g_runs, g_runs_size);
+		}
 		output_shstrtab(data + g_shstrbase);
 
 		fp = fopen(prxfile, "wb");
@@ -929,6 +1185,12 @@ void free_data(void)
 		free(g_elfsections);
 		g_elfsections = NULL;
 	}
+
+	if(g_runs != NULL)
+	{
+		free(g_runs);
+		g_runs = NULL;
+	}
 }
 
 int main(int argc, char **argv)
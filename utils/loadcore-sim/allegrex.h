@@ -0,0 +1,233 @@
+/* Copyright (C) 2011, 2012 The uOFW team
+   See the file COPYING for copying permission.
+*/
+
+/*
+ * Included before every kernel source file: common_imp.h is included with the
+ * Allegrex inline functions renamed, and C equivalents working on the simulated
+ * processor state take their names.
+ */
+
+#ifndef ALLEGREX_H
+#define ALLEGREX_H
+
+#define pspCop0StateGet     allegrex_pspCop0StateGet
+#define pspCop0StateSet     allegrex_pspCop0StateSet
+#define pspCop0CtrlGet      allegrex_pspCop0CtrlGet
+#define pspCop0CtrlSet      allegrex_pspCop0CtrlSet
+#define pspMax              allegrex_pspMax
+#define pspMin              allegrex_pspMin
+#define pspSync             allegrex_pspSync
+#define pspCache            allegrex_pspCache
+#define pspBreak            allegrex_pspBreak
+#define pspHalt             allegrex_pspHalt
+#define pspMfic             allegrex_pspMfic
+#define pspLl               allegrex_pspLl
+#define pspSc               allegrex_pspSc
+#define pspWsbw             allegrex_pspWsbw
+#define pspGetK0            allegrex_pspGetK0
+#define pspGetK1            allegrex_pspGetK1
+#define pspSetK1            allegrex_pspSetK1
+#define pspShiftK1          allegrex_pspShiftK1
+#define pspK1PtrOk          allegrex_pspK1PtrOk
+#define pspK1DynBufOk       allegrex_pspK1DynBufOk
+#define pspK1StaBufOk       allegrex_pspK1StaBufOk
+#define pspK1IsUserMode     allegrex_pspK1IsUserMode
+#define pspGetGp            allegrex_pspGetGp
+#define pspSetGp            allegrex_pspSetGp
+#define pspGetSp            allegrex_pspGetSp
+#define pspSetSp            allegrex_pspSetSp
+#define pspGetRa            allegrex_pspGetRa
+
+#include "../../include/common_imp.h"
+
+#undef pspCop0StateGet
+#undef pspCop0StateSet
+#undef pspCop0CtrlGet
+#undef pspCop0CtrlSet
+#undef pspMax
+#undef pspMin
+#undef pspSync
+#undef pspCache
+#undef pspBreak
+#undef pspHalt
+#undef pspMfic
+#undef pspLl
+#undef pspSc
+#undef pspWsbw
+#undef pspGetK0
+#undef pspGetK1
+#undef pspSetK1
+#undef pspShiftK1
+#undef pspK1PtrOk
+#undef pspK1DynBufOk
+#undef pspK1StaBufOk
+#undef pspK1IsUserMode
+#undef pspGetGp
+#undef pspSetGp
+#undef pspGetSp
+#undef pspSetSp
+#undef pspGetRa
+
+/* The module information needs MIPS assembler directives, a host build has no use for it */
+#undef SCE_MODULE_INFO
+#define SCE_MODULE_INFO(name, attributes, majorVersion, minorVersion) \
+    extern const SceModuleInfo module_info
+
+/* Simulated processor state, see sim.c */
+extern s32 g_simCop0State[32];
+extern s32 g_simCop0Ctrl[32];
+extern s32 g_simK0;
+extern s32 g_simK1;
+extern s32 g_simGp;
+
+u32 SimCycles(void);
+void SimBreak(s32 code);
+
+static inline int pspCop0StateGet(int reg)
+{
+    if (reg == COP0_STATE_COUNT)
+        return SimCycles();
+    return g_simCop0State[reg];
+}
+
+static inline void pspCop0StateSet(int reg, int val)
+{
+    g_simCop0State[reg] = val;
+}
+
+static inline int pspCop0CtrlGet(int reg)
+{
+    return g_simCop0Ctrl[reg];
+}
+
+static inline void pspCop0CtrlSet(int reg, int val)
+{
+    g_simCop0Ctrl[reg] = val;
+}
+
+static inline s32 pspMax(s32 a, s32 b)
+{
+    return (a > b) ? a : b;
+}
+
+static inline s32 pspMin(s32 a, s32 b)
+{
+    return (a < b) ? a : b;
+}
+
+static inline void pspSync(void)
+{
+}
+
+/*
+ * The data cache is not simulated, except the "create dirty exclusive" operation (0x18): it gives the
+ * line to the caller without loading it from the memory, so its previous bytes are lost.
+ */
+static inline void pspCache(char op, const void *ptr)
+{
+    if (op == 0x18)
+        __builtin_memset((void *)((u32)ptr & 0xFFFFFFC0), 0xCC, 64);
+}
+
+static inline void pspBreak(s32 op)
+{
+    SimBreak(op);
+}
+
+static inline void pspHalt(void)
+{
+    SimBreak(-1);
+}
+
+static inline s32 pspMfic(void)
+{
+    return 0;
+}
+
+static inline s32 pspLl(s32 *ptr)
+{
+    return *ptr;
+}
+
+static inline s32 pspSc(s32 value, s32 *ptr)
+{
+    *ptr = value;
+    return 1;
+}
+
+static inline u32 pspWsbw(u32 value)
+{
+    return __builtin_bswap32(value);
+}
+
+static inline int pspGetK0(void)
+{
+    return g_simK0;
+}
+
+static inline int pspGetK1(void)
+{
+    return g_simK1;
+}
+
+static inline void pspSetK1(int k1)
+{
+    g_simK1 = k1;
+}
+
+static inline int pspShiftK1(void)
+{
+    int oldK1 = g_simK1;
+    g_simK1 = oldK1 << 11;
+    return oldK1;
+}
+
+static inline int pspK1PtrOk(const void *ptr)
+{
+    return (((int)ptr & g_simK1) >= 0);
+}
+
+static inline int pspK1DynBufOk(const void *ptr, int size)
+{
+    return (((((int)ptr + size) | (int)ptr | size) & g_simK1) >= 0);
+}
+
+static inline int pspK1StaBufOk(const void *ptr, int size)
+{
+    return (((((int)ptr + size) | (int)ptr) & g_simK1) >= 0);
+}
+
+static inline int pspK1IsUserMode(void)
+{
+    return ((g_simK1 >> 31) != 0);
+}
+
+static inline int pspGetGp(void)
+{
+    return g_simGp;
+}
+
+static inline int pspSetGp(int gp)
+{
+    int oldGp = g_simGp;
+    g_simGp = gp;
+    return oldGp;
+}
+
+static inline int pspGetSp(void)
+{
+    return (int)__builtin_frame_address(0);
+}
+
+static inline void pspSetSp(int sp)
+{
+    (void)sp;
+}
+
+static inline int pspGetRa(void)
+{
+    return (int)__builtin_return_address(0);
+}
+
+#endif
@@ -0,0 +1,100 @@
+/* Copyright (C) 2011, 2012 The uOFW team
+   See the file COPYING for copying permission.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "host.h"
+
+void HostMapMemory(unsigned int addr, unsigned int size)
+{
+	void *mem;
+
+	mem = mmap((void *) addr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	if(mem != (void *) addr)
+	{
+		fprintf(stderr, "Error, could not map the simulated memory at %08X\n", addr);
+		exit(1);
+	}
+}
+
+void *HostReadFile(const char *path, unsigned int *size)
+{
+	FILE *fp;
+	void *data = NULL;
+	long len;
+
+	fp = fopen(path, "rb");
+	if(fp == NULL)
+	{
+		fprintf(stderr, "Error, could not open %s\n", path);
+		return NULL;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	if(len > 0)
+	{
+		data = malloc(len);
+	}
+
+	if(data == NULL)
+	{
+		fprintf(stderr, "Error, could not allocate %ld bytes for %s\n", len, path);
+	}
+	else if(fread(data, 1, len, fp) != (size_t) len)
+	{
+		fprintf(stderr, "Error, could not read %s\n", path);
+		free(data);
+		data = NULL;
+	}
+	else
+	{
+		*size = len;
+	}
+
+	fclose(fp);
+
+	return data;
+}
+
+unsigned long long HostTimeNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void HostVprintf(const char *fmt, va_list ap)
+{
+	vfprintf(stdout, fmt, ap);
+}
+
+void HostVprintfErr(const char *fmt, va_list ap)
+{
+	vfprintf(stderr, fmt, ap);
+}
+
+void HostExit(int status)
+{
+	fflush(stdout);
+	exit(status);
+}
+
+void HostMemmove(void *dst, const void *src, unsigned int size)
+{
+	memmove(dst, src, size);
+}
+
+void HostMemset(void *dst, int c, unsigned int size)
+{
+	memset(dst, c, size);
+}
@@ -0,0 +1,29 @@
+/* Copyright (C) 2011, 2012 The uOFW team
+   See the file COPYING for copying permission.
+
+   Host services used by the simulator. They are kept apart from the kernel
+   sources, which can't include the C library headers.
+*/
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdarg.h>
+
+/* Maps size bytes of zeroed memory at addr, exits on failure */
+void HostMapMemory(unsigned int addr, unsigned int size);
+
+/* Reads a whole file into an allocated buffer, returns NULL on failure */
+void *HostReadFile(const char *path, unsigned int *size);
+
+/* Monotonic time in nanoseconds */
+unsigned long long HostTimeNs(void);
+
+/* Prints to the standard output, and to the standard error for the kernel messages */
+void HostVprintf(const char *fmt, va_list ap);
+void HostVprintfErr(const char *fmt, va_list ap);
+void HostExit(int status);
+void HostMemmove(void *dst, const void *src, unsigned int size);
+void HostMemset(void *dst, int c, unsigned int size);
+
+#endif
@@ -0,0 +1,287 @@
+/* Copyright (C) 2011, 2012 The uOFW team
+   See the file COPYING for copying permission.
+*/
+
+/*
+ * uofw/utils/loadcore-sim/psp-loadcore-sim.c
+ *
+ * Loads modules with Loadcore in the simulated memory, the way SysBoot() loads
+ * the boot modules, and prints how long each step took:
+ *    check:    sceKernelCheckExecFile()
+ *    probe:    sceKernelProbeExecutableObject()
+ *    load:     allocating the module memory and sceKernelLoadExecutableObject(),
+ *              which copies the segments and relocates them
+ *    register: registering the resident libraries of the module
+ *    link:     linking the stub libraries of the module
+ *    module:   creating and registering the module object
+ *
+ * The modules are loaded in the order given, so that a module can import the
+ * libraries of the modules before it. Every run starts again from an empty
+ * memory, and the times printed are the mean of the runs.
+ */
+
+#include <loadcore.h>
+#include <sysmem_kdebug.h>
+
+#include "loadcore_int.h"
+#include "module.h"
+
+#include "host.h"
+#include "sim.h"
+
+#define SIM_MAX_MODULES     (256)
+
+enum SimPhase {
+    SIM_PHASE_CHECK,
+    SIM_PHASE_PROBE,
+    SIM_PHASE_LOAD,
+    SIM_PHASE_REGISTER,
+    SIM_PHASE_LINK,
+    SIM_PHASE_MODULE,
+    SIM_PHASE_COUNT
+};
+
+static const char *g_phaseNames[SIM_PHASE_COUNT] = {
+    "check", "probe", "load", "register", "link", "module"
+};
+
+typedef struct {
+    const char *path;
+    u8 *file; /* The file, in host memory */
+    u32 size;
+    char name[SCE_MODULE_NAME_LEN + 1];
+    u64 time[SIM_PHASE_COUNT]; /* The total time of each phase, in ns */
+} SimModule;
+
+static SimModule g_modules[SIM_MAX_MODULES];
+static u32 g_numModules;
+static u32 g_verbose;
+
+static u32 ParseNumber(const char *str)
+{
+    u32 n = 0;
+    if (*str == '\0')
+        return 0;
+    for (; *str >= '0' && *str <= '9'; str++)
+        n = n * 10 + *str - '0';
+    return (*str == '\0') ? n : 0;
+}
+
+static void Usage(void)
+{
+    SimPrintf("Usage: psp-loadcore-sim [-n runs] [-v] module.prx...\n");
+    SimPrintf("Loads the modules in the simulated memory and prints the time of each loading step.\n");
+    SimPrintf("  -n runs   Number of times the modules are loaded (default 100)\n");
+    SimPrintf("  -v        Prints the modules layout after the first run\n");
+    HostExit(1);
+}
+
+static void PrintModule(SimModule *simMod, SceLoadCoreExecFileInfo *execInfo, SceModule *mod)
+{
+    u32 i;
+
+    SimPrintf("%s: %s, %s module at 0x%08X, entry 0x%08X\n", simMod->path, simMod->name,
+              execInfo->isKernelMod ? "kernel" : "user", (u32)execInfo->topAddr, execInfo->entryAddr);
+    for (i = 0; i < execInfo->numSegments; i++)
+        SimPrintf("    segment %u: 0x%08X, 0x%X bytes\n", i, execInfo->segmentAddr[i], execInfo->segmentSize[i]);
+    SimPrintf("    text 0x%X, data 0x%X, bss 0x%X bytes, exports 0x%X, imports 0x%X bytes, module UID 0x%08X\n",
+              execInfo->textSize, execInfo->dataSize, execInfo->bssSize, execInfo->exportsSize,
+              execInfo->importsSize, mod->modId);
+}
+
+/* Loads a module as SysBoot() and sceKernelLoadModuleBootLoadCore() do, adding the time of each step. */
+static void LoadModule(SimModule *simMod, u32 print)
+{
+    SceLoadCoreExecFileInfo execInfo;
+    SceResidentLibraryEntryTable *curExportTable;
+    SceResidentLibraryEntryTable *exportsEnd;
+    SceModuleInfo *modInfo;
+    SceModule *mod;
+    SceUID memId;
+    u64 times[SIM_PHASE_COUNT + 1];
+    u8 *buf;
+    s32 mpid;
+    s32 status;
+    u32 i;
+
+    buf = SimAllocBuffer(simMod->size);
+    if (buf == NULL) {
+        Kprintf("%s: cannot allocate the module buffer\n", simMod->path);
+        HostExit(1);
+    }
+    sceKernelMemmove(buf, simMod->file, simMod->size);
+
+    for (i = 0; i < sizeof execInfo / sizeof(u32); i++)
+        ((u32 *)&execInfo)[i] = 0;
+    execInfo.apiType = 0x50;
+    execInfo.isSignChecked = SCE_TRUE;
+    execInfo.topAddr = NULL;
+
+    times[SIM_PHASE_CHECK] = HostTimeNs();
+    status = sceKernelCheckExecFile(buf, &execInfo);
+    if (status < SCE_ERROR_OK) {
+        Kprintf("%s: sceKernelCheckExecFile failed, 0x%08X\n", simMod->path, status);
+        HostExit(1);
+    }
+
+    /*
+     * The files are the plain PRX files output by the build, not signed: load them as
+     * decrypted modules, with the privilege level of their module information.
+     */
+    execInfo.isDecrypted = SCE_TRUE;
+
+    times[SIM_PHASE_PROBE] = HostTimeNs();
+    status = sceKernelProbeExecutableObject(buf, &execInfo);
+    if (status < SCE_ERROR_OK) {
+        Kprintf("%s: sceKernelProbeExecutableObject failed, 0x%08X\n", simMod->path, status);
+        HostExit(1);
+    }
+    modInfo = (SceModuleInfo *)execInfo.moduleInfoOffset;
+    execInfo.modInfoAttribute |= modInfo->modAttribute & SCE_PRIVILEGED_MODULES;
+    execInfo.isKernelMod = ((execInfo.modInfoAttribute & SCE_PRIVILEGED_MODULES) == SCE_MODULE_KERNEL);
+
+    times[SIM_PHASE_LOAD] = HostTimeNs();
+    if (execInfo.isKernelMod)
+        mpid = SCE_KERNEL_PRIMARY_KERNEL_PARTITION;
+    else
+        mpid = SCE_KERNEL_PRIMARY_USER_PARTITION;
+    memId = sceKernelAllocPartitionMemory(mpid, "SceLoadCoreSimModule", SCE_KERNEL_SMEM_Low,
+                                          execInfo.largestSegSize, 0);
+    if (memId < 0) {
+        Kprintf("%s: cannot allocate the module memory, 0x%08X\n", simMod->path, memId);
+        HostExit(1);
+    }
+    execInfo.topAddr = sceKernelGetBlockHeadAddr(memId);
+    status = sceKernelLoadExecutableObject(buf, &execInfo);
+    if (status < SCE_ERROR_OK) {
+        Kprintf("%s: sceKernelLoadExecutableObject failed, 0x%08X\n", simMod->path, status);
+        HostExit(1);
+    }
+
+    times[SIM_PHASE_REGISTER] = HostTimeNs();
+    exportsEnd = execInfo.exportsInfo + (execInfo.exportsSize & ~0x3);
+    for (curExportTable = execInfo.exportsInfo; curExportTable < exportsEnd;
+       curExportTable = (void *)curExportTable + curExportTable->len * sizeof(u32)) {
+         if (curExportTable->attribute & SCE_LIB_AUTO_EXPORT) {
+             status = sceKernelRegisterLibrary(curExportTable);
+             if (status < SCE_ERROR_OK) {
+                 Kprintf("%s: sceKernelRegisterLibrary failed, 0x%08X\n", simMod->path, status);
+                 HostExit(1);
+             }
+         }
+    }
+
+    times[SIM_PHASE_LINK] = HostTimeNs();
+    if ((s32)execInfo.importsInfo != LOADCORE_ERROR) {
+        status = sceKernelLinkLibraryEntries(execInfo.importsInfo, execInfo.importsSize);
+        if (status < SCE_ERROR_OK) {
+            Kprintf("%s: sceKernelLinkLibraryEntries failed, 0x%08X\n", simMod->path, status);
+            HostExit(1);
+        }
+    }
+
+    times[SIM_PHASE_MODULE] = HostTimeNs();
+    mod = sceKernelCreateAssignModule(&execInfo);
+    if (mod == NULL) {
+        Kprintf("%s: sceKernelCreateAssignModule failed\n", simMod->path);
+        HostExit(1);
+    }
+    mod->memId = memId;
+    sceKernelRegisterModule(mod);
+
+    times[SIM_PHASE_COUNT] = HostTimeNs();
+    for (i = 0; i < SIM_PHASE_COUNT; i++)
+        simMod->time[i] += times[i + 1] - times[i];
+
+    if (simMod->name[0] == '\0') {
+        for (i = 0; i < SCE_MODULE_NAME_LEN && mod->modName[i] != '\0'; i++)
+            simMod->name[i] = mod->modName[i];
+        simMod->name[i] = '\0';
+    }
+    if (print)
+        PrintModule(simMod, &execInfo, mod);
+}
+
+static void PrintTimes(u32 runs)
+{
+    u64 total[SIM_PHASE_COUNT + 1];
+    u64 modTotal;
+    u32 i, j;
+
+    SimPrintf("\nMean time of %u runs, in microseconds:\n", runs);
+    SimPrintf("%-28s", "module");
+    for (i = 0; i < SIM_PHASE_COUNT; i++)
+        SimPrintf(" %9s", g_phaseNames[i]);
+    SimPrintf(" %9s\n", "total");
+
+    for (i = 0; i <= SIM_PHASE_COUNT; i++)
+        total[i] = 0;
+    for (j = 0; j < g_numModules; j++) {
+        modTotal = 0;
+        SimPrintf("%-28s", g_modules[j].name);
+        for (i = 0; i < SIM_PHASE_COUNT; i++) {
+            SimPrintf(" %9.1f", (double)g_modules[j].time[i] / runs / 1000);
+            modTotal += g_modules[j].time[i];
+            total[i] += g_modules[j].time[i];
+        }
+        SimPrintf(" %9.1f\n", (double)modTotal / runs / 1000);
+        total[SIM_PHASE_COUNT] += modTotal;
+    }
+    SimPrintf("%-28s", "all");
+    for (i = 0; i <= SIM_PHASE_COUNT; i++)
+        SimPrintf(" %9.1f", (double)total[i] / runs / 1000);
+    SimPrintf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    u32 runs = 100;
+    u32 run;
+    s32 i;
+
+    for (i = 1; i < argc; i++) {
+        if (argv[i][0] != '-') {
+            if (g_numModules == SIM_MAX_MODULES) {
+                Kprintf("Too many modules, %d at most\n", SIM_MAX_MODULES);
+                HostExit(1);
+            }
+            g_modules[g_numModules++].path = argv[i];
+        }
+        else if (argv[i][1] == 'n' && argv[i][2] == '\0' && i + 1 < argc) {
+            runs = ParseNumber(argv[++i]);
+            if (runs == 0)
+                Usage();
+        }
+        else if (argv[i][1] == 'v' && argv[i][2] == '\0')
+            g_verbose = 1;
+        else
+            Usage();
+    }
+    if (g_numModules == 0)
+        Usage();
+
+    for (i = 0; i < (s32)g_numModules; i++) {
+        g_modules[i].file = HostReadFile(g_modules[i].path, &g_modules[i].size);
+        if (g_modules[i].file == NULL)
+            HostExit(1);
+    }
+
+    SimInit();
+    for (run = 0; run < runs; run++) {
+        SimReset();
+        for (i = 0; i < (s32)g_numModules; i++)
+            LoadModule(&g_modules[i], g_verbose && run == 0);
+
+        if (g_verbose && run == 0) {
+            SimPrintf("%u libraries registered, %u lookups comparing %u libraries, longest hash chain %u\n",
+                      g_loadCore.regLibCount, g_loadCore.libLookups, g_loadCore.libProbes,
+                      g_loadCore.maxLibChainLength);
+            SimPrintf("Kernel partition: 0x%X bytes used, user partition: 0x%X bytes used\n",
+                      SimPartitionUsedSize(SCE_KERNEL_PRIMARY_KERNEL_PARTITION),
+                      SimPartitionUsedSize(SCE_KERNEL_PRIMARY_USER_PARTITION));
+        }
+    }
+    PrintTimes(runs);
+
+    return 0;
+}
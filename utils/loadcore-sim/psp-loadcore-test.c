@@ -0,0 +1,713 @@
+/* Copyright (C) 2011, 2012 The uOFW team
+   See the file COPYING for copying permission.
+*/
+
+/*
+ * uofw/utils/loadcore-sim/psp-loadcore-test.c
+ *
+ * Checks Loadcore on small modules built in memory. Each test builds the PRX
+ * files it needs, the way psp-kprxgen outputs them, loads them in the
+ * simulated memory and checks what Loadcore made of them.
+ *
+ * A test module has a single loadable segment. The file holds the ELF header,
+ * the PT_LOAD and PT_PRX_RELOC program headers, the segment, its relocations
+ * and the section headers, in this order. Without the PT_PRX_RELOC program
+ * header, the loader finds the relocations with their section. The modules
+ * built with relocation runs also have them as psp-kprxgen -r outputs them,
+ * in a section following the relocations.
+ */
+
+#include <loadcore.h>
+#include <sysmem_kdebug.h>
+#include <sysmem_kernel.h>
+
+#include "clibUtils.h"
+#include "elf.h"
+#include "loadcore_int.h"
+#include "module.h"
+
+#include "host.h"
+#include "sim.h"
+
+#define TEST_SEGMENT_SIZE       (0x400)
+#define TEST_MAX_RELOCS         (64)
+#define TEST_FILE_SIZE          (0x1000)
+#define TEST_NUM_SECTIONS       (5)
+
+/* Offset of the segment in the file, after the ELF header and the program headers */
+#define TEST_SEGMENT_OFFSET     (0x80)
+
+#define TEST_ASSERT(cond) do { \
+    if (!(cond)) { \
+        SimPrintf("    line %d: %s\n", __LINE__, #cond); \
+        return -1; \
+    } \
+} while (0)
+
+#define TEST_ASSERT_OK(status) do { \
+    s32 _status = (status); \
+    if (_status < SCE_ERROR_OK) { \
+        SimPrintf("    line %d: %s returned 0x%08X\n", __LINE__, #status, _status); \
+        return -1; \
+    } \
+} while (0)
+
+typedef struct {
+    const char *name;
+    u32 isKernelMod;
+    u32 relocHeader; /* The relocations have a PT_PRX_RELOC program header */
+    u8 segment[TEST_SEGMENT_SIZE];
+    u32 size; /* Size used in the segment */
+    u32 bssSize;
+    Elf32_Rel relocs[TEST_MAX_RELOCS];
+    u32 numRelocs;
+    u32 relocRuns; /* The relocations are also output as runs */
+    u32 runs[TEST_MAX_RELOCS + 6];
+    u32 entTop, entEnd;
+    u32 stubTop, stubEnd;
+    u32 modInfo; /* Offset of the module information in the segment, set by TestBuild() */
+    u8 file[TEST_FILE_SIZE];
+    u32 fileSize;
+    u8 *buf; /* The file, copied to the simulated memory */
+} TestModule;
+
+typedef struct {
+    const char *name;
+    s32 (*func)(void);
+} Test;
+
+static void TestNew(TestModule *mod, const char *name, u32 isKernelMod)
+{
+    sceKernelMemset(mod, 0, sizeof *mod);
+    mod->name = name;
+    mod->isKernelMod = isKernelMod;
+    mod->relocHeader = SCE_TRUE;
+}
+
+/* Adds data to the segment, 4-byte aligned, and returns its offset. */
+static u32 TestAdd(TestModule *mod, const void *data, u32 size)
+{
+    u32 offset = (mod->size + 3) & ~3;
+
+    if (offset + size > TEST_SEGMENT_SIZE) {
+        Kprintf("%s: the test segment is full\n", mod->name);
+        HostExit(1);
+    }
+    sceKernelMemmove(mod->segment + offset, (void *)data, size);
+    mod->size = offset + size;
+    return offset;
+}
+
+static u32 TestWord(TestModule *mod, u32 word)
+{
+    return TestAdd(mod, &word, sizeof word);
+}
+
+/* Adds a relocation of the segment, relative to the segment. */
+static void TestReloc(TestModule *mod, u32 offset, u32 type)
+{
+    if (mod->numRelocs == TEST_MAX_RELOCS) {
+        Kprintf("%s: too many relocations\n", mod->name);
+        HostExit(1);
+    }
+    mod->relocs[mod->numRelocs].r_offset = offset;
+    mod->relocs[mod->numRelocs].r_info = ELF32_R_INFO(0, type);
+    mod->numRelocs++;
+}
+
+/* Adds a string to the segment and returns its offset. */
+static u32 TestString(TestModule *mod, const char *str)
+{
+    return TestAdd(mod, str, strlen(str) + 1);
+}
+
+/*
+ * Adds a resident library exporting functions, as the .lib.ent section of a module. A module exports
+ * a single library. The functions are jr $ra / nop pairs; the offset of the first one is returned.
+ */
+static u32 TestExport(TestModule *mod, const char *libName, const u32 *nids, u32 numNids)
+{
+    u32 name, funcs, entryTable, entry;
+    u32 i;
+
+    name = TestString(mod, libName);
+    funcs = mod->size;
+    for (i = 0; i < numNids; i++) {
+        TestWord(mod, 0x03E00008); /* jr $ra */
+        TestWord(mod, 0); /* nop */
+    }
+    entryTable = TestAdd(mod, nids, numNids * sizeof(u32));
+    for (i = 0; i < numNids; i++)
+        TestReloc(mod, TestWord(mod, funcs + i * 8), R_MIPS_32);
+
+    entry = TestWord(mod, name);
+    TestReloc(mod, entry, R_MIPS_32);
+    /* aLinkLibEntries() doesn't link stubs to SCE_LIB_AUTO_EXPORT libraries. */
+    TestWord(mod, (SCE_LIB_NO_SPECIAL_ATTR << 16) | 0x0011); /* version 1.17 */
+    TestWord(mod, (numNids << 16) | LIBRARY_ENTRY_TABLE_OLD_LEN);
+    TestReloc(mod, TestWord(mod, entryTable), R_MIPS_32);
+
+    mod->entTop = entry;
+    mod->entEnd = mod->size;
+    return funcs;
+}
+
+/*
+ * Adds a stub library importing functions, as the .lib.stub section of a module. A module imports
+ * a single library. Returns the offset of the stubs, one jr $ra / nop pair per function.
+ */
+static u32 TestImport(TestModule *mod, const char *libName, const u32 *nids, u32 numNids)
+{
+    u32 name, nidTable, stubTable, entry;
+    u32 i;
+
+    name = TestString(mod, libName);
+    nidTable = TestAdd(mod, nids, numNids * sizeof(u32));
+    stubTable = mod->size;
+    for (i = 0; i < numNids; i++) {
+        TestWord(mod, 0x03E00008); /* jr $ra */
+        TestWord(mod, 0); /* nop */
+    }
+
+    entry = TestWord(mod, name);
+    TestReloc(mod, entry, R_MIPS_32);
+    TestWord(mod, (SCE_LIB_NO_SPECIAL_ATTR << 16) | 0x0011); /* version 1.17 */
+    TestWord(mod, (numNids << 16) | STUB_LIBRARY_ENTRY_TABLE_OLD_LEN);
+    TestReloc(mod, TestWord(mod, nidTable), R_MIPS_32);
+    TestReloc(mod, TestWord(mod, stubTable), R_MIPS_32);
+    TestWord(mod, 0); /* No variable stubs */
+
+    mod->stubTop = entry;
+    mod->stubEnd = mod->size;
+    return stubTable;
+}
+
+/*
+ * Outputs the relocations as runs, one per relocation type, and returns their size. The R_MIPS_HI16
+ * relocations, whose runs need the addend of their R_MIPS_LO16, aren't supported.
+ */
+static u32 TestBuildRuns(TestModule *mod)
+{
+    static const u32 types[] = { R_MIPS_32, R_MIPS_26, R_MIPS_LO16 };
+    Elf32_RelRun *run;
+    u32 numWords;
+    u32 i, j;
+
+    numWords = 0;
+    for (i = 0; i < sizeof types / sizeof types[0]; i++) {
+        run = (Elf32_RelRun *)&mod->runs[numWords];
+        sceKernelMemset(run, 0, sizeof *run);
+        run->r_type = types[i];
+        numWords += sizeof *run / sizeof(u32);
+        for (j = 0; j < mod->numRelocs; j++) {
+            if (ELF32_R_TYPE(mod->relocs[j].r_info) == types[i]) {
+                mod->runs[numWords++] = mod->relocs[j].r_offset;
+                run->r_count++;
+            }
+        }
+        if (run->r_count == 0)
+            numWords -= sizeof *run / sizeof(u32);
+    }
+    for (j = 0; j < mod->numRelocs; j++) {
+        if (ELF32_R_TYPE(mod->relocs[j].r_info) == R_MIPS_HI16) {
+            Kprintf("%s: no R_MIPS_HI16 relocations with runs\n", mod->name);
+            HostExit(1);
+        }
+    }
+    return numWords * sizeof(u32);
+}
+
+/* Returns a section header of the built file. */
+static Elf32_Shdr *TestSection(TestModule *mod, u32 index)
+{
+    return (Elf32_Shdr *)(mod->file + ((Elf32_Ehdr *)mod->file)->e_shoff) + index;
+}
+
+/* Builds the PRX file of the module, ending its segment with the module information. */
+static void TestBuild(TestModule *mod)
+{
+    static const char sectionNames[] = "\0.text\0.rel.text\0.shstrtab\0.rel.runs";
+    SceModuleInfo modInfo;
+    Elf32_Ehdr *elfHeader;
+    Elf32_Phdr *progHeader;
+    Elf32_Shdr *sectHeader;
+    u32 relocOffset;
+    u32 runsOffset, runsSize;
+    u32 namesOffset;
+    u32 shOffset;
+
+    sceKernelMemset(&modInfo, 0, sizeof modInfo);
+    modInfo.modAttribute = mod->isKernelMod ? SCE_MODULE_KERNEL : SCE_MODULE_USER;
+    modInfo.modVersion[MODULE_VERSION_MINOR] = 1;
+    modInfo.modVersion[MODULE_VERSION_MAJOR] = 1;
+    strncpy(modInfo.modName, mod->name, SCE_MODULE_NAME_LEN - 1);
+    modInfo.entTop = (void *)mod->entTop;
+    modInfo.entEnd = (void *)mod->entEnd;
+    modInfo.stubTop = (void *)mod->stubTop;
+    modInfo.stubEnd = (void *)mod->stubEnd;
+    mod->size = (mod->size + 15) & ~15;
+    mod->modInfo = TestAdd(mod, &modInfo, sizeof modInfo);
+    TestReloc(mod, mod->modInfo + ((u8 *)&modInfo.entTop - (u8 *)&modInfo), R_MIPS_32);
+    TestReloc(mod, mod->modInfo + ((u8 *)&modInfo.entEnd - (u8 *)&modInfo), R_MIPS_32);
+    TestReloc(mod, mod->modInfo + ((u8 *)&modInfo.stubTop - (u8 *)&modInfo), R_MIPS_32);
+    TestReloc(mod, mod->modInfo + ((u8 *)&modInfo.stubEnd - (u8 *)&modInfo), R_MIPS_32);
+
+    relocOffset = TEST_SEGMENT_OFFSET + ((mod->size + 15) & ~15);
+    runsOffset = relocOffset + mod->numRelocs * sizeof(Elf32_Rel);
+    runsSize = mod->relocRuns ? TestBuildRuns(mod) : 0;
+    namesOffset = runsOffset + runsSize;
+    shOffset = (namesOffset + sizeof sectionNames + 3) & ~3;
+    mod->fileSize = shOffset + TEST_NUM_SECTIONS * sizeof(Elf32_Shdr);
+    if (mod->fileSize > TEST_FILE_SIZE) {
+        Kprintf("%s: the test file is too large\n", mod->name);
+        HostExit(1);
+    }
+
+    sceKernelMemset(mod->file, 0, sizeof mod->file);
+    elfHeader = (Elf32_Ehdr *)mod->file;
+    elfHeader->e_ident[EI_MAG0] = ELFMAG0;
+    elfHeader->e_ident[EI_MAG1] = ELFMAG1;
+    elfHeader->e_ident[EI_MAG2] = ELFMAG2;
+    elfHeader->e_ident[EI_MAG3] = ELFMAG3;
+    elfHeader->e_ident[EI_CLASS] = ELFCLASS32;
+    elfHeader->e_ident[EI_DATA] = ELFDATA2LSB;
+    elfHeader->e_ident[EI_VERSION] = EV_CURRENT;
+    elfHeader->e_type = ET_SCE_PRX;
+    elfHeader->e_machine = EM_MIPS_ALLEGREX;
+    elfHeader->e_version = EV_CURRENT;
+    elfHeader->e_phoff = sizeof(Elf32_Ehdr);
+    elfHeader->e_shoff = shOffset;
+    elfHeader->e_ehsize = sizeof(Elf32_Ehdr);
+    elfHeader->e_phentsize = sizeof(Elf32_Phdr);
+    elfHeader->e_phnum = mod->relocHeader ? 2 : 1;
+    elfHeader->e_shentsize = sizeof(Elf32_Shdr);
+    elfHeader->e_shnum = mod->relocRuns ? 5 : 4;
+    elfHeader->e_shstrndx = 3;
+
+    /* The physical address of the first segment is the file offset of the module information. */
+    progHeader = (Elf32_Phdr *)(mod->file + elfHeader->e_phoff);
+    progHeader[0].p_type = PT_LOAD;
+    progHeader[0].p_offset = TEST_SEGMENT_OFFSET;
+    progHeader[0].p_vaddr = 0;
+    progHeader[0].p_paddr = (TEST_SEGMENT_OFFSET + mod->modInfo) | (mod->isKernelMod ? 0x80000000 : 0);
+    progHeader[0].p_filesz = mod->size;
+    progHeader[0].p_memsz = mod->size + mod->bssSize;
+    progHeader[0].p_flags = PF_R | PF_W | PF_X;
+    progHeader[0].p_align = 16;
+    progHeader[1].p_type = PT_PRX_RELOC;
+    progHeader[1].p_offset = relocOffset;
+    progHeader[1].p_filesz = mod->numRelocs * sizeof(Elf32_Rel);
+    progHeader[1].p_align = 16;
+
+    sectHeader = (Elf32_Shdr *)(mod->file + shOffset);
+    sectHeader[1].sh_name = 1;
+    sectHeader[1].sh_type = SHT_PROGBITS;
+    /* The loader only applies the relocation sections of the sections which are SHF_ALLOC and nothing else. */
+    sectHeader[1].sh_flags = mod->relocHeader ? (SHF_ALLOC | SHF_EXECINSTR) : SHF_ALLOC;
+    sectHeader[1].sh_offset = TEST_SEGMENT_OFFSET;
+    sectHeader[1].sh_size = mod->size;
+    sectHeader[1].sh_addralign = 16;
+    sectHeader[2].sh_name = 7;
+    sectHeader[2].sh_type = SHT_PRX_RELOC;
+    sectHeader[2].sh_offset = relocOffset;
+    sectHeader[2].sh_size = mod->numRelocs * sizeof(Elf32_Rel);
+    sectHeader[2].sh_info = 1;
+    sectHeader[2].sh_addralign = 4;
+    sectHeader[2].sh_entsize = sizeof(Elf32_Rel);
+    sectHeader[3].sh_name = 17;
+    sectHeader[3].sh_type = SHT_STRTAB;
+    sectHeader[3].sh_offset = namesOffset;
+    sectHeader[3].sh_size = sizeof sectionNames;
+    sectHeader[3].sh_addralign = 1;
+    sectHeader[4].sh_name = 27;
+    sectHeader[4].sh_type = SHT_PRX_RELOC_RUNS;
+    sectHeader[4].sh_offset = runsOffset;
+    sectHeader[4].sh_size = runsSize;
+    sectHeader[4].sh_addralign = 4;
+
+    sceKernelMemmove(mod->file + TEST_SEGMENT_OFFSET, mod->segment, mod->size);
+    sceKernelMemmove(mod->file + relocOffset, mod->relocs, mod->numRelocs * sizeof(Elf32_Rel));
+    sceKernelMemmove(mod->file + runsOffset, mod->runs, runsSize);
+    sceKernelMemmove(mod->file + namesOffset, (void *)sectionNames, sizeof sectionNames);
+}
+
+/* Copies the file to the simulated memory and checks it, as the first step of LoadModule() in psp-loadcore-sim.c. */
+static s32 TestCheck(TestModule *mod, SceLoadCoreExecFileInfo *execInfo)
+{
+    mod->buf = SimAllocBuffer(mod->fileSize);
+    if (mod->buf == NULL)
+        return SCE_ERROR_KERNEL_NO_MEMORY;
+    sceKernelMemmove(mod->buf, mod->file, mod->fileSize);
+
+    sceKernelMemset(execInfo, 0, sizeof *execInfo);
+    execInfo->apiType = 0x50;
+    execInfo->isSignChecked = SCE_TRUE;
+    return sceKernelCheckExecFile(mod->buf, execInfo);
+}
+
+/* Checks and probes the file, and takes the privilege level of its module information, as LoadModule() does. */
+static s32 TestProbe(TestModule *mod, SceLoadCoreExecFileInfo *execInfo)
+{
+    SceModuleInfo *modInfo;
+    s32 status;
+
+    status = TestCheck(mod, execInfo);
+    if (status < SCE_ERROR_OK)
+        return status;
+
+    execInfo->isDecrypted = SCE_TRUE;
+    status = sceKernelProbeExecutableObject(mod->buf, execInfo);
+    if (status < SCE_ERROR_OK)
+        return status;
+
+    modInfo = (SceModuleInfo *)execInfo->moduleInfoOffset;
+    execInfo->modInfoAttribute |= modInfo->modAttribute & SCE_PRIVILEGED_MODULES;
+    execInfo->isKernelMod = ((execInfo->modInfoAttribute & SCE_PRIVILEGED_MODULES) == SCE_MODULE_KERNEL);
+    return SCE_ERROR_OK;
+}
+
+/* Loads the module in its partition. */
+static s32 TestLoad(TestModule *mod, SceLoadCoreExecFileInfo *execInfo)
+{
+    SceUID memId;
+    s32 status;
+
+    status = TestProbe(mod, execInfo);
+    if (status < SCE_ERROR_OK)
+        return status;
+
+    memId = sceKernelAllocPartitionMemory(execInfo->isKernelMod ? SCE_KERNEL_PRIMARY_KERNEL_PARTITION :
+                                          SCE_KERNEL_PRIMARY_USER_PARTITION, "SceLoadCoreTestModule",
+                                          SCE_KERNEL_SMEM_Low, execInfo->largestSegSize, 0);
+    if (memId < 0)
+        return memId;
+
+    execInfo->topAddr = sceKernelGetBlockHeadAddr(memId);
+    return sceKernelLoadExecutableObject(mod->buf, execInfo);
+}
+
+/*
+ * Loads a module with R_MIPS_32, R_MIPS_26 and R_MIPS_LO16 relocations, and checks the words of the
+ * loaded segment.
+ */
+static s32 TestRelocate(const char *name, u32 isKernelMod, u32 relocHeader)
+{
+    SceLoadCoreExecFileInfo execInfo;
+    TestModule mod;
+    u32 plain, ptr, jump, low;
+    u32 top;
+
+    TestNew(&mod, name, isKernelMod);
+    mod.relocHeader = relocHeader;
+    plain = TestWord(&mod, 0x12345678);
+    ptr = TestWord(&mod, 0x40);
+    TestReloc(&mod, ptr, R_MIPS_32);
+    jump = TestWord(&mod, 0x0C000000 | (0x40 >> 2)); /* jal 0x40 */
+    TestReloc(&mod, jump, R_MIPS_26);
+    low = TestWord(&mod, 0x24840040); /* addiu $a0, $a0, 0x40 */
+    TestReloc(&mod, low, R_MIPS_LO16);
+    TestBuild(&mod);
+
+    TEST_ASSERT_OK(TestLoad(&mod, &execInfo));
+    top = (u32)execInfo.topAddr;
+    TEST_ASSERT((top >> 31) == isKernelMod);
+    TEST_ASSERT(execInfo.numSegments == 1);
+    TEST_ASSERT(execInfo.segmentAddr[0] == top);
+    TEST_ASSERT(*(u32 *)(top + plain) == 0x12345678);
+    TEST_ASSERT(*(u32 *)(top + ptr) == top + 0x40);
+    TEST_ASSERT(*(u32 *)(top + jump) == (0x0C000000 | (((top + 0x40) >> 2) & 0x03FFFFFF)));
+    TEST_ASSERT(*(u32 *)(top + low) == (0x24840000 | ((top + 0x40) & 0xFFFF)));
+    return 0;
+}
+
+/* sceKernelCheckExecFile() finds the type of a PRX, and where its module information is. */
+static s32 TestCheckPrx(void)
+{
+    SceLoadCoreExecFileInfo execInfo;
+    TestModule mod;
+
+    TestNew(&mod, "TestCheckPrx", SCE_TRUE);
+    TestWord(&mod, 0);
+    TestBuild(&mod);
+
+    TEST_ASSERT_OK(TestCheck(&mod, &execInfo));
+    TEST_ASSERT(execInfo.elfType == SCE_EXEC_FILE_TYPE_PRX);
+    TEST_ASSERT(execInfo.topAddr == NULL);
+    TEST_ASSERT(execInfo.moduleInfoOffset == TEST_SEGMENT_OFFSET + mod.modInfo);
+    return 0;
+}
+
+/* sceKernelCheckExecFile() finds the size of the memory needed by the loadable segments. */
+static s32 TestCheckSize(void)
+{
+    SceLoadCoreExecFileInfo execInfo;
+    TestModule mod;
+    u32 i;
+
+    TestNew(&mod, "TestCheckSize", SCE_TRUE);
+    for (i = 0; i < 40; i++)
+        TestWord(&mod, i);
+    mod.bssSize = 0x100;
+    TestBuild(&mod);
+
+    TEST_ASSERT_OK(TestCheck(&mod, &execInfo));
+    TEST_ASSERT(execInfo.largestSegSize == mod.size + mod.bssSize);
+    TEST_ASSERT(execInfo.maxSegAlign == 16);
+    return 0;
+}
+
+/* sceKernelProbeExecutableObject() checks the sections and finds the module information in the file. */
+static s32 TestProbePrx(void)
+{
+    SceLoadCoreExecFileInfo execInfo;
+    TestModule mod;
+    u32 i;
+
+    TestNew(&mod, "TestProbePrx", SCE_TRUE);
+    for (i = 0; i < 16; i++)
+        TestWord(&mod, i);
+    TestBuild(&mod);
+
+    TEST_ASSERT_OK(TestProbe(&mod, &execInfo));
+    TEST_ASSERT(execInfo.textSize == mod.size);
+    TEST_ASSERT(execInfo.moduleInfoOffset == (u32)mod.buf + TEST_SEGMENT_OFFSET + mod.modInfo);
+    TEST_ASSERT(strcmp(((SceModuleInfo *)execInfo.moduleInfoOffset)->modName, mod.name) == 0);
+    return 0;
+}
+
+/* A user module is copied to the user partition and relocated. */
+static s32 TestLoadUser(void)
+{
+    return TestRelocate("TestLoadUser", SCE_FALSE, SCE_TRUE);
+}
+
+/* Without the PT_PRX_RELOC program header, the relocations are found with the section headers. */
+static s32 TestLoadSections(void)
+{
+    return TestRelocate("TestLoadSections", SCE_FALSE, SCE_FALSE);
+}
+
+/* A kernel module is copied to the kernel partition, whose addresses have the sign bit set. */
+static s32 TestLoadKernel(void)
+{
+    return TestRelocate("TestLoadKernel", SCE_TRUE, SCE_TRUE);
+}
+
+/* The loader points to the module information in the loaded segment, which the module is created from. */
+static s32 TestModuleInfo(void)
+{
+    SceLoadCoreExecFileInfo execInfo;
+    TestModule mod;
+    SceModule *module;
+
+    TestNew(&mod, "TestModuleInfo", SCE_TRUE);
+    TestWord(&mod, 0x03E00008); /* jr $ra */
+    TestWord(&mod, 0);
+    TestBuild(&mod);
+
+    TEST_ASSERT_OK(TestLoad(&mod, &execInfo));
+    TEST_ASSERT((u32)execInfo.moduleInfo == (u32)execInfo.topAddr + mod.modInfo);
+    TEST_ASSERT(strcmp(execInfo.moduleInfo->modName, mod.name) == 0);
+
+    module = sceKernelCreateAssignModule(&execInfo);
+    TEST_ASSERT(module != NULL);
+    TEST_ASSERT(strcmp(module->modName, mod.name) == 0);
+    TEST_ASSERT_OK(sceKernelRegisterModule(module));
+    TEST_ASSERT(sceKernelFindModuleByName(mod.name) == module);
+    return 0;
+}
+
+/* Returns the address built by a lui and an instruction with a sign-extended immediate. */
+static u32 TestHiLo(u32 hi, u32 lo)
+{
+    return (hi << 16) + (u32)(s32)(s16)lo;
+}
+
+/*
+ * The R_MIPS_HI16 are completed with the R_MIPS_LO16 which follows them, and rounded up when
+ * the sign-extended LO16 is negative.
+ */
+static s32 TestHi16(void)
+{
+    SceLoadCoreExecFileInfo execInfo;
+    TestModule mod;
+    u32 hi1, lo1, hi2, hi3, lo2, hi4, lo3;
+    u32 top;
+
+    TestNew(&mod, "TestHi16", SCE_TRUE);
+    hi1 = TestWord(&mod, 0x3C040001); /* lui $a0, 0x1 */
+    TestReloc(&mod, hi1, R_MIPS_HI16);
+    lo1 = TestWord(&mod, 0x2484FFF0); /* addiu $a0, $a0, -0x10 */
+    TestReloc(&mod, lo1, R_MIPS_LO16);
+    hi2 = TestWord(&mod, 0x3C051234); /* lui $a1, 0x1234 */
+    TestReloc(&mod, hi2, R_MIPS_HI16);
+    hi3 = TestWord(&mod, 0x3C061234); /* lui $a2, 0x1234 */
+    TestReloc(&mod, hi3, R_MIPS_HI16);
+    lo2 = TestWord(&mod, 0x24A55678); /* addiu $a1, $a1, 0x5678 */
+    TestReloc(&mod, lo2, R_MIPS_LO16);
+    hi4 = TestWord(&mod, 0x3C070000); /* lui $a3, 0 */
+    TestReloc(&mod, hi4, R_MIPS_HI16);
+    lo3 = TestWord(&mod, 0x8CE78000); /* lw $a3, -0x8000($a3) */
+    TestReloc(&mod, lo3, R_MIPS_LO16);
+    TestBuild(&mod);
+
+    TEST_ASSERT_OK(TestLoad(&mod, &execInfo));
+    top = (u32)execInfo.topAddr;
+    TEST_ASSERT(TestHiLo(*(u32 *)(top + hi1), *(u32 *)(top + lo1)) == top + 0xFFF0);
+    TEST_ASSERT(TestHiLo(*(u32 *)(top + hi2), *(u32 *)(top + lo2)) == top + 0x12345678);
+    TEST_ASSERT(TestHiLo(*(u32 *)(top + hi3), *(u32 *)(top + lo2)) == top + 0x12345678);
+    TEST_ASSERT(TestHiLo(*(u32 *)(top + hi4), *(u32 *)(top + lo3)) == top - 0x8000);
+    TEST_ASSERT((*(u32 *)(top + hi1) & 0xFFFF0000) == 0x3C040000);
+    TEST_ASSERT((*(u32 *)(top + lo3) & 0xFFFF0000) == 0x8CE70000);
+    return 0;
+}
+
+/* The loader relocates the stub libraries of the module, which are then linked. */
+static s32 TestImportsInfo(void)
+{
+    static const u32 nids[] = { 0x12345678, 0x9ABCDEF0 };
+    SceLoadCoreExecFileInfo execInfo;
+    SceStubLibraryEntryTable *stubEntry;
+    TestModule mod;
+    u32 stubs;
+    u32 top;
+
+    TestNew(&mod, "TestImportsInfo", SCE_TRUE);
+    stubs = TestImport(&mod, "TestLibrary", nids, 2);
+    TestBuild(&mod);
+
+    TEST_ASSERT_OK(TestLoad(&mod, &execInfo));
+    top = (u32)execInfo.topAddr;
+    TEST_ASSERT((u32)execInfo.importsInfo == top + mod.stubTop);
+    TEST_ASSERT(execInfo.importsSize == STUB_LIBRARY_ENTRY_TABLE_OLD_LEN * sizeof(u32));
+    TEST_ASSERT((u32)execInfo.moduleInfo->stubTop == top + mod.stubTop);
+
+    stubEntry = execInfo.importsInfo;
+    TEST_ASSERT(strcmp(stubEntry->libName, "TestLibrary") == 0);
+    TEST_ASSERT(stubEntry->stubCount == 2);
+    TEST_ASSERT(stubEntry->nidTable[1] == 0x9ABCDEF0);
+    TEST_ASSERT((u32)stubEntry->stubTable == top + stubs);
+    return 0;
+}
+
+/* The stubs of a kernel module are linked to the functions of the library of another one. */
+static s32 TestLink(void)
+{
+    static const u32 nids[] = { 0x12345678, 0x9ABCDEF0 };
+    SceLoadCoreExecFileInfo execInfo, execInfo2;
+    TestModule mod, mod2;
+    SceStub *stubTable;
+    u32 funcs, stubs;
+    u32 top, top2;
+
+    TestNew(&mod, "TestLinkExport", SCE_TRUE);
+    funcs = TestExport(&mod, "TestLinkLibrary", nids, 2);
+    TestBuild(&mod);
+    TEST_ASSERT_OK(TestLoad(&mod, &execInfo));
+    top = (u32)execInfo.topAddr;
+    TEST_ASSERT_OK(sceKernelRegisterLibrary(execInfo.moduleInfo->entTop));
+
+    TestNew(&mod2, "TestLinkImport", SCE_TRUE);
+    stubs = TestImport(&mod2, "TestLinkLibrary", nids, 2);
+    TestBuild(&mod2);
+    TEST_ASSERT_OK(TestLoad(&mod2, &execInfo2));
+    top2 = (u32)execInfo2.topAddr;
+    TEST_ASSERT_OK(sceKernelLinkLibraryEntries(execInfo2.importsInfo, execInfo2.importsSize));
+
+    /* Each stub jumps to the function of its NID. */
+    stubTable = (SceStub *)(top2 + stubs);
+    TEST_ASSERT(stubTable[0].dc.call == (0x08000000 | ((top + funcs) & 0x0FFFFFFC)));
+    TEST_ASSERT(stubTable[1].dc.call == (0x08000000 | ((top + funcs + 8) & 0x0FFFFFFC)));
+    return 0;
+}
+
+/* A module with relocation runs is relocated with them, not with its classic relocations. */
+static s32 TestRelocRuns(void)
+{
+    SceLoadCoreExecFileInfo execInfo;
+    TestModule mod;
+    u32 ptr, jump, low;
+    u32 top;
+
+    TestNew(&mod, "TestRelocRuns", SCE_TRUE);
+    mod.relocRuns = SCE_TRUE;
+    ptr = TestWord(&mod, 0x40);
+    TestReloc(&mod, ptr, R_MIPS_32);
+    jump = TestWord(&mod, 0x0C000000 | (0x40 >> 2)); /* jal 0x40 */
+    TestReloc(&mod, jump, R_MIPS_26);
+    low = TestWord(&mod, 0x24840040); /* addiu $a0, $a0, 0x40 */
+    TestReloc(&mod, low, R_MIPS_LO16);
+    TestBuild(&mod);
+    sceKernelMemset(mod.file + TestSection(&mod, 2)->sh_offset, 0, TestSection(&mod, 2)->sh_size);
+
+    TEST_ASSERT_OK(TestLoad(&mod, &execInfo));
+    top = (u32)execInfo.topAddr;
+    TEST_ASSERT(*(u32 *)(top + ptr) == top + 0x40);
+    TEST_ASSERT(*(u32 *)(top + jump) == (0x0C000000 | (((top + 0x40) >> 2) & 0x03FFFFFF)));
+    TEST_ASSERT(*(u32 *)(top + low) == (0x24840000 | ((top + 0x40) & 0xFFFF)));
+    TEST_ASSERT((u32)execInfo.moduleInfo->stubTop == top);
+    return 0;
+}
+
+/*
+ * The relocation runs have to be in the file. Without a PSP header, it ends with the section names,
+ * as psp-kprxgen writes them last.
+ */
+static s32 TestRelocRunsBounds(void)
+{
+    SceLoadCoreExecFileInfo execInfo;
+    TestModule mod;
+    Elf32_Shdr *runsSection;
+    u32 namesEnd;
+
+    TestNew(&mod, "TestRelocRunsBounds", SCE_TRUE);
+    mod.relocRuns = SCE_TRUE;
+    TestReloc(&mod, TestWord(&mod, 0x40), R_MIPS_32);
+    TestBuild(&mod);
+    runsSection = TestSection(&mod, 4);
+    namesEnd = TestSection(&mod, 3)->sh_offset + TestSection(&mod, 3)->sh_size;
+
+    runsSection->sh_size = namesEnd - runsSection->sh_offset + 4;
+    TEST_ASSERT(TestLoad(&mod, &execInfo) == SCE_ERROR_KERNEL_ERROR);
+
+    /* The section headers follow the section names here. */
+    runsSection->sh_offset = (namesEnd + 3) & ~3;
+    runsSection->sh_size = sizeof(Elf32_Shdr);
+    TEST_ASSERT(TestLoad(&mod, &execInfo) == SCE_ERROR_KERNEL_ERROR);
+    return 0;
+}
+
+static const Test g_tests[] = {
+    { "check_prx", TestCheckPrx },
+    { "check_size", TestCheckSize },
+    { "probe_prx", TestProbePrx },
+    { "load_user", TestLoadUser },
+    { "load_sections", TestLoadSections },
+    { "load_kernel", TestLoadKernel },
+    { "module_info", TestModuleInfo },
+    { "hi16", TestHi16 },
+    { "imports_info", TestImportsInfo },
+    { "link", TestLink },
+    { "reloc_runs", TestRelocRuns },
+    { "reloc_runs_bounds", TestRelocRunsBounds },
+};
+
+int main(void)
+{
+    u32 numTests = sizeof g_tests / sizeof g_tests[0];
+    u32 failed = 0;
+    u32 i;
+
+    SimInit();
+    for (i = 0; i < numTests; i++) {
+        SimReset();
+        SimPrintf("%s\n", g_tests[i].name);
+        if (g_tests[i].func() != 0) {
+            SimPrintf("    FAILED\n");
+            failed++;
+        }
+    }
+    SimPrintf("%u of %u tests failed\n", failed, numTests);
+
+    return (failed != 0);
+}
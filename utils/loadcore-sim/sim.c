@@ -0,0 +1,508 @@
+/* Copyright (C) 2011, 2012 The uOFW team
+   See the file COPYING for copying permission.
+*/
+
+/*
+ * uofw/utils/loadcore-sim/sim.c
+ *
+ * The kernel services Loadcore needs, simulated on the host:
+ *    - System Memory Manager: the two primary partitions, heaps, UIDs and
+ *      a few utilities. Partition memory and heap memory are allocated by
+ *      moving a bump pointer, and only given back by SimReset().
+ *    - Interrupt controller, caches and system calls: no-ops.
+ *    - Decryption and decompression: not simulated, the executables have to be
+ *      the plain ELF/PRX files output by the build.
+ *
+ * Loadcore doesn't call the Thread Manager itself.
+ */
+
+#include <interruptman.h>
+#include <memlmd.h>
+#include <mesgled.h>
+#include <sysmem_kdebug.h>
+#include <sysmem_kernel.h>
+#include <sysmem_utils_kernel.h>
+
+#include "cache.h"
+#include "interruptController.h"
+#include "loadcore_int.h"
+
+#include "host.h"
+#include "sim.h"
+
+/* Part of the kernel partition used for the heaps and the UID control blocks */
+#define SIM_ARENA_SIZE          (0x00100000)
+
+#define SIM_CYCLES_PER_US       (333)
+
+typedef struct {
+    u32 addr;
+    u32 size;
+    u32 low; /* next address allocated from the bottom */
+    u32 high; /* last address allocated from the top */
+} SimPartition;
+
+typedef struct {
+    void *addr;
+    u32 size;
+    s32 mpid;
+} SimMemoryBlock;
+
+s32 g_simCop0State[32];
+s32 g_simCop0Ctrl[32];
+s32 g_simK0;
+s32 g_simK1;
+s32 g_simGp;
+
+static s32 g_simIntr;
+static u32 g_simUidCount;
+
+static SimPartition g_simParts[3];
+static u32 g_simArena;
+static u32 g_simArenaEnd;
+
+static SceSysmemUidCB *g_simBlockType;
+static SceSysmemUidCB *g_simHeapType;
+
+u32 SimCycles(void)
+{
+    return (u32)(HostTimeNs() * SIM_CYCLES_PER_US / 1000);
+}
+
+void SimBreak(s32 code)
+{
+    Kprintf("loadcore-sim: break %d, stopping\n", code);
+    HostExit(1);
+}
+
+int SimPrintf(const char *format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    HostVprintf(format, ap);
+    va_end(ap);
+    return 0;
+}
+
+static void *SimArenaAlloc(u32 size)
+{
+    u32 addr = g_simArena;
+    size = (size + 15) & ~15;
+    if (size > g_simArenaEnd - g_simArena)
+        return NULL;
+    g_simArena += size;
+    HostMemset((void *)addr, 0, size);
+    return (void *)addr;
+}
+
+static char *SimArenaString(const char *str)
+{
+    u32 len = 0;
+    while (str[len] != '\0')
+        len++;
+    char *copy = SimArenaAlloc(len + 1);
+    if (copy != NULL)
+        HostMemmove(copy, str, len + 1);
+    return copy;
+}
+
+void SimInit(void)
+{
+    HostMapMemory(SIM_KERNEL_ADDR, SIM_KERNEL_SIZE);
+    HostMapMemory(SIM_USER_ADDR, SIM_USER_SIZE);
+}
+
+void SimReset(void)
+{
+    g_simParts[SCE_KERNEL_PRIMARY_KERNEL_PARTITION].addr = SIM_KERNEL_ADDR;
+    g_simParts[SCE_KERNEL_PRIMARY_KERNEL_PARTITION].size = SIM_KERNEL_SIZE - SIM_ARENA_SIZE;
+    g_simParts[SCE_KERNEL_PRIMARY_USER_PARTITION].addr = SIM_USER_ADDR;
+    g_simParts[SCE_KERNEL_PRIMARY_USER_PARTITION].size = SIM_USER_SIZE;
+    u32 i;
+    for (i = SCE_KERNEL_PRIMARY_KERNEL_PARTITION; i <= SCE_KERNEL_PRIMARY_USER_PARTITION; i++) {
+        g_simParts[i].low = g_simParts[i].addr;
+        g_simParts[i].high = g_simParts[i].addr + g_simParts[i].size;
+    }
+    g_simArena = SIM_KERNEL_ADDR + SIM_KERNEL_SIZE - SIM_ARENA_SIZE;
+    g_simArenaEnd = SIM_KERNEL_ADDR + SIM_KERNEL_SIZE;
+    g_simUidCount = 0;
+    g_simIntr = 0;
+    g_simK1 = 0;
+
+    sceKernelCreateUIDtype("SceSysMemMemoryBlock", sizeof(SimMemoryBlock), NULL, NULL, &g_simBlockType);
+    sceKernelCreateUIDtype("SceSysmemHeap", 0, NULL, NULL, &g_simHeapType);
+    SimLoadCoreInit();
+}
+
+u32 SimPartitionUsedSize(s32 mpid)
+{
+    SimPartition *part = &g_simParts[mpid];
+    return part->size - (part->high - part->low);
+}
+
+/*
+ * Partitions
+ */
+
+SceUID sceKernelAllocPartitionMemory(s32 mpid, char *name, u32 type, u32 size, u32 addr)
+{
+    if (mpid != SCE_KERNEL_PRIMARY_KERNEL_PARTITION && mpid != SCE_KERNEL_PRIMARY_USER_PARTITION)
+        return SCE_ERROR_KERNEL_ILLEGAL_PARTITION_ID;
+    if (type > 4 || ((type == 3 || type == 4) && (addr == 0 || (addr & (addr - 1)) != 0)))
+        return SCE_ERROR_KERNEL_ILLEGAL_ARGUMENT;
+
+    SimPartition *part = &g_simParts[mpid];
+    u32 align = (type == 3 || type == 4) ? pspMax(addr, 0x100) : 0x100;
+    u32 blockAddr;
+    size = (size + 0xFF) & ~0xFF;
+    switch (type) {
+    case SCE_KERNEL_SMEM_Low: case 3:
+        blockAddr = (part->low + align - 1) & ~(align - 1);
+        break;
+    case SCE_KERNEL_SMEM_High: case 4:
+        blockAddr = (part->high - size) & ~(align - 1);
+        break;
+    default:
+        blockAddr = addr & ~0xFF;
+        break;
+    }
+    if (size == 0 || blockAddr < part->low || blockAddr + size > part->high || blockAddr + size < blockAddr) {
+        Kprintf("loadcore-sim: cannot allocate 0x%x bytes for [%s] in partition %d\n", size, name, mpid);
+        return SCE_ERROR_KERNEL_FAILED_ALLOC_MEMBLOCK;
+    }
+    if (type == SCE_KERNEL_SMEM_High || type == 4)
+        part->high = blockAddr;
+    else
+        part->low = blockAddr + size;
+
+    SceSysmemUidCB *uid;
+    s32 ret = sceKernelCreateUID(g_simBlockType, name, 0, &uid);
+    if (ret != 0)
+        return ret;
+    SimMemoryBlock *block = UID_CB_TO_DATA(uid, g_simBlockType, SimMemoryBlock);
+    block->addr = (void *)blockAddr;
+    block->size = size;
+    block->mpid = mpid;
+    return uid->uid;
+}
+
+/*
+ * sceKernelCheckExecFile() refuses an ELF header at an address with the bit 31
+ * set, so the buffers are in the user partition.
+ */
+void *SimAllocBuffer(u32 size)
+{
+    SceUID id = sceKernelAllocPartitionMemory(SCE_KERNEL_PRIMARY_USER_PARTITION, "SceLoadCoreSimBuffer",
+                                              SCE_KERNEL_SMEM_High, size, 0);
+    if (id < 0)
+        return NULL;
+    return sceKernelGetBlockHeadAddr(id);
+}
+
+s32 sceKernelFreePartitionMemory(SceUID id)
+{
+    return sceKernelDeleteUID(id);
+}
+
+void *sceKernelGetBlockHeadAddr(SceUID id)
+{
+    SceSysmemUidCB *uid;
+    if (sceKernelGetUIDcontrolBlockWithType(id, g_simBlockType, &uid) != 0)
+        return NULL;
+    return UID_CB_TO_DATA(uid, g_simBlockType, SimMemoryBlock)->addr;
+}
+
+s32 sceKernelQueryMemoryPartitionInfo(s32 mpid, SceSysmemPartitionInfo *info)
+{
+    if (mpid != SCE_KERNEL_PRIMARY_KERNEL_PARTITION && mpid != SCE_KERNEL_PRIMARY_USER_PARTITION)
+        return SCE_ERROR_KERNEL_ILLEGAL_PARTITION_ID;
+    info->startAddr = g_simParts[mpid].addr;
+    info->memSize = g_simParts[mpid].size;
+    info->attr = (mpid == SCE_KERNEL_PRIMARY_USER_PARTITION) ? 0xF : 0xC;
+    return 0;
+}
+
+/*
+ * Heaps
+ */
+
+SceUID sceKernelCreateHeap(SceUID mpid, SceSize size, int flag, const char *name)
+{
+    SceSysmemUidCB *uid;
+    s32 ret = sceKernelCreateUID(g_simHeapType, name, 0, &uid);
+    if (ret != 0)
+        return ret;
+    return uid->uid;
+}
+
+void *sceKernelAllocHeapMemory(SceUID id, int size)
+{
+    SceSysmemUidCB *uid;
+    if (size <= 0 || sceKernelGetUIDcontrolBlockWithType(id, g_simHeapType, &uid) != 0)
+        return NULL;
+    return SimArenaAlloc(size);
+}
+
+s32 sceKernelFreeHeapMemory(SceUID id, void *addr)
+{
+    SceSysmemUidCB *uid;
+    return sceKernelGetUIDcontrolBlockWithType(id, g_simHeapType, &uid);
+}
+
+/*
+ * UIDs
+ */
+
+static s32 SimCallUIDFunction(SceSysmemUidCB *uid, s32 funcId, ...)
+{
+    SceSysmemUidLookupFunc *cur = uid->meta->funcTable;
+    if (cur == NULL)
+        return 0;
+    for (; cur->id != 0; cur++) {
+        if (cur->id == funcId) {
+            va_list ap;
+            va_start(ap, funcId);
+            s32 ret = cur->func(uid, uid->meta, funcId, ap);
+            va_end(ap);
+            return ret;
+        }
+    }
+    return 0;
+}
+
+int sceKernelCreateUIDtype(const char *name, int size, SceSysmemUidLookupFunc *funcTable,
+                           SceSysmemUidLookupFunc *metaFuncTable, SceSysmemUidCB **uidTypeOut)
+{
+    SceSysmemUidCB *type = SimArenaAlloc(sizeof(SceSysmemUidCB));
+    if (type == NULL)
+        return SCE_ERROR_KERNEL_NO_MEMORY;
+    type->name = SimArenaString(name);
+    type->meta = type;
+    type->size = sizeof(SceSysmemUidCB) / 4;
+    type->childSize = (sizeof(SceSysmemUidCB) + size + 3) / 4;
+    type->funcTable = funcTable;
+    type->uid = ((s32)type << 5) | ((g_simUidCount++ & 0x3F) << 1) | 1;
+    *uidTypeOut = type;
+    return 0;
+}
+
+int sceKernelCreateUID(SceSysmemUidCB *type, const char *name, char k1, SceSysmemUidCB **outUid)
+{
+    SceSysmemUidCB *uid = SimArenaAlloc(type->childSize * 4);
+    char *nameBuf = SimArenaString(name);
+    if (uid == NULL || nameBuf == NULL)
+        return SCE_ERROR_KERNEL_NO_MEMORY;
+    uid->uid = ((s32)uid << 5) | ((g_simUidCount++ & 0x3F) << 1) | 1;
+    uid->name = nameBuf;
+    uid->meta = type;
+    uid->size = type->size;
+    uid->childSize = type->childSize;
+    uid->attr = k1;
+    *outUid = uid;
+    SimCallUIDFunction(uid, 0xD310D2D9);
+    return 0;
+}
+
+s32 sceKernelGetUIDcontrolBlockWithType(SceUID id, SceSysmemUidCB *type, SceSysmemUidCB **outUid)
+{
+    SceSysmemUidCB *uid = (SceSysmemUidCB *)(SIM_KERNEL_ADDR | (((u32)id >> 7) * 4));
+    if (id <= 0 || (u32)uid < SIM_KERNEL_ADDR + SIM_KERNEL_SIZE - SIM_ARENA_SIZE || (u32)uid >= g_simArena
+        || uid->uid != id || uid->meta != type)
+        return SCE_ERROR_KERNEL_UNKNOWN_UID;
+    *outUid = uid;
+    return 0;
+}
+
+s32 sceKernelDeleteUID(SceUID id)
+{
+    SceSysmemUidCB *uid = (SceSysmemUidCB *)(SIM_KERNEL_ADDR | (((u32)id >> 7) * 4));
+    if (id <= 0 || (u32)uid < SIM_KERNEL_ADDR + SIM_KERNEL_SIZE - SIM_ARENA_SIZE || (u32)uid >= g_simArena
+        || uid->uid != id)
+        return SCE_ERROR_KERNEL_UNKNOWN_UID;
+    SimCallUIDFunction(uid, 0x87089863);
+    uid->uid = 0;
+    return 0;
+}
+
+s32 sceKernelRenameUID(SceUID id, const char *name)
+{
+    SceSysmemUidCB *uid = (SceSysmemUidCB *)(SIM_KERNEL_ADDR | (((u32)id >> 7) * 4));
+    if (id <= 0 || (u32)uid < SIM_KERNEL_ADDR + SIM_KERNEL_SIZE - SIM_ARENA_SIZE || (u32)uid >= g_simArena
+        || uid->uid != id)
+        return SCE_ERROR_KERNEL_UNKNOWN_UID;
+    uid->name = SimArenaString(name);
+    return 0;
+}
+
+s32 sceKernelCallUIDObjCommonFunction(SceSysmemUidCB *uid, SceSysmemUidCB *uidWithFunc, s32 funcId, va_list ap)
+{
+    return uid->uid;
+}
+
+/*
+ * Utilities
+ */
+
+int Kprintf(const char *format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    HostVprintfErr(format, ap);
+    va_end(ap);
+    return 0;
+}
+
+int sceKernelDipsw(u32 reg)
+{
+    return 0;
+}
+
+int sceKernelIsToolMode(void)
+{
+    return 0;
+}
+
+void *sceKernelMemset(void *src, s8 c, u32 size)
+{
+    HostMemset(src, c, size);
+    return src;
+}
+
+void *sceKernelMemset32(void *src, s32 c, u32 size)
+{
+    u32 *cur = src;
+    u32 i;
+    for (i = 0; i < size / 4; i++)
+        cur[i] = c;
+    return src;
+}
+
+void *sceKernelMemmove(void *dst, void *src, u32 size)
+{
+    HostMemmove(dst, src, size);
+    return dst;
+}
+
+int sceKernelRtcGetTick(u64 *tick)
+{
+    *tick = HostTimeNs() / 1000;
+    return 0;
+}
+
+/* Only used to pick the module UID names, which the simulator doesn't care about */
+int sceKernelUtilsMd5Digest(u8 *data, u32 size, u8 *digest)
+{
+    HostMemset(digest, 0, 16);
+    return 0;
+}
+
+int sceKernelGzipDecompress(u8 *dest, u32 destSize, const void *src, u32 *unk)
+{
+    Kprintf("loadcore-sim: compressed executables are not simulated\n");
+    return SCE_ERROR_KERNEL_ERROR;
+}
+
+int UtilsForKernel_6C6887EE(void *outBuf, int outSize, void *inBuf, void **end)
+{
+    Kprintf("loadcore-sim: compressed executables are not simulated\n");
+    return SCE_ERROR_KERNEL_ERROR;
+}
+
+/*
+ * Caches, interrupts and system calls
+ */
+
+void sceKernelDcacheWBinvAll(void)
+{
+}
+
+void sceKernelIcacheClearAll(void)
+{
+}
+
+void sceKernelDcacheWritebackInvalidateAll(void)
+{
+}
+
+void sceKernelDcacheWritebackInvalidateRange(const void *p, unsigned int size)
+{
+}
+
+void sceKernelIcacheInvalidateAll(void)
+{
+}
+
+int sceKernelIcacheInvalidateRange(const void *addr, unsigned int size)
+{
+    return 0;
+}
+
+s32 loadCoreCpuSuspendIntr(void)
+{
+    s32 oldIntr = g_simIntr;
+    g_simIntr = 0;
+    return oldIntr;
+}
+
+void loadCoreCpuResumeIntr(s32 intr)
+{
+    g_simIntr = intr;
+}
+
+void loadCoreClearMem(u32 *baseAddr, u32 size)
+{
+    SimBreak(0);
+}
+
+void sub_00003D84(void)
+{
+}
+
+s32 sceLoadCorePrimarySyscallHandler(void)
+{
+    return 0;
+}
+
+s32 sceKernelRegisterSystemCallTable(SceSyscallTable *newMap)
+{
+    return 0;
+}
+
+s32 sceKernelSetPrimarySyscallHandler(s32 syscallId, void (*syscall)())
+{
+    return 0;
+}
+
+/*
+ * Decryption, the executables have to be plain ELF files
+ */
+
+#define SIM_NOT_ENCRYPTED() do { \
+        Kprintf("loadcore-sim: encrypted executables are not simulated\n"); \
+        return SCE_ERROR_KERNEL_ERROR; \
+    } while (0)
+
+s32 memlmd_EF73E85B(u8 *prx, u32 size, u32 *newSize) { SIM_NOT_ENCRYPTED(); }
+s32 memlmd_2AE425D2(u32 unk) { SIM_NOT_ENCRYPTED(); }
+s32 memlmd_9D36A439(u32 unk) { SIM_NOT_ENCRYPTED(); }
+s32 memlmd_F26A33C3(u32 unk, vs32 *hashAddr) { SIM_NOT_ENCRYPTED(); }
+s32 memlmd_CF03556B(u8 *prx, u32 size, u32 *newSize) { SIM_NOT_ENCRYPTED(); }
+s32 memlmd_6192F715(u8 *addr, u32 size) { SIM_NOT_ENCRYPTED(); }
+s32 memlmd_2F3D7E2D(void) { SIM_NOT_ENCRYPTED(); }
+
+s32 sceMesgLed_driver_9E3C79D9(u8 *modBuf, u32 arg1, u32 *buf) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_5C3A61FE(u8 *buf, u32 size, u32 *newSize) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_2CB700EC(u8 *buf, u32 size, u32 *newSize) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_337D0DD3(u8 *buf, u32 size, u32 *newSize) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_4EAB9850(u8 *buf, u32 size, u32 *newSize) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_B2CDAC3F(u8 *buf, u32 size, u32 *newSize) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_C79E3488(u8 *buf, u32 size, u32 *newSize) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_21AFFAAC(u8 *buf, u32 size, u32 *newSize) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_C00DAD75(u8 *buf, u32 size, u32 *newSize) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_CED2C075(u8 *buf, u32 size, u32 *newSize, u32 arg4) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_C7D1C16B(u8 *buf, u32 size, u32 *newSize, u32 arg4) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_EBB4613D(u8 *buf, u32 size, u32 *newSize, u32 arg4) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_66B348B2(u8 *buf, u32 size, u32 *newSize, u32 arg4) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_B2D95FDF(u8 *buf, u32 size, u32 *newSize) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_91E0A9AD(u8 *buf, u32 size, u32 *newSize, u32 arg4) { SIM_NOT_ENCRYPTED(); }
+s32 sceMesgLed_driver_31D6D8AA(u8 *buf, u32 size, u32 *newSize, u32 arg4) { SIM_NOT_ENCRYPTED(); }
@@ -0,0 +1,37 @@
+/* Copyright (C) 2011, 2012 The uOFW team
+   See the file COPYING for copying permission.
+*/
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <common_imp.h>
+
+/* The simulated 32 MB of RAM: the kernel partitions, then the user partition */
+#define SIM_KERNEL_ADDR         (0x88000000)
+#define SIM_KERNEL_SIZE         (0x00800000)
+#define SIM_USER_ADDR           (0x08800000)
+#define SIM_USER_SIZE           (0x01800000)
+
+/* Maps the simulated memory, once. */
+void SimInit(void);
+
+/* Empties the partitions, the heaps and the UIDs, and initializes Loadcore again. */
+void SimReset(void);
+
+/* Allocates a buffer in the simulated memory, for a module file. */
+void *SimAllocBuffer(u32 size);
+
+/* Stops the simulator, for a break instruction or a loadcore error */
+void SimBreak(s32 code);
+
+/* Prints to the standard output (Kprintf() prints to the standard error) */
+int SimPrintf(const char *format, ...);
+
+/* Gets the size used in a partition. */
+u32 SimPartitionUsedSize(s32 mpid);
+
+/* Initializes the Loadcore state as loadCoreInit() does, without booting anything (simloadcore.c). */
+void SimLoadCoreInit(void);
+
+#endif
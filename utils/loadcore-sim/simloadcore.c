@@ -0,0 +1,66 @@
+/* Copyright (C) 2011, 2012 The uOFW team
+   See the file COPYING for copying permission.
+*/
+
+/*
+ * uofw/utils/loadcore-sim/simloadcore.c
+ *
+ * Loadcore, with an initialization for the simulator: loadCoreInit() boots
+ * the system, so the part of it setting up the library, stub and module
+ * services is done again here, with the static data it works on.
+ */
+
+#include "../../src/loadcore/loadcore.c"
+
+#include "sim.h"
+
+void SimLoadCoreInit(void)
+{
+    u32 i;
+
+    for (i = 0; i < LOADCORE_LIB_HASH_TABLE_SIZE; i++)
+         g_loadCore.registeredLibs[i] = NULL;
+
+    g_loadCore.libHashTable = g_loadCore.registeredLibs;
+    g_loadCore.libHashTableSize = LOADCORE_LIB_HASH_TABLE_SIZE;
+    g_loadCore.oldLibHashTable = NULL;
+    g_loadCore.regLibCount = 0;
+    g_loadCore.libLookups = 0;
+    g_loadCore.libProbes = 0;
+    g_loadCore.maxLibChainLength = 0;
+
+    g_loadCore.sysCallTableSeed = 0x2000;
+    g_loadCore.secModId = SECONDARY_MODULE_ID_START_VALUE;
+    g_loadCore.loadCoreHeapId = LOADCORE_ERROR;
+    g_loadCore.linkedLoadCoreStubs = SCE_FALSE;
+    g_loadCore.sysCallTable = NULL;
+    g_loadCore.unk520 = 0;
+    for (i = 0; i < UNLINKED_STUB_LIB_HASH_TABLE_SIZE; i++)
+         g_UnlinkedStubLibs[i] = NULL;
+
+    g_loadCore.unLinkedStubLibs = g_UnlinkedStubLibs;
+    g_loadCore.registeredMods = NULL;
+    g_loadCore.lastRegMod = NULL;
+    g_loadCore.regModCount = 0;
+    g_loadCore.bootCallBacks = NULL;
+
+    LibEntTableInit();
+    LibStubTableInit();
+
+    /*
+     * Loadcore itself is in the host memory, not at a kernel address, so the
+     * name of its library is copied to the heap: the heap has to be usable
+     * before the library is registered.
+     */
+    g_UpdateCacheAll = UpdateCacheAllDynamic;
+    g_UpdateCacheDataAll = UpdateCacheDataAllDynamic;
+    g_loadCoreHeap = LoadCoreHeapDynamic;
+    g_UpdateCacheRange = UpdateCacheRangeDynamic;
+    g_UpdateCacheRangeData = UpdateCacheRangeDataDynamic;
+
+    if (sceKernelRegisterLibrary(&loadCoreKernelLib) != SCE_ERROR_OK)
+        SimBreak(0);
+    g_loadCore.linkedLoadCoreStubs = SCE_TRUE;
+
+    ModuleServiceInit();
+}
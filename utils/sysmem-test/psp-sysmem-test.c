@@ -0,0 +1,702 @@
+/* Copyright (C) 2011, 2012 The uOFW team
+   See the file COPYING for copying permission.
+*/
+
+/*
+ * uofw/utils/sysmem-test/psp-sysmem-test.c
+ *
+ * Checks the sysmem routines which need no kernel around them on data built
+ * by the tests. The deflate streams are encoded here with the fixed Huffman
+ * codes, which is enough to choose every literal and every match.
+ *
+ * The copies of sysclib create the destination cache lines without reading
+ * them; the simulated cache operation (see allegrex.h) fills these lines, so
+ * a copy reading a source byte after its line was created gets a wrong value.
+ */
+
+#include <common_imp.h>
+#include <sysmem_sysclib.h>
+#include <sysmem_utils_kernel.h>
+
+#include "deflate.h"
+#include "digest.h"
+#include "start.h"
+
+#include "host.h"
+
+#define TEST_MAX_COMPRESSED     (0x10000)
+#define TEST_MAX_DATA           (0x10000)
+
+/* The benchmarks hash from 64 bytes to 16 MB, at least TEST_BENCH_TOTAL bytes for each size */
+#define TEST_BENCH_MIN_SIZE     (64)
+#define TEST_BENCH_MAX_SIZE     (16 << 20)
+#define TEST_BENCH_TOTAL        (64 << 20)
+
+/* Words of the MT19937 sequence checked against the reference generator */
+#define TEST_MT_WORDS           (3000)
+
+#define TEST_ASSERT(cond) do { \
+    if (!(cond)) { \
+        TestPrintf("    line %d: %s\n", __LINE__, #cond); \
+        return -1; \
+    } \
+} while (0)
+
+#define TEST_ASSERT_OK(status) do { \
+    s32 _status = (status); \
+    if (_status < SCE_ERROR_OK) { \
+        TestPrintf("    line %d: %s returned 0x%08X\n", __LINE__, #status, _status); \
+        return -1; \
+    } \
+} while (0)
+
+/* A deflate stream and the data it decompresses to */
+typedef struct {
+    u8 out[TEST_MAX_COMPRESSED];
+    u32 size;
+    u32 bitBuf;
+    u32 bitCount;
+    u8 data[TEST_MAX_DATA];
+    u32 dataSize;
+} TestDeflate;
+
+typedef struct {
+    const char *name;
+    s32 (*func)(void);
+} Test;
+
+/* Processor state used by allegrex.h */
+s32 g_simCop0State[32];
+s32 g_simCop0Ctrl[32];
+s32 g_simK0;
+s32 g_simK1;
+s32 g_simGp;
+
+/* Defined in utils.c, without a header */
+int sceKernelUtilsMd5BlockInit(SceKernelUtilsMd5Context *ctx);
+int sceKernelUtilsMd5BlockUpdate(SceKernelUtilsMd5Context *ctx, u8 *data, u32 size);
+int sceKernelUtilsMd5BlockResult(SceKernelUtilsMd5Context *ctx, u8 *digest);
+int sceKernelUtilsSha1Digest(u8 *data, u32 size, u8 *digest);
+int sceKernelUtilsSha1BlockInit(SceKernelUtilsSha1Context *ctx);
+int sceKernelUtilsSha1BlockUpdate(SceKernelUtilsSha1Context *ctx, u8 *data, u32 size);
+int sceKernelUtilsSha1BlockResult(SceKernelUtilsSha1Context *ctx, u8 *digest);
+int sceKernelUtilsMt19937Init(SceKernelUtilsMt19937Context *ctx, u32 seed);
+u32 sceKernelUtilsMt19937UInt(SceKernelUtilsMt19937Context *ctx);
+s32 sceKernelUtilsMt19937Fill(SceKernelUtilsMt19937Context *ctx, u32 *buf, u32 count);
+void Mt19937Generate(SceKernelUtilsMt19937Context *ctx, u32 *out, u32 count);
+
+static u32 g_testSeed;
+static TestDeflate g_testDeflate;
+static u8 g_testWindow[SCE_KERNEL_DEFLATE_WINDOW_SIZE] __attribute__((aligned(64)));
+static u8 g_testFile[TEST_MAX_COMPRESSED + 64];
+static u8 g_testBench[TEST_BENCH_MAX_SIZE + 64];
+
+static void TestPrintf(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    HostVprintf(fmt, ap);
+    va_end(ap);
+}
+
+u32 SimCycles(void)
+{
+    return HostTimeNs() / 1000 * 333;
+}
+
+void SimBreak(s32 code)
+{
+    TestPrintf("break 0x%08X\n", code);
+    HostExit(1);
+}
+
+/* The cache and the generator are handled by start.S, which is not built for the host */
+int sceKernelDcacheInvalidateRange(const void *p, u32 size)
+{
+    (void)p;
+    (void)size;
+    return 0;
+}
+
+int sceKernelDcachePurgeRange(const void *p, u32 size)
+{
+    (void)p;
+    (void)size;
+    return 0;
+}
+
+int sceKernelIcacheInvalidateRange(const void *p, u32 size)
+{
+    (void)p;
+    (void)size;
+    return 0;
+}
+
+int UtilsForKernel_157A383A(const void *p, u32 size)
+{
+    (void)p;
+    (void)size;
+    return 0;
+}
+
+int UtilsForKernel_43C9A8DB(const void *p, u32 size)
+{
+    (void)p;
+    (void)size;
+    return 0;
+}
+
+u32 mt19937UInt(SceKernelUtilsMt19937Context *ctx)
+{
+    u32 value;
+    Mt19937Generate(ctx, &value, 1);
+    return value;
+}
+
+static u8 TestRandom(void)
+{
+    g_testSeed = g_testSeed * 1103515245 + 12345;
+    return g_testSeed >> 16;
+}
+
+static void TestDeflateBits(TestDeflate *enc, u32 value, u32 n)
+{
+    enc->bitBuf |= value << enc->bitCount;
+    enc->bitCount += n;
+    while (enc->bitCount >= 8) {
+        enc->out[enc->size++] = enc->bitBuf;
+        enc->bitBuf >>= 8;
+        enc->bitCount -= 8;
+    }
+}
+
+/* The Huffman codes are stored from their most significant bit */
+static void TestDeflateCode(TestDeflate *enc, u32 code, u32 n)
+{
+    u32 reversed = 0;
+    u32 i;
+
+    for (i = 0; i < n; i++)
+        reversed |= ((code >> i) & 1) << (n - 1 - i);
+    TestDeflateBits(enc, reversed, n);
+}
+
+static void TestDeflateSymbol(TestDeflate *enc, u32 symbol)
+{
+    if (symbol < 144)
+        TestDeflateCode(enc, 0x30 + symbol, 8);
+    else if (symbol < 256)
+        TestDeflateCode(enc, 0x190 + symbol - 144, 9);
+    else if (symbol < 280)
+        TestDeflateCode(enc, symbol - 256, 7);
+    else
+        TestDeflateCode(enc, 0xC0 + symbol - 280, 8);
+}
+
+/* Starts the final block, with the fixed Huffman codes */
+static void TestDeflateBegin(TestDeflate *enc)
+{
+    enc->size = 0;
+    enc->bitBuf = 0;
+    enc->bitCount = 0;
+    enc->dataSize = 0;
+    TestDeflateBits(enc, 1, 1);
+    TestDeflateBits(enc, 1, 2);
+}
+
+static void TestDeflateLiteral(TestDeflate *enc, u8 c)
+{
+    TestDeflateSymbol(enc, c);
+    enc->data[enc->dataSize++] = c;
+}
+
+static void TestDeflateMatch(TestDeflate *enc, u32 len, u32 dist)
+{
+    static const u16 lengthBase[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+    };
+    static const u8 lengthExtra[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+    static const u16 distBase[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+    };
+    static const u8 distExtra[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+    u32 i, j;
+
+    for (i = 28; lengthBase[i] > len; i--)
+        ;
+    for (j = 29; distBase[j] > dist; j--)
+        ;
+    TestDeflateSymbol(enc, 257 + i);
+    TestDeflateBits(enc, len - lengthBase[i], lengthExtra[i]);
+    TestDeflateCode(enc, j, 5);
+    TestDeflateBits(enc, dist - distBase[j], distExtra[j]);
+    for (i = 0; i < len; i++) {
+        enc->data[enc->dataSize] = enc->data[enc->dataSize - dist];
+        enc->dataSize++;
+    }
+}
+
+static void TestDeflateEnd(TestDeflate *enc)
+{
+    TestDeflateSymbol(enc, 256);
+    if (enc->bitCount != 0)
+        TestDeflateBits(enc, 0, 8 - enc->bitCount);
+}
+
+/* Decompresses the stream in the ring buffer, checking every byte output */
+static s32 TestDeflateRing(const TestDeflate *enc)
+{
+    SceKernelDeflateStream stream;
+    u32 pos = 0;
+    u32 outSize;
+    s32 ret;
+    u32 i;
+
+    TEST_ASSERT_OK(sceKernelDeflateStreamInit(&stream, g_testWindow, sizeof g_testWindow, SCE_KERNEL_DEFLATE_RING));
+    stream.in = enc->out;
+    stream.inSize = enc->size;
+    do {
+        ret = sceKernelDeflateStreamDecompress(&stream, sizeof g_testWindow, &outSize);
+        TEST_ASSERT_OK(ret);
+        TEST_ASSERT(ret == 1 || outSize != 0);
+        TEST_ASSERT(pos + outSize <= enc->dataSize);
+        for (i = 0; i < outSize; i++)
+            TEST_ASSERT(g_testWindow[(pos + i) % sizeof g_testWindow] == enc->data[pos + i]);
+        pos += outSize;
+    } while (ret != 1);
+    TEST_ASSERT(pos == enc->dataSize);
+    return 0;
+}
+
+static s32 TestDeflateLinear(void)
+{
+    TestDeflate *enc = &g_testDeflate;
+    u8 *out = g_testWindow;
+    void *next;
+    u32 i;
+
+    TestDeflateBegin(enc);
+    for (i = 0; i < 300; i++)
+        TestDeflateLiteral(enc, TestRandom());
+    TestDeflateMatch(enc, 3, 1);
+    TestDeflateMatch(enc, 100, 7);
+    TestDeflateMatch(enc, 258, 300);
+    TestDeflateLiteral(enc, 0xFF);
+    TestDeflateEnd(enc);
+    TEST_ASSERT(sceKernelDeflateDecompress(out, sizeof g_testWindow, enc->out, &next) == (s32)enc->dataSize);
+    TEST_ASSERT((u8 *)next == enc->out + enc->size);
+    for (i = 0; i < enc->dataSize; i++)
+        TEST_ASSERT(out[i] == enc->data[i]);
+    return 0;
+}
+
+static s32 TestDeflateRingOverlap(void)
+{
+    TestDeflate *enc = &g_testDeflate;
+    u32 i;
+
+    // The match source is 8 bytes ahead of its destination in the ring buffer, and both are in the same lines
+    TestDeflateBegin(enc);
+    for (i = 0; i < SCE_KERNEL_DEFLATE_WINDOW_SIZE + 1000; i++)
+        TestDeflateLiteral(enc, TestRandom());
+    TestDeflateMatch(enc, 258, SCE_KERNEL_DEFLATE_WINDOW_SIZE - 8);
+    // The source is just ahead of the lines of the destination
+    TestDeflateMatch(enc, 200, SCE_KERNEL_DEFLATE_WINDOW_SIZE - 264);
+    for (i = 0; i < 100; i++)
+        TestDeflateLiteral(enc, TestRandom());
+    TestDeflateEnd(enc);
+    return TestDeflateRing(enc);
+}
+
+/* Bit by bit, independently of the table of utils.c */
+static u32 TestCrc32(const u8 *data, u32 size)
+{
+    u32 crc = 0xFFFFFFFF;
+    u32 i;
+
+    while (size-- != 0) {
+        crc ^= *(data++);
+        for (i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (-(crc & 1) & 0xEDB88320);
+    }
+    return ~crc;
+}
+
+static u32 TestPut32(u8 *buf, u32 value)
+{
+    buf[0] = value;
+    buf[1] = value >> 8;
+    buf[2] = value >> 16;
+    buf[3] = value >> 24;
+    return 4;
+}
+
+/* Wraps the deflate stream in a gzip file with every optional header field, returns its size */
+static u32 TestGzipFile(const TestDeflate *enc, u8 *file)
+{
+    static const u8 header[] = {
+        0x1F, 0x8B, 8, 0x1E, 0, 0, 0, 0, 0, 3, // FHCRC, FEXTRA, FNAME and FCOMMENT
+        5, 0, 'e', 'x', 't', 'r', 'a',
+        't', 'e', 's', 't', '.', 'b', 'i', 'n', 0,
+        'c', 'o', 'm', 'm', 'e', 'n', 't', 0,
+        0x12, 0x34
+    };
+    u32 size = sizeof header;
+
+    memcpy(file, header, size);
+    memcpy(file + size, enc->out, enc->size);
+    size += enc->size;
+    size += TestPut32(file + size, TestCrc32(enc->data, enc->dataSize));
+    size += TestPut32(file + size, enc->dataSize);
+    return size;
+}
+
+static s32 TestGzipStreamChunks(void)
+{
+    TestDeflate *enc = &g_testDeflate;
+    SceKernelGzipStream stream;
+    u32 fileSize;
+    u32 crc32;
+    u32 round, i;
+
+    TestDeflateBegin(enc);
+    for (i = 0; i < 1000; i++) {
+        if (i >= 16 && (TestRandom() & 3) == 0)
+            TestDeflateMatch(enc, 3 + TestRandom() % 64, 1 + (TestRandom() << 8 | TestRandom()) % enc->dataSize);
+        else
+            TestDeflateLiteral(enc, TestRandom());
+    }
+    TestDeflateEnd(enc);
+    fileSize = TestGzipFile(enc, g_testFile);
+    // Followed by bytes which are not part of the file
+    g_testFile[fileSize] = 0x1F;
+
+    // The first rounds feed the file in pieces of 1 to 8 bytes, the others in pieces of random sizes, from
+    // empty ones to a few hundred bytes
+    for (round = 0; round < 64; round++) {
+        u32 pos = 0;
+        s32 ret = 0;
+
+        TEST_ASSERT_OK(sceKernelGzipStreamInit(&stream, g_testWindow, sizeof g_testWindow));
+        while (pos < fileSize) {
+            u32 size = (round < 8) ? round + 1 : TestRandom() % (4 << (round % 8));
+            if (size > fileSize + 1 - pos)
+                size = fileSize + 1 - pos;
+            TEST_ASSERT(ret == 0);
+            ret = sceKernelGzipStreamFeed(&stream, g_testFile + pos, size);
+            TEST_ASSERT_OK(ret);
+            pos += size;
+        }
+        TEST_ASSERT(ret == 1);
+        TEST_ASSERT(sceKernelGzipStreamFinish(&stream, &crc32) == (s32)enc->dataSize);
+        TEST_ASSERT(crc32 == TestCrc32(enc->data, enc->dataSize));
+        for (i = 0; i < enc->dataSize; i++)
+            TEST_ASSERT(g_testWindow[i] == enc->data[i]);
+    }
+    return 0;
+}
+
+static s32 TestGzipStreamCorrupt(void)
+{
+    TestDeflate *enc = &g_testDeflate;
+    SceKernelGzipStream stream;
+    u32 fileSize;
+    u32 i;
+
+    TestDeflateBegin(enc);
+    for (i = 0; i < 100; i++)
+        TestDeflateLiteral(enc, TestRandom());
+    TestDeflateEnd(enc);
+    fileSize = TestGzipFile(enc, g_testFile);
+    // The last byte of the size, then of the CRC32, with their high bit set
+    for (i = 1; i <= 5; i += 4) {
+        g_testFile[fileSize - i] ^= 0x80;
+        TEST_ASSERT_OK(sceKernelGzipStreamInit(&stream, g_testWindow, sizeof g_testWindow));
+        TEST_ASSERT(sceKernelGzipStreamFeed(&stream, g_testFile, fileSize) == (s32)0x80000108);
+        g_testFile[fileSize - i] ^= 0x80;
+    }
+    return 0;
+}
+
+/* Compares a digest with its hexadecimal form */
+static s32 TestHexEqual(const u8 *digest, const char *hex)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    for (; *hex != '\0'; hex += 2, digest++) {
+        if (hex[0] != digits[*digest >> 4] || hex[1] != digits[*digest & 0xF])
+            return 0;
+    }
+    return 1;
+}
+
+/* The test vectors of RFC 1321 and FIPS 180-1 */
+static const struct {
+    const char *data;
+    u32 repeat;
+    const char *md5;
+    const char *sha1;
+} g_testDigests[] = {
+    { "", 1, "d41d8cd98f00b204e9800998ecf8427e", "da39a3ee5e6b4b0d3255bfef95601890afd80709" },
+    { "abc", 1, "900150983cd24fb0d6963f7d28e17f72", "a9993e364706816aba3e25717850c26c9cd0d89d" },
+    { "abcdefghijklmnopqrstuvwxyz", 1, "c3fcd3d76192e4007dfb496cca67e13b",
+      "32d10c7b8cf96570ca04ce37f2a19d84240d3a89" },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1, "8215ef0796a20bcaaae116d3876c664a",
+      "84983e441c3bd26ebaae4aa1f95129e5e54670f1" },
+    { "1234567890", 8, "57edf4a22be3c955ac49da2e2107b67a", "50abf5706a150990a08b2c5ea40fa0e585554732" },
+    { "a", 1000000, "7707d6ae4e027c70eea2a935c2296f21", "34aa973cd4c4daa4f61eeb2bdbad27316534016f" },
+};
+
+/* Builds the data of a test vector at the given offset of the benchmark buffer, returns its size */
+static u32 TestDigestData(u32 index, u32 offset)
+{
+    u32 len = strlen(g_testDigests[index].data);
+    u32 i;
+
+    for (i = 0; i < g_testDigests[index].repeat; i++)
+        memcpy(g_testBench + offset + i * len, g_testDigests[index].data, len);
+    return len * g_testDigests[index].repeat;
+}
+
+static s32 TestDigestVectors(void)
+{
+    u8 digest[20];
+    u32 numVectors = sizeof g_testDigests / sizeof g_testDigests[0];
+    u32 i, offset;
+
+    // From aligned and unaligned data
+    for (i = 0; i < numVectors; i++) {
+        for (offset = 0; offset < 4; offset += 3) {
+            u32 size = TestDigestData(i, offset);
+            TEST_ASSERT_OK(sceKernelUtilsMd5Digest(g_testBench + offset, size, digest));
+            TEST_ASSERT(TestHexEqual(digest, g_testDigests[i].md5));
+            TEST_ASSERT_OK(sceKernelUtilsSha1Digest(g_testBench + offset, size, digest));
+            TEST_ASSERT(TestHexEqual(digest, g_testDigests[i].sha1));
+        }
+    }
+    return 0;
+}
+
+static s32 TestDigestBlocks(void)
+{
+    SceKernelUtilsMd5Context md5;
+    SceKernelUtilsSha1Context sha1;
+    u8 digest[20];
+    u32 numVectors = sizeof g_testDigests / sizeof g_testDigests[0];
+    u32 i;
+
+    // The data is given in pieces of random sizes, which start at any alignment
+    for (i = 0; i < numVectors; i++) {
+        u32 size = TestDigestData(i, 1);
+        u32 pos = 0;
+
+        TEST_ASSERT_OK(sceKernelUtilsMd5BlockInit(&md5));
+        TEST_ASSERT_OK(sceKernelUtilsSha1BlockInit(&sha1));
+        while (pos < size) {
+            u32 n = TestRandom() % ((TestRandom() & 1) ? 16 : 300);
+            if (n > size - pos)
+                n = size - pos;
+            TEST_ASSERT_OK(sceKernelUtilsMd5BlockUpdate(&md5, g_testBench + 1 + pos, n));
+            TEST_ASSERT_OK(sceKernelUtilsSha1BlockUpdate(&sha1, g_testBench + 1 + pos, n));
+            pos += n;
+        }
+        TEST_ASSERT_OK(sceKernelUtilsMd5BlockResult(&md5, digest));
+        TEST_ASSERT(TestHexEqual(digest, g_testDigests[i].md5));
+        TEST_ASSERT_OK(sceKernelUtilsSha1BlockResult(&sha1, digest));
+        TEST_ASSERT(TestHexEqual(digest, g_testDigests[i].sha1));
+    }
+    return 0;
+}
+
+static s32 TestDigestBatch(void)
+{
+    SceKernelUtilsDigestEntry entries[6];
+    u8 digests[6][20];
+    u32 numVectors = sizeof g_testDigests / sizeof g_testDigests[0];
+    u32 offset = 0;
+    u32 i;
+
+    for (i = 0; i < numVectors; i++) {
+        entries[i].data = g_testBench + offset;
+        entries[i].size = TestDigestData(i, offset);
+        entries[i].digest = digests[i];
+        offset += entries[i].size + 1;
+    }
+    TEST_ASSERT_OK(sceKernelUtilsMd5DigestBatch(entries, numVectors));
+    for (i = 0; i < numVectors; i++)
+        TEST_ASSERT(TestHexEqual(digests[i], g_testDigests[i].md5));
+    TEST_ASSERT_OK(sceKernelUtilsSha1DigestBatch(entries, numVectors));
+    for (i = 0; i < numVectors; i++)
+        TEST_ASSERT(TestHexEqual(digests[i], g_testDigests[i].sha1));
+    TEST_ASSERT(sceKernelUtilsMd5DigestBatch(NULL, 1) == (s32)0x80000103);
+    return 0;
+}
+
+/* Throughput of one-shot digests in MB/s, for each power of 4 from 64 bytes to 16 MB */
+static void TestBenchDigests(void)
+{
+    u32 size, i;
+
+    for (i = 0; i < TEST_BENCH_MAX_SIZE; i++)
+        g_testBench[i] = TestRandom();
+    TestPrintf("%10s %10s %10s\n", "size", "MD5 MB/s", "SHA-1 MB/s");
+    for (size = TEST_BENCH_MIN_SIZE; size <= TEST_BENCH_MAX_SIZE; size *= 4) {
+        u32 count = TEST_BENCH_TOTAL / size;
+        u8 digest[20];
+        u64 md5Ns, sha1Ns;
+        u64 start;
+
+        start = HostTimeNs();
+        for (i = 0; i < count; i++)
+            Md5Digest(g_testBench + (i & 0xF) * 4, size, digest);
+        md5Ns = HostTimeNs() - start;
+        start = HostTimeNs();
+        for (i = 0; i < count; i++)
+            Sha1Digest(g_testBench + (i & 0xF) * 4, size, digest);
+        sha1Ns = HostTimeNs() - start;
+        // Bytes per microsecond
+        TestPrintf("%10u %10u %10u\n", size, (u32)((u64)count * size * 1000 / (md5Ns + 1)),
+                   (u32)((u64)count * size * 1000 / (sha1Ns + 1)));
+    }
+}
+
+/* The reference MT19937 generator (genrand_int32() of Matsumoto and Nishimura) */
+static void TestMtReference(u32 seed, u32 *out, u32 count)
+{
+    static u32 mt[624];
+    u32 i, k;
+
+    mt[0] = seed;
+    for (i = 1; i < 624; i++)
+        mt[i] = 1812433253 * (mt[i - 1] ^ (mt[i - 1] >> 30)) + i;
+    i = 624;
+    while (count-- != 0) {
+        u32 y;
+        if (i == 624) {
+            for (k = 0; k < 624; k++) {
+                y = (mt[k] & 0x80000000) | (mt[(k + 1) % 624] & 0x7FFFFFFF);
+                mt[k] = mt[(k + 397) % 624] ^ (y >> 1) ^ ((y & 1) ? 0x9908B0DF : 0);
+            }
+            i = 0;
+        }
+        y = mt[i++];
+        y ^= y >> 11;
+        y ^= (y << 7) & 0x9D2C5680;
+        y ^= (y << 15) & 0xEFC60000;
+        y ^= y >> 18;
+        *(out++) = y;
+    }
+}
+
+static s32 TestMt19937Reference(void)
+{
+    static u32 expected[TEST_MT_WORDS];
+    SceKernelUtilsMt19937Context ctx;
+    u32 i;
+
+    TEST_ASSERT_OK(sceKernelUtilsMt19937Init(&ctx, 5489));
+    TEST_ASSERT(sceKernelUtilsMt19937UInt(&ctx) == 3499211612);
+    for (i = 1; i < 9999; i++)
+        sceKernelUtilsMt19937UInt(&ctx);
+    TEST_ASSERT(sceKernelUtilsMt19937UInt(&ctx) == 4123659995);
+
+    TestMtReference(0x12345678, expected, TEST_MT_WORDS);
+    TEST_ASSERT_OK(sceKernelUtilsMt19937Init(&ctx, 0x12345678));
+    for (i = 0; i < TEST_MT_WORDS; i++)
+        TEST_ASSERT(sceKernelUtilsMt19937UInt(&ctx) == expected[i]);
+    return 0;
+}
+
+static s32 TestMt19937Fill(void)
+{
+    static const u32 counts[] = { 0, 1, 226, 227, 396, 397, 623, 624, 625, 1248 };
+    static u32 expected[TEST_MT_WORDS];
+    static u32 words[TEST_MT_WORDS];
+    SceKernelUtilsMt19937Context ctx;
+    u32 pos, i;
+
+    // Runs of every length around the ends of the three parts of the state, mixed with single words
+    TestMtReference(5489, expected, TEST_MT_WORDS);
+    for (i = 0; i < sizeof counts / sizeof counts[0]; i++) {
+        TEST_ASSERT_OK(sceKernelUtilsMt19937Init(&ctx, 5489));
+        pos = 0;
+        while (pos + counts[i] + 1 <= TEST_MT_WORDS) {
+            TEST_ASSERT_OK(sceKernelUtilsMt19937Fill(&ctx, words + pos, counts[i]));
+            pos += counts[i];
+            words[pos++] = sceKernelUtilsMt19937UInt(&ctx);
+        }
+        TEST_ASSERT(memcmp(words, expected, pos * 4) == 0);
+    }
+    TEST_ASSERT(sceKernelUtilsMt19937Fill(&ctx, NULL, 1) == (s32)0x800200D3);
+    TEST_ASSERT(sceKernelUtilsMt19937Fill(&ctx, words, 0x40000000) == (s32)0x80000104);
+    return 0;
+}
+
+/* Time per word drawn one by one and in runs of 1024 words */
+static void TestBenchMt19937(void)
+{
+    SceKernelUtilsMt19937Context ctx;
+    u32 *words = (u32 *)g_testBench;
+    u32 count = TEST_BENCH_TOTAL / 4;
+    u64 uintNs, fillNs;
+    u64 start;
+    u32 i;
+
+    sceKernelUtilsMt19937Init(&ctx, 5489);
+    start = HostTimeNs();
+    for (i = 0; i < count; i++)
+        words[i & 0xFFFFF] = sceKernelUtilsMt19937UInt(&ctx);
+    uintNs = HostTimeNs() - start;
+    start = HostTimeNs();
+    for (i = 0; i < count; i += 1024)
+        sceKernelUtilsMt19937Fill(&ctx, words + (i & 0xFFFFF), 1024);
+    fillNs = HostTimeNs() - start;
+    TestPrintf("MT19937: %u ps per word with UInt, %u ps per word with Fill\n", (u32)(uintNs * 1000 / count),
+               (u32)(fillNs * 1000 / count));
+}
+
+static const Test g_tests[] = {
+    { "deflate_linear", TestDeflateLinear },
+    { "deflate_ring_overlap", TestDeflateRingOverlap },
+    { "gzip_stream_chunks", TestGzipStreamChunks },
+    { "gzip_stream_corrupt", TestGzipStreamCorrupt },
+    { "digest_vectors", TestDigestVectors },
+    { "digest_blocks", TestDigestBlocks },
+    { "digest_batch", TestDigestBatch },
+    { "mt19937_reference", TestMt19937Reference },
+    { "mt19937_fill", TestMt19937Fill },
+};
+
+int main(int argc, char *argv[])
+{
+    u32 numTests = sizeof g_tests / sizeof g_tests[0];
+    u32 failed = 0;
+    u32 i;
+
+    // "psp-sysmem-test -b" runs the benchmarks instead of the tests
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        TestBenchDigests();
+        TestBenchMt19937();
+        return 0;
+    }
+    for (i = 0; i < numTests; i++) {
+        g_testSeed = i;
+        TestPrintf("%s\n", g_tests[i].name);
+        if (g_tests[i].func() != 0) {
+            TestPrintf("    FAILED\n");
+            failed++;
+        }
+    }
+    TestPrintf("%u of %u tests failed\n", failed, numTests);
+
+    return (failed != 0);
+}
@@ -0,0 +1,422 @@
+/* Copyright (C) 2011, 2012 The uOFW team
+   See the file COPYING for copying permission.
+
+   Analyzes the allocation trace printed by sceKernelPrintSysmemTrace() (sysmem built with TRACE=1).
+*/
+
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define MAX_LINE 1024
+#define MAX_PARTITIONS 16
+#define SEG_SIZE 256
+
+struct partition
+{
+	unsigned int addr;
+	unsigned int size;
+};
+
+/*
+ * An owner is either a module from the module map, or a single caller address.
+ * Heap allocations are made inside partition blocks, so they are counted apart from them.
+ */
+struct owner
+{
+	char name[64];
+	unsigned int start;
+	unsigned int end;
+	long long live[2];
+	long long peak[2];
+	unsigned int allocs;
+	unsigned int frees;
+};
+
+/* A block allocated during the trace and not freed yet */
+struct block
+{
+	int heap;
+	unsigned int obj;
+	unsigned int addr;
+	unsigned int size;
+	int owner; /* index in g_owners, which may be moved by realloc() */
+};
+
+static struct partition g_parts[MAX_PARTITIONS];
+static int g_partCount = 0;
+
+static struct owner *g_owners = NULL;
+static int g_ownerCount = 0;
+static int g_mappedOwners = 0;
+
+static struct block *g_blocks = NULL;
+static int g_blockCount = 0;
+static int g_blockMax = 0;
+
+/* Indexed by the 'heap' field of the blocks: partition blocks, then heap allocations */
+static long long g_live[2] = { 0, 0 };
+static long long g_peak[2] = { 0, 0 };
+static unsigned int g_allocs = 0;
+static unsigned int g_frees = 0;
+static unsigned int g_failures = 0;
+static unsigned int g_events = 0;
+static unsigned int g_lastTime = 0;
+static unsigned long long g_elapsed = 0;
+
+static int g_interval = 64;
+static const char *g_mapfile = NULL;
+static const char *g_infile = NULL;
+
+static struct option arg_opts[] =
+{
+	{"map", required_argument, NULL, 'm'},
+	{"interval", required_argument, NULL, 'i'},
+	{ NULL, 0, NULL, 0 }
+};
+
+static void print_help(void)
+{
+	fprintf(stderr, "Usage: psp-sysmem-trace [-m modules.map] [-i interval] [trace.txt]\n");
+	fprintf(stderr, "  -m, --map       File of 'name start size' lines (hexadecimal) used to attribute callers to modules\n");
+	fprintf(stderr, "  -i, --interval  Print the fragmentation every 'interval' events (default 64, 0 to disable)\n");
+	fprintf(stderr, "The trace is read from the standard input if no file is given. Only the blocks allocated\n");
+	fprintf(stderr, "during the trace are known, so the live sizes and fragmentation only take them into account.\n");
+}
+
+static int process_args(int argc, char **argv)
+{
+	int ch;
+
+	ch = getopt_long(argc, argv, "m:i:", arg_opts, NULL);
+	while (ch != -1)
+	{
+		switch (ch)
+		{
+			case 'm':
+				g_mapfile = optarg;
+				break;
+			case 'i':
+				g_interval = atoi(optarg);
+				break;
+			default:
+				return 0;
+		}
+		ch = getopt_long(argc, argv, "m:i:", arg_opts, NULL);
+	}
+
+	argc -= optind;
+	argv += optind;
+	if (argc > 1)
+		return 0;
+	if (argc == 1)
+		g_infile = argv[0];
+
+	return 1;
+}
+
+static int add_owner(const char *name, unsigned int start, unsigned int end)
+{
+	struct owner *owner;
+
+	g_owners = realloc(g_owners, (g_ownerCount + 1) * sizeof(struct owner));
+	if (g_owners == NULL)
+	{
+		fprintf(stderr, "Error, out of memory\n");
+		exit(1);
+	}
+	owner = &g_owners[g_ownerCount++];
+	memset(owner, 0, sizeof(*owner));
+	snprintf(owner->name, sizeof(owner->name), "%s", name);
+	owner->start = start;
+	owner->end = end;
+
+	return g_ownerCount - 1;
+}
+
+static int load_map(const char *filename)
+{
+	FILE *fp;
+	char line[MAX_LINE];
+	char name[64];
+	unsigned int start, size;
+
+	fp = fopen(filename, "r");
+	if (fp == NULL)
+	{
+		fprintf(stderr, "Error, could not open module map %s\n", filename);
+		return 0;
+	}
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		if (sscanf(line, "%63s %x %x", name, &start, &size) == 3)
+			add_owner(name, start, start + size);
+	}
+	fclose(fp);
+	g_mappedOwners = g_ownerCount;
+
+	return 1;
+}
+
+static int find_owner(unsigned int ra)
+{
+	char name[64];
+	int i;
+
+	for (i = 0; i < g_ownerCount; i++)
+	{
+		if (i < g_mappedOwners)
+		{
+			if (ra >= g_owners[i].start && ra < g_owners[i].end)
+				return i;
+		}
+		else if (g_owners[i].start == ra)
+			return i;
+	}
+	snprintf(name, sizeof(name), "ra:%08x", ra);
+
+	return add_owner(name, ra, ra + 4);
+}
+
+static void add_block(int heap, unsigned int obj, unsigned int addr, unsigned int size, unsigned int ra)
+{
+	struct block *block;
+	struct owner *owner;
+
+	if (g_blockCount == g_blockMax)
+	{
+		g_blockMax = g_blockMax ? g_blockMax * 2 : 256;
+		g_blocks = realloc(g_blocks, g_blockMax * sizeof(struct block));
+		if (g_blocks == NULL)
+		{
+			fprintf(stderr, "Error, out of memory\n");
+			exit(1);
+		}
+	}
+	block = &g_blocks[g_blockCount++];
+	block->heap = heap;
+	block->obj = obj;
+	block->addr = addr;
+	block->size = size;
+	block->owner = find_owner(ra);
+	owner = &g_owners[block->owner];
+	owner->live[heap] += size;
+	owner->allocs++;
+	if (owner->live[heap] > owner->peak[heap])
+		owner->peak[heap] = owner->live[heap];
+	g_live[heap] += size;
+	if (g_live[heap] > g_peak[heap])
+		g_peak[heap] = g_live[heap];
+}
+
+static void remove_block(int heap, unsigned int obj, unsigned int addr)
+{
+	int i;
+
+	for (i = 0; i < g_blockCount; i++)
+	{
+		if (g_blocks[i].heap == heap && g_blocks[i].obj == obj && g_blocks[i].addr == addr)
+		{
+			g_owners[g_blocks[i].owner].live[heap] -= g_blocks[i].size;
+			g_owners[g_blocks[i].owner].frees++;
+			g_live[heap] -= g_blocks[i].size;
+			g_blocks[i] = g_blocks[--g_blockCount];
+			return;
+		}
+	}
+	/* The block was allocated before the start of the trace */
+}
+
+static int compare_blocks(const void *a, const void *b)
+{
+	const struct block *blockA = *(const struct block * const *)a;
+	const struct block *blockB = *(const struct block * const *)b;
+
+	if (blockA->addr < blockB->addr)
+		return -1;
+	return blockA->addr > blockB->addr;
+}
+
+/* External fragmentation index of a partition: 1 - (largest free area / total free area) */
+static double fragmentation(const struct partition *part, unsigned int *totalFree, unsigned int *maxFree)
+{
+	struct block **sorted;
+	unsigned int cur = part->addr;
+	unsigned int end = part->addr + part->size;
+	int count = 0;
+	int i;
+
+	*totalFree = 0;
+	*maxFree = 0;
+	sorted = malloc((g_blockCount + 1) * sizeof(struct block *));
+	if (sorted == NULL)
+	{
+		fprintf(stderr, "Error, out of memory\n");
+		exit(1);
+	}
+	for (i = 0; i < g_blockCount; i++)
+	{
+		if (!g_blocks[i].heap && g_blocks[i].obj == part->addr)
+			sorted[count++] = &g_blocks[i];
+	}
+	qsort(sorted, count, sizeof(struct block *), compare_blocks);
+	for (i = 0; i <= count; i++)
+	{
+		unsigned int next = (i == count) ? end : sorted[i]->addr;
+		if (next > cur)
+		{
+			*totalFree += next - cur;
+			if (next - cur > *maxFree)
+				*maxFree = next - cur;
+		}
+		if (i < count && sorted[i]->addr + sorted[i]->size > cur)
+			cur = sorted[i]->addr + sorted[i]->size;
+	}
+	free(sorted);
+
+	if (*totalFree == 0)
+		return 0.0;
+	return 1.0 - (double)*maxFree / *totalFree;
+}
+
+static void print_fragmentation(void)
+{
+	unsigned int totalFree, maxFree;
+	int i;
+
+	printf("[%10llu] live %lld bytes:", g_elapsed, g_live[0]);
+	for (i = 0; i < g_partCount; i++)
+	{
+		double index = fragmentation(&g_parts[i], &totalFree, &maxFree);
+		printf(" %08x=%.3f", g_parts[i].addr, index);
+	}
+	printf("\n");
+}
+
+static void process_line(const char *line)
+{
+	char kind;
+	unsigned int time, ra, obj, arg, result;
+	unsigned int addr, size;
+
+	if (sscanf(line, "P %x %x", &addr, &size) == 2)
+	{
+		if (g_partCount < MAX_PARTITIONS && size != 0)
+		{
+			g_parts[g_partCount].addr = addr;
+			g_parts[g_partCount].size = size;
+			g_partCount++;
+		}
+		return;
+	}
+	if (sscanf(line, "%c %x %x %x %x %x", &kind, &time, &ra, &obj, &arg, &result) != 6)
+		return;
+	if (kind != 'A' && kind != 'F' && kind != 'a' && kind != 'f')
+		return;
+
+	if (g_events != 0)
+		g_elapsed += time - g_lastTime; /* the 32-bit counter wraps around */
+	g_lastTime = time;
+	g_events++;
+
+	switch (kind)
+	{
+		case 'A':
+			if (result == 0)
+			{
+				g_failures++;
+				break;
+			}
+			g_allocs++;
+			add_block(0, obj, result, (arg + SEG_SIZE - 1) & ~(SEG_SIZE - 1), ra);
+			break;
+		case 'a':
+			if (result == 0)
+			{
+				g_failures++;
+				break;
+			}
+			g_allocs++;
+			add_block(1, obj, result, (arg + 7) & ~7, ra);
+			break;
+		case 'F':
+		case 'f':
+			if (result != 0)
+				break;
+			g_frees++;
+			remove_block(kind == 'f', obj, arg);
+			break;
+	}
+
+	if (g_interval > 0 && (g_events % g_interval) == 0)
+		print_fragmentation();
+}
+
+static int compare_owners(const void *a, const void *b)
+{
+	const struct owner *ownerA = a;
+	const struct owner *ownerB = b;
+
+	if (ownerA->peak[0] != ownerB->peak[0])
+		return ownerA->peak[0] > ownerB->peak[0] ? -1 : 1;
+	if (ownerA->peak[1] != ownerB->peak[1])
+		return ownerA->peak[1] > ownerB->peak[1] ? -1 : 1;
+	return 0;
+}
+
+static void print_summary(void)
+{
+	int i;
+
+	printf("\nEvents: %u (%u allocations, %u frees, %u failed allocations) over %llu ticks\n",
+			g_events, g_allocs, g_frees, g_failures, g_elapsed);
+	if (g_elapsed != 0)
+		printf("Allocation rate: %.2f per million ticks\n", g_allocs * 1000000.0 / g_elapsed);
+	printf("Partition blocks live: %lld bytes, peak: %lld bytes\n", g_live[0], g_peak[0]);
+	printf("Heap allocations live: %lld bytes, peak: %lld bytes (inside the partition blocks)\n", g_live[1], g_peak[1]);
+	print_fragmentation();
+
+	qsort(g_owners, g_ownerCount, sizeof(struct owner), compare_owners);
+	printf("\n%-24s %12s %12s %12s %12s %8s %8s\n", "Owner", "Live", "Peak", "Heap live", "Heap peak", "Allocs", "Frees");
+	for (i = 0; i < g_ownerCount; i++)
+	{
+		if (g_owners[i].allocs == 0)
+			continue;
+		printf("%-24s %12lld %12lld %12lld %12lld %8u %8u\n", g_owners[i].name, g_owners[i].live[0],
+				g_owners[i].peak[0], g_owners[i].live[1], g_owners[i].peak[1], g_owners[i].allocs, g_owners[i].frees);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	FILE *fp = stdin;
+	char line[MAX_LINE];
+
+	if (!process_args(argc, argv))
+	{
+		print_help();
+		return 1;
+	}
+	if (g_mapfile != NULL && !load_map(g_mapfile))
+		return 1;
+	if (g_infile != NULL)
+	{
+		fp = fopen(g_infile, "r");
+		if (fp == NULL)
+		{
+			fprintf(stderr, "Error, could not open %s\n", g_infile);
+			return 1;
+		}
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL)
+		process_line(line);
+	if (fp != stdin)
+		fclose(fp);
+
+	print_summary();
+
+	return 0;
+}
+